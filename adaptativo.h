@@ -0,0 +1,96 @@
+#ifndef ADAPTATIVO_H
+#define ADAPTATIVO_H
+
+#include "structs_huffman.h"
+#include "canonico.h"
+
+/**
+ * Modelo do fluxo adaptativo. O compressor e o descompressor começam com todos os bytes com a mesma frequência e somam
+ * ao modelo cada trecho depois de processá-lo; os códigos são refeitos pelas mesmas regras dos dois lados, então
+ * nenhuma tabela vai no fluxo e cada trecho pode ser gravado assim que chega. A primeira reconstrução acontece depois
+ * de PRIMEIRA_RECONSTRUCAO_ADAPTATIVA bytes e o espaço entre elas dobra até chegar ao intervalo. Quando o total das
+ * frequências passa de MEMORIA_ADAPTATIVA intervalos, todas são divididas por 2, para o modelo acompanhar as mudanças
+ * dos dados.
+ */
+
+//limites do intervalo entre as reconstrucoes, que tambem e o maior trecho
+#define INTERVALO_ADAPTATIVO_MINIMO (4 * 1024)
+#define INTERVALO_ADAPTATIVO_PADRAO (64 * 1024)
+#define INTERVALO_ADAPTATIVO_MAXIMO TAMANHO_BLOCO_MAXIMO
+#define PRIMEIRA_RECONSTRUCAO_ADAPTATIVA 4096
+#define MEMORIA_ADAPTATIVA 8
+//limite do tamanho dos codigos quando nenhum e pedido; todos os bytes tem codigo, entao o minimo e 8
+#define LIMITE_ADAPTATIVO_PADRAO 15
+#define LIMITE_ADAPTATIVO_MINIMO 8
+
+typedef struct modelo_adaptativo
+{
+    long frequencia[Max_table];
+    uint64_t total;
+    uint8_t tamanhos[Max_table];
+    int limite;
+    size_t intervalo;
+    //bytes entre a ultima reconstrucao e a proxima, e quantos ja vieram desde a ultima
+    size_t proxima;
+    size_t acumulados;
+} ModeloAdaptativo;
+
+/**
+ * @brief   Prepara o modelo inicial, com todos os bytes com frequência 1 e, portanto, códigos de 8 bits.
+ *
+ * @param modelo        O modelo.
+ * @param intervalo     O maior espaço entre duas reconstruções.
+ * @param limite        O maior tamanho de código.
+ */
+void iniciar_modelo_adaptativo(ModeloAdaptativo *modelo, size_t intervalo, int limite)
+{
+    for(int i = 0; i < Max_table; i++)
+    {
+        modelo->frequencia[i] = 1;
+    }
+    modelo->total = Max_table;
+    modelo->limite = limite;
+    modelo->intervalo = intervalo;
+    modelo->proxima = PRIMEIRA_RECONSTRUCAO_ADAPTATIVA < intervalo ? PRIMEIRA_RECONSTRUCAO_ADAPTATIVA : intervalo;
+    modelo->acumulados = 0;
+    tamanhos_limitados(modelo->frequencia, limite, modelo->tamanhos);
+}
+
+/**
+ * @brief   Soma ao modelo as frequências de um trecho e, se já passaram bytes suficientes desde a última vez, refaz
+ *          o tamanho dos códigos.
+ *
+ * @param modelo                O modelo.
+ * @param frequencia_trecho     A frequência de cada byte no trecho.
+ * @param tamanho               O tamanho do trecho.
+ * @return                      true se os códigos mudaram e as tabelas precisam ser refeitas.
+ */
+bool atualizar_modelo_adaptativo(ModeloAdaptativo *modelo, const long *frequencia_trecho, size_t tamanho)
+{
+    for(int i = 0; i < Max_table; i++)
+    {
+        modelo->frequencia[i] += frequencia_trecho[i];
+    }
+    modelo->total += tamanho;
+    modelo->acumulados += tamanho;
+    if(modelo->acumulados < modelo->proxima)
+    {
+        return false;
+    }
+    modelo->acumulados = 0;
+    modelo->proxima = modelo->proxima * 2 < modelo->intervalo ? modelo->proxima * 2 : modelo->intervalo;
+    tamanhos_limitados(modelo->frequencia, modelo->limite, modelo->tamanhos);
+    //envelhece as frequencias sem deixar nenhuma chegar a 0, para todo byte continuar com codigo
+    if(modelo->total > (uint64_t)MEMORIA_ADAPTATIVA * modelo->intervalo)
+    {
+        modelo->total = 0;
+        for(int i = 0; i < Max_table; i++)
+        {
+            modelo->frequencia[i] = (modelo->frequencia[i] + 1) / 2;
+            modelo->total += modelo->frequencia[i];
+        }
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,841 @@
+/**
+* benchmark do código de huffman
+* UFAL
+*
+* Gera um corpus sintético determinístico, mede a compressão e a descompressão de cada motor em cada arquivo do corpus
+* e grava os resultados em JSON. Cada caso roda em um processo filho, para que o pico de memória de um não contamine o
+* outro e para que uma falha do codec não derrube o benchmark inteiro.
+*/
+
+#include "biblioteca.h"
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+//tamanho padrao de cada arquivo do corpus e do arquivo pequeno
+#define TAMANHO_CORPUS_PADRAO (8 * 1024 * 1024)
+#define TAMANHO_CORPUS_PEQUENO 4096
+//tamanho dos trechos gerados e gravados de uma vez
+#define TAMANHO_TRECHO_CORPUS (1024 * 1024)
+//tamanho de cada chamada da biblioteca, que simula um pedido de um servidor
+#define TAMANHO_PEDIDO_PADRAO (64 * 1024)
+//repeticoes minimas de cada caso e quantos bytes, no minimo, cada caso processa
+#define REPETICOES_PADRAO 5
+#define BYTES_MINIMOS_CASO (64ULL * 1024 * 1024)
+#define REPETICOES_MAXIMAS 2000
+//quantidade maxima de latencias guardadas por caso
+#define MAXIMO_AMOSTRAS 65536
+
+typedef enum tipo_corpus
+{
+    CORPUS_TEXTO,
+    CORPUS_LOGS,
+    CORPUS_ZEROS,
+    CORPUS_ALEATORIO,
+    CORPUS_ENVIESADO,
+    CORPUS_MISTO
+} TipoCorpus;
+
+typedef enum motor
+{
+    MOTOR_LEGADO,
+    MOTOR_BLOCOS,
+    MOTOR_BIBLIOTECA,
+    MOTOR_ADAPTATIVO,
+    MOTOR_INTERCALADO
+} Motor;
+
+static const char *nomes_motores[] = {"legado", "blocos", "biblioteca", "adaptativo", "intercalado"};
+
+//um arquivo do corpus: o nome no json, como e gerado, o tamanho e onde foi gravado
+typedef struct arquivo_corpus
+{
+    const char *nome;
+    TipoCorpus tipo;
+    uint64_t tamanho;
+    char caminho[600];
+} ArquivoCorpus;
+
+//estado do gerador de um arquivo do corpus, que continua de um trecho para o outro
+typedef struct gerador
+{
+    TipoCorpus tipo;
+    uint64_t estado;
+    uint64_t linha;
+    uint64_t gerados;
+} Gerador;
+
+typedef struct percentis
+{
+    double p50, p90, p99, maximo;
+} Percentis;
+
+//o que o processo filho manda de volta para o pai
+typedef struct resultado_caso
+{
+    bool correto;
+    uint64_t tamanho_original;
+    uint64_t tamanho_comprimido;
+    int repeticoes;
+    double segundos_compressao;
+    double segundos_descompressao;
+    Percentis latencia_compressao;
+    Percentis latencia_descompressao;
+    char erro[128];
+} ResultadoCaso;
+
+typedef struct configuracao
+{
+    uint64_t tamanho;
+    uint64_t tamanho_grande;
+    int repeticoes;
+    int threads;
+    size_t tamanho_pedido;
+    const char *diretorio;
+    const char *saida;
+} Configuracao;
+
+static const char *palavras[] = {
+    "de", "a", "o", "que", "e", "do", "da", "em", "um", "para", "com", "não", "uma", "os", "no", "se", "na", "por",
+    "mais", "as", "dos", "como", "mas", "ao", "ele", "das", "seu", "sua", "ou", "quando", "muito", "nos", "já",
+    "também", "só", "pelo", "pela", "até", "isso", "ela", "entre", "depois", "sem", "mesmo", "aos", "seus", "quem",
+    "árvore", "compressão", "arquivo", "código", "frequência", "universidade", "computação", "alagoas", "maceió",
+    "engenharia", "estrutura", "dados", "algoritmo", "memória", "processador", "tabela", "símbolo", "bloco"
+};
+
+static const char *niveis_log[] = {"INFO", "INFO", "INFO", "INFO", "DEBUG", "DEBUG", "WARN", "ERROR"};
+static const char *servicos_log[] = {"autenticacao", "pagamentos", "catalogo", "busca", "notificacoes", "estoque"};
+
+/**
+ * @brief   O próximo número do gerador xorshift64*. A mesma semente sempre dá a mesma sequência, em qualquer máquina.
+ *
+ * @param estado    O estado do gerador.
+ * @return          Um número de 64 bits.
+ */
+static inline uint64_t proximo_aleatorio(uint64_t *estado)
+{
+    uint64_t x = *estado;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *estado = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @brief   O tempo de um relógio monotônico, em segundos.
+ *
+ * @return  Os segundos desde um instante fixo qualquer.
+ */
+static double agora()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec / 1e9;
+}
+
+/**
+ * @brief   Copia uma string para o trecho, sem passar do fim dele.
+ *
+ * @param trecho    O trecho.
+ * @param posicao   Onde a string começa; avança até o fim dela.
+ * @param tamanho   O tamanho do trecho.
+ * @param texto     A string.
+ */
+static void anexar(uint8_t *trecho, size_t *posicao, size_t tamanho, const char *texto)
+{
+    for(; *texto != '\0' && *posicao < tamanho; texto++)
+    {
+        trecho[(*posicao)++] = (uint8_t)*texto;
+    }
+}
+
+/**
+ * @brief   Escolhe uma palavra com distribuição parecida com a de um texto de verdade: as primeiras da lista
+ *          aparecem muito mais que as últimas.
+ *
+ * @param estado    O estado do gerador.
+ * @return          A palavra.
+ */
+static const char* palavra_aleatoria(uint64_t *estado)
+{
+    int quantidade = sizeof(palavras) / sizeof(palavras[0]);
+    uint64_t a = proximo_aleatorio(estado) % quantidade, b = proximo_aleatorio(estado) % quantidade;
+    return palavras[a * b / quantidade];
+}
+
+/**
+ * @brief   Gera o próximo trecho de um arquivo do corpus.
+ *
+ * @param gerador   O estado do gerador do arquivo.
+ * @param trecho    Onde os bytes são gravados.
+ * @param tamanho   Quantos bytes gerar.
+ */
+static void gerar_trecho(Gerador *gerador, uint8_t *trecho, size_t tamanho)
+{
+    size_t i = 0;
+    TipoCorpus tipo = gerador->tipo;
+    //o arquivo misto troca de tipo a cada trecho, entre os que aparecem em arquivos grandes de verdade
+    if(tipo == CORPUS_MISTO)
+    {
+        static const TipoCorpus partes[] = {CORPUS_TEXTO, CORPUS_LOGS, CORPUS_LOGS, CORPUS_ZEROS, CORPUS_ALEATORIO};
+        tipo = partes[(gerador->gerados / TAMANHO_TRECHO_CORPUS) % 5];
+    }
+    gerador->gerados += tamanho;
+
+    switch(tipo)
+    {
+    case CORPUS_TEXTO:
+        while(i < tamanho)
+        {
+            uint64_t r = proximo_aleatorio(&gerador->estado);
+            anexar(trecho, &i, tamanho, palavra_aleatoria(&gerador->estado));
+            anexar(trecho, &i, tamanho, r % 23 == 0 ? ".\n" : (r % 7 == 0 ? ", " : " "));
+        }
+        break;
+    case CORPUS_LOGS:
+        while(i < tamanho)
+        {
+            char linha[256];
+            uint64_t r = proximo_aleatorio(&gerador->estado);
+            uint64_t segundos = gerador->linha / 20;
+            snprintf(linha, sizeof(linha), "2023-10-%02d %02d:%02d:%02d.%03d [%s] %s pedido=%llu usuario=%llu "
+                     "duracao=%llums status=%d\n", (int)(1 + segundos / 86400 % 28), (int)(segundos / 3600 % 24),
+                     (int)(segundos / 60 % 60), (int)(segundos % 60), (int)(gerador->linha % 20 * 50),
+                     niveis_log[r % 8], servicos_log[(r >> 3) % 6], (unsigned long long)gerador->linha,
+                     (unsigned long long)((r >> 8) % 5000), (unsigned long long)((r >> 24) % 2000),
+                     (r >> 40) % 50 == 0 ? 500 : 200);
+            anexar(trecho, &i, tamanho, linha);
+            gerador->linha++;
+        }
+        break;
+    case CORPUS_ZEROS:
+        //como um binario: regioes zeradas longas, alternadas com trechos curtos de dados
+        while(i < tamanho)
+        {
+            uint64_t r = proximo_aleatorio(&gerador->estado);
+            size_t zeros = r % 4096, dados = (r >> 12) % 256;
+            for(; zeros > 0 && i < tamanho; zeros--)
+            {
+                trecho[i++] = 0;
+            }
+            for(; dados > 0 && i < tamanho; dados--)
+            {
+                trecho[i++] = (uint8_t)proximo_aleatorio(&gerador->estado);
+            }
+        }
+        break;
+    case CORPUS_ALEATORIO:
+        for(; i < tamanho; i++)
+        {
+            trecho[i] = (uint8_t)(proximo_aleatorio(&gerador->estado) >> 56);
+        }
+        break;
+    case CORPUS_ENVIESADO:
+        //distribuicao geometrica: cada byte tem metade da chance do anterior
+        for(; i < tamanho; i++)
+        {
+            uint64_t r = proximo_aleatorio(&gerador->estado) | (1ULL << 40);
+            trecho[i] = (uint8_t)('a' + __builtin_ctzll(r));
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief   Grava um arquivo do corpus no disco, trecho por trecho, então até arquivos de vários GiB usam pouca
+ *          memória.
+ *
+ * @param arquivo   O arquivo do corpus, com o caminho já preenchido.
+ * @param semente   A semente do gerador.
+ * @return          false se não foi possível gravar o arquivo.
+ */
+static bool gravar_corpus(ArquivoCorpus *arquivo, uint64_t semente)
+{
+    FILE *destino = fopen(arquivo->caminho, "wb");
+    uint8_t *trecho = (uint8_t*)malloc(TAMANHO_TRECHO_CORPUS);
+    if(destino == NULL || trecho == NULL)
+    {
+        if(destino != NULL)
+        {
+            fclose(destino);
+        }
+        free(trecho);
+        return false;
+    }
+    Gerador gerador = {arquivo->tipo, semente, 0, 0};
+    bool ok = true;
+    for(uint64_t gravados = 0; gravados < arquivo->tamanho && ok; )
+    {
+        size_t tamanho = arquivo->tamanho - gravados < TAMANHO_TRECHO_CORPUS ? arquivo->tamanho - gravados
+                                                                             : TAMANHO_TRECHO_CORPUS;
+        gerar_trecho(&gerador, trecho, tamanho);
+        ok = fwrite(trecho, 1, tamanho, destino) == tamanho;
+        gravados += tamanho;
+    }
+    free(trecho);
+    return fclose(destino) == 0 && ok;
+}
+
+/**
+ * @brief   Compara dois arquivos byte a byte.
+ *
+ * @param caminho_a     O primeiro arquivo.
+ * @param caminho_b     O segundo arquivo.
+ * @return              true se os dois existem e são iguais.
+ */
+static bool arquivos_iguais(const char *caminho_a, const char *caminho_b)
+{
+    FILE *a = fopen(caminho_a, "rb"), *b = fopen(caminho_b, "rb");
+    bool iguais = a != NULL && b != NULL;
+    static uint8_t trecho_a[1 << 16], trecho_b[1 << 16];
+    while(iguais)
+    {
+        size_t lidos_a = fread(trecho_a, 1, sizeof(trecho_a), a), lidos_b = fread(trecho_b, 1, sizeof(trecho_b), b);
+        iguais = lidos_a == lidos_b && memcmp(trecho_a, trecho_b, lidos_a) == 0;
+        if(lidos_a == 0)
+        {
+            break;
+        }
+    }
+    if(a != NULL)
+    {
+        fclose(a);
+    }
+    if(b != NULL)
+    {
+        fclose(b);
+    }
+    return iguais;
+}
+
+/**
+ * @brief   O tamanho de um arquivo.
+ *
+ * @param caminho   O arquivo.
+ * @return          O tamanho em bytes, ou 0 se não existir.
+ */
+static uint64_t tamanho_arquivo(const char *caminho)
+{
+    struct stat informacoes;
+    return stat(caminho, &informacoes) == 0 ? (uint64_t)informacoes.st_size : 0;
+}
+
+static int comparar_double(const void *a, const void *b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief   Calcula os percentis de uma lista de latências. A lista é ordenada.
+ *
+ * @param amostras      As latências, em segundos.
+ * @param quantidade    Quantas latências.
+ * @return              Os percentis, em microssegundos.
+ */
+static Percentis calcular_percentis(double *amostras, size_t quantidade)
+{
+    Percentis percentis = {0, 0, 0, 0};
+    if(quantidade == 0)
+    {
+        return percentis;
+    }
+    qsort(amostras, quantidade, sizeof(double), comparar_double);
+    percentis.p50 = amostras[(quantidade - 1) * 50 / 100] * 1e6;
+    percentis.p90 = amostras[(quantidade - 1) * 90 / 100] * 1e6;
+    percentis.p99 = amostras[(quantidade - 1) * 99 / 100] * 1e6;
+    percentis.maximo = amostras[quantidade - 1] * 1e6;
+    return percentis;
+}
+
+/**
+ * @brief   Quantas repetições um caso faz: pelo menos as pedidas, e mais nos arquivos pequenos, para que o tempo
+ *          medido não seja só ruído.
+ *
+ * @param config    A configuração do benchmark.
+ * @param tamanho   O tamanho do arquivo.
+ * @return          A quantidade de repetições.
+ */
+static int repeticoes_caso(Configuracao *config, uint64_t tamanho)
+{
+    uint64_t repeticoes = tamanho > 0 ? BYTES_MINIMOS_CASO / tamanho : REPETICOES_MAXIMAS;
+    if(repeticoes < (uint64_t)config->repeticoes)
+    {
+        repeticoes = config->repeticoes;
+    }
+    return repeticoes > REPETICOES_MAXIMAS ? REPETICOES_MAXIMAS : (int)repeticoes;
+}
+
+/**
+ * @brief   Mede um motor que trabalha com arquivos: comprime e descomprime o arquivo inteiro várias vezes, e cada
+ *          repetição é uma amostra de latência.
+ *
+ * @param config    A configuração do benchmark.
+ * @param arquivo   O arquivo do corpus.
+ * @param motor     MOTOR_LEGADO, MOTOR_BLOCOS, MOTOR_ADAPTATIVO ou MOTOR_INTERCALADO.
+ * @param resultado Recebe as medidas.
+ */
+static void medir_motor_arquivo(Configuracao *config, ArquivoCorpus *arquivo, Motor motor, ResultadoCaso *resultado)
+{
+    char caminho_comprimido[700], caminho_descomprimido[700];
+    snprintf(caminho_comprimido, sizeof(caminho_comprimido), "%s.%s.huff", arquivo->caminho, nomes_motores[motor]);
+    snprintf(caminho_descomprimido, sizeof(caminho_descomprimido), "%s.%s.out", arquivo->caminho,
+             nomes_motores[motor]);
+    OpcoesCompressao opcoes = opcoes_padrao();
+    opcoes.formato = FORMATO_LEGADO;
+    if(motor == MOTOR_BLOCOS || motor == MOTOR_INTERCALADO)
+    {
+        opcoes.formato = FORMATO_BLOCOS;
+        opcoes.fluxos = motor == MOTOR_INTERCALADO ? 4 : 1;
+    }
+    else if(motor == MOTOR_ADAPTATIVO)
+    {
+        opcoes.formato = FORMATO_ADAPTATIVO;
+    }
+    opcoes.threads = config->threads;
+
+    int repeticoes = repeticoes_caso(config, arquivo->tamanho);
+    double *latencias_compressao = (double*)malloc(repeticoes * sizeof(double));
+    double *latencias_descompressao = (double*)malloc(repeticoes * sizeof(double));
+    for(int r = 0; r < repeticoes; r++)
+    {
+        double inicio = agora();
+        FILE *origem = fopen(arquivo->caminho, "rb"), *destino = fopen(caminho_comprimido, "wb");
+        if(origem == NULL || destino == NULL)
+        {
+            snprintf(resultado->erro, sizeof(resultado->erro), "não foi possível abrir os arquivos");
+            return;
+        }
+        const char *erro;
+        if(motor == MOTOR_BLOCOS || motor == MOTOR_INTERCALADO)
+        {
+            erro = comprimir_blocos(origem, destino, &opcoes);
+        }
+        else if(motor == MOTOR_ADAPTATIVO)
+        {
+            erro = comprimir_adaptativo(origem, destino, &opcoes);
+        }
+        else
+        {
+            erro = comprimir_arquivo(origem, destino, &opcoes);
+        }
+        fclose(origem);
+        fclose(destino);
+        if(erro != NULL)
+        {
+            snprintf(resultado->erro, sizeof(resultado->erro), "%s", erro);
+            return;
+        }
+        latencias_compressao[r] = agora() - inicio;
+
+        inicio = agora();
+        origem = fopen(caminho_comprimido, "rb");
+        destino = fopen(caminho_descomprimido, "w+b");
+        if(origem == NULL || destino == NULL)
+        {
+            snprintf(resultado->erro, sizeof(resultado->erro), "não foi possível abrir os arquivos");
+            return;
+        }
+        erro = descomprimir_arquivo(origem, destino, config->threads, NULL, NULL);
+        fclose(origem);
+        fclose(destino);
+        if(erro != NULL)
+        {
+            snprintf(resultado->erro, sizeof(resultado->erro), "%s", erro);
+            return;
+        }
+        latencias_descompressao[r] = agora() - inicio;
+
+        resultado->segundos_compressao += latencias_compressao[r];
+        resultado->segundos_descompressao += latencias_descompressao[r];
+    }
+    resultado->repeticoes = repeticoes;
+    resultado->tamanho_original = arquivo->tamanho;
+    resultado->tamanho_comprimido = tamanho_arquivo(caminho_comprimido);
+    resultado->correto = arquivos_iguais(arquivo->caminho, caminho_descomprimido);
+    resultado->latencia_compressao = calcular_percentis(latencias_compressao, repeticoes);
+    resultado->latencia_descompressao = calcular_percentis(latencias_descompressao, repeticoes);
+    free(latencias_compressao);
+    free(latencias_descompressao);
+    remove(caminho_comprimido);
+    remove(caminho_descomprimido);
+}
+
+/**
+ * @brief   Mede a biblioteca: o arquivo é carregado na memória e dividido em pedidos, e cada pedido é comprimido e
+ *          descomprimido por uma chamada, com os mesmos contextos. Cada chamada é uma amostra de latência.
+ *
+ * @param config    A configuração do benchmark.
+ * @param arquivo   O arquivo do corpus.
+ * @param resultado Recebe as medidas.
+ */
+static void medir_biblioteca(Configuracao *config, ArquivoCorpus *arquivo, ResultadoCaso *resultado)
+{
+    size_t tamanho = (size_t)arquivo->tamanho;
+    size_t pedido = config->tamanho_pedido;
+    size_t pedidos = tamanho > 0 ? (tamanho + pedido - 1) / pedido : 1;
+    OpcoesCompressao opcoes = opcoes_padrao();
+    ContextoCompressao *compressor = huff_criar_contexto_compressao(&opcoes);
+    ContextoDescompressao *descompressor = huff_criar_contexto_descompressao();
+    size_t limite = huff_limite_compressao(compressor, pedido);
+    uint8_t *dados = (uint8_t*)malloc(tamanho + 1), *restaurados = (uint8_t*)malloc(tamanho + 1);
+    uint8_t *comprimidos = (uint8_t*)malloc(limite * pedidos);
+    size_t *tamanhos = (size_t*)malloc(pedidos * sizeof(size_t));
+    FILE *origem = fopen(arquivo->caminho, "rb");
+    if(compressor == NULL || descompressor == NULL || dados == NULL || restaurados == NULL || comprimidos == NULL ||
+       tamanhos == NULL || origem == NULL || fread(dados, 1, tamanho, origem) != tamanho)
+    {
+        snprintf(resultado->erro, sizeof(resultado->erro), "não foi possível carregar o arquivo");
+        return;
+    }
+    fclose(origem);
+
+    int repeticoes = repeticoes_caso(config, arquivo->tamanho);
+    size_t maximo_amostras = (size_t)repeticoes * pedidos;
+    if(maximo_amostras > MAXIMO_AMOSTRAS)
+    {
+        maximo_amostras = MAXIMO_AMOSTRAS;
+    }
+    double *latencias_compressao = (double*)malloc(maximo_amostras * sizeof(double));
+    double *latencias_descompressao = (double*)malloc(maximo_amostras * sizeof(double));
+    size_t amostras = 0;
+    resultado->correto = true;
+    for(int r = 0; r < repeticoes; r++)
+    {
+        resultado->tamanho_comprimido = 0;
+        for(size_t p = 0; p < pedidos; p++)
+        {
+            size_t inicio_pedido = p * pedido;
+            size_t tamanho_pedido = tamanho - inicio_pedido < pedido ? tamanho - inicio_pedido : pedido;
+            uint8_t *comprimido = comprimidos + p * limite;
+            size_t restaurado;
+
+            double inicio = agora();
+            int codigo = huff_comprimir(compressor, dados + inicio_pedido, tamanho_pedido, comprimido, limite,
+                                        &tamanhos[p]);
+            double meio = agora();
+            if(codigo == HUFF_OK)
+            {
+                codigo = huff_descomprimir(descompressor, comprimido, tamanhos[p], restaurados + inicio_pedido,
+                                           tamanho_pedido, &restaurado);
+            }
+            double fim = agora();
+            if(codigo != HUFF_OK || restaurado != tamanho_pedido)
+            {
+                snprintf(resultado->erro, sizeof(resultado->erro), "%s", huff_mensagem_erro(codigo));
+                resultado->correto = false;
+                break;
+            }
+            resultado->segundos_compressao += meio - inicio;
+            resultado->segundos_descompressao += fim - meio;
+            resultado->tamanho_comprimido += tamanhos[p];
+            if(amostras < maximo_amostras)
+            {
+                latencias_compressao[amostras] = meio - inicio;
+                latencias_descompressao[amostras] = fim - meio;
+                amostras++;
+            }
+        }
+    }
+    resultado->repeticoes = repeticoes;
+    resultado->tamanho_original = tamanho;
+    resultado->correto = resultado->correto && memcmp(dados, restaurados, tamanho) == 0;
+    resultado->latencia_compressao = calcular_percentis(latencias_compressao, amostras);
+    resultado->latencia_descompressao = calcular_percentis(latencias_descompressao, amostras);
+    free(latencias_compressao);
+    free(latencias_descompressao);
+    free(dados);
+    free(restaurados);
+    free(comprimidos);
+    free(tamanhos);
+    huff_destruir_contexto_compressao(compressor);
+    huff_destruir_contexto_descompressao(descompressor);
+}
+
+/**
+ * @brief   Roda um caso em um processo filho e espera o resultado. O pico de memória vem do próprio processo filho.
+ *          A saída padrão do filho é descartada, porque o codec escreve mensagens nela.
+ *
+ * @param config    A configuração do benchmark.
+ * @param arquivo   O arquivo do corpus.
+ * @param motor     O motor medido.
+ * @param resultado Recebe as medidas.
+ * @param pico_rss  Recebe o pico de memória residente do filho, em KiB.
+ */
+static void rodar_caso(Configuracao *config, ArquivoCorpus *arquivo, Motor motor, ResultadoCaso *resultado,
+                       long *pico_rss)
+{
+    memset(resultado, 0, sizeof(ResultadoCaso));
+    *pico_rss = 0;
+    int canal[2];
+    fflush(stdout);
+    fflush(stderr);
+    if(pipe(canal) != 0)
+    {
+        snprintf(resultado->erro, sizeof(resultado->erro), "não foi possível criar o pipe");
+        return;
+    }
+    pid_t filho = fork();
+    if(filho < 0)
+    {
+        close(canal[0]);
+        close(canal[1]);
+        snprintf(resultado->erro, sizeof(resultado->erro), "não foi possível criar o processo");
+        return;
+    }
+    if(filho == 0)
+    {
+        close(canal[0]);
+        if(freopen("/dev/null", "w", stdout) == NULL)
+        {
+            _exit(1);
+        }
+        if(motor == MOTOR_BIBLIOTECA)
+        {
+            medir_biblioteca(config, arquivo, resultado);
+        }
+        else
+        {
+            medir_motor_arquivo(config, arquivo, motor, resultado);
+        }
+        _exit(write(canal[1], resultado, sizeof(ResultadoCaso)) == sizeof(ResultadoCaso) ? 0 : 1);
+    }
+
+    close(canal[1]);
+    size_t lidos = 0;
+    while(lidos < sizeof(ResultadoCaso))
+    {
+        ssize_t n = read(canal[0], (uint8_t*)resultado + lidos, sizeof(ResultadoCaso) - lidos);
+        if(n <= 0)
+        {
+            break;
+        }
+        lidos += n;
+    }
+    close(canal[0]);
+    int status;
+    struct rusage uso;
+    wait4(filho, &status, 0, &uso);
+    *pico_rss = uso.ru_maxrss;
+    if(lidos != sizeof(ResultadoCaso))
+    {
+        //o codec encerrou o processo filho com exit antes de terminar
+        memset(resultado, 0, sizeof(ResultadoCaso));
+        snprintf(resultado->erro, sizeof(resultado->erro), "o processo do caso terminou com status %d",
+                 WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+    }
+}
+
+/**
+ * @brief   Escreve uma string JSON, com os caracteres especiais escapados.
+ *
+ * @param saida     O arquivo JSON.
+ * @param texto     A string.
+ */
+static void escrever_string_json(FILE *saida, const char *texto)
+{
+    fputc('"', saida);
+    for(; *texto != '\0'; texto++)
+    {
+        if(*texto == '"' || *texto == '\\')
+        {
+            fputc('\\', saida);
+        }
+        if((unsigned char)*texto < 0x20)
+        {
+            fprintf(saida, "\\u%04x", *texto);
+            continue;
+        }
+        fputc(*texto, saida);
+    }
+    fputc('"', saida);
+}
+
+/**
+ * @brief   Escreve os percentis de latência como um objeto JSON.
+ *
+ * @param saida     O arquivo JSON.
+ * @param nome      O nome do campo.
+ * @param p         Os percentis, em microssegundos.
+ */
+static void escrever_percentis_json(FILE *saida, const char *nome, Percentis *p)
+{
+    fprintf(saida, "      \"%s\": {\"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"max\": %.1f}", nome, p->p50, p->p90,
+            p->p99, p->maximo);
+}
+
+/**
+ * @brief   Escreve o resultado de um caso como um objeto JSON.
+ *
+ * @param saida     O arquivo JSON.
+ * @param arquivo   O arquivo do corpus.
+ * @param motor     O motor medido.
+ * @param r         As medidas.
+ * @param pico_rss  O pico de memória residente, em KiB.
+ */
+static void escrever_caso_json(FILE *saida, ArquivoCorpus *arquivo, Motor motor, ResultadoCaso *r, long pico_rss)
+{
+    double megabytes = (double)r->tamanho_original * r->repeticoes / (1024.0 * 1024.0);
+    fprintf(saida, "    {\n      \"corpus\": ");
+    escrever_string_json(saida, arquivo->nome);
+    fprintf(saida, ",\n      \"motor\": \"%s\",\n", nomes_motores[motor]);
+    fprintf(saida, "      \"correto\": %s,\n", r->correto ? "true" : "false");
+    if(r->erro[0] != '\0')
+    {
+        fprintf(saida, "      \"erro\": ");
+        escrever_string_json(saida, r->erro);
+        fprintf(saida, ",\n");
+    }
+    fprintf(saida, "      \"tamanho_original\": %llu,\n", (unsigned long long)r->tamanho_original);
+    fprintf(saida, "      \"tamanho_comprimido\": %llu,\n", (unsigned long long)r->tamanho_comprimido);
+    fprintf(saida, "      \"razao\": %.4f,\n",
+            r->tamanho_original > 0 ? (double)r->tamanho_comprimido / r->tamanho_original : 0.0);
+    fprintf(saida, "      \"repeticoes\": %d,\n", r->repeticoes);
+    fprintf(saida, "      \"compressao_mb_s\": %.2f,\n",
+            r->segundos_compressao > 0 ? megabytes / r->segundos_compressao : 0.0);
+    fprintf(saida, "      \"descompressao_mb_s\": %.2f,\n",
+            r->segundos_descompressao > 0 ? megabytes / r->segundos_descompressao : 0.0);
+    fprintf(saida, "      \"pico_rss_kib\": %ld,\n", pico_rss);
+    escrever_percentis_json(saida, "latencia_compressao_us", &r->latencia_compressao);
+    fprintf(saida, ",\n");
+    escrever_percentis_json(saida, "latencia_descompressao_us", &r->latencia_descompressao);
+    fprintf(saida, "\n    }");
+}
+
+/**
+ * @brief   Mostra como usar o benchmark e encerra.
+ */
+static void uso()
+{
+    printf("\nUso: benchmark [opções]\n"
+           "  --tamanho MIB       tamanho de cada arquivo do corpus (padrão 8)\n"
+           "  --grande GIB        inclui um arquivo misto desse tamanho (padrão: não inclui)\n"
+           "  --repeticoes N      repetições mínimas de cada caso (padrão %d)\n"
+           "  --threads N         threads dos motores em blocos (padrão: uma por processador)\n"
+           "  --pedido KIB        tamanho de cada chamada da biblioteca (padrão %d)\n"
+           "  --diretorio DIR     onde o corpus é gravado (padrão /tmp)\n"
+           "  --saida ARQUIVO     onde o JSON é gravado (padrão: saída padrão)\n",
+           REPETICOES_PADRAO, TAMANHO_PEDIDO_PADRAO / 1024);
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    Configuracao config = {TAMANHO_CORPUS_PADRAO, 0, REPETICOES_PADRAO, processadores_disponiveis(),
+                           TAMANHO_PEDIDO_PADRAO, "/tmp", NULL};
+    for(int i = 1; i < argc; i++)
+    {
+        if(i + 1 >= argc)
+        {
+            uso();
+        }
+        const char *opcao = argv[i], *valor = argv[++i];
+        if(strcmp(opcao, "--tamanho") == 0)
+        {
+            config.tamanho = strtoull(valor, NULL, 10) * 1024 * 1024;
+        }
+        else if(strcmp(opcao, "--grande") == 0)
+        {
+            config.tamanho_grande = strtoull(valor, NULL, 10) * 1024 * 1024 * 1024;
+        }
+        else if(strcmp(opcao, "--repeticoes") == 0)
+        {
+            config.repeticoes = atoi(valor);
+        }
+        else if(strcmp(opcao, "--threads") == 0)
+        {
+            config.threads = atoi(valor);
+        }
+        else if(strcmp(opcao, "--pedido") == 0)
+        {
+            config.tamanho_pedido = strtoull(valor, NULL, 10) * 1024;
+        }
+        else if(strcmp(opcao, "--diretorio") == 0)
+        {
+            config.diretorio = valor;
+        }
+        else if(strcmp(opcao, "--saida") == 0)
+        {
+            config.saida = valor;
+        }
+        else
+        {
+            uso();
+        }
+    }
+    if(config.tamanho == 0 || config.repeticoes < 1 || config.threads < 1 || config.tamanho_pedido == 0)
+    {
+        uso();
+    }
+
+    ArquivoCorpus corpus[] = {
+        {"texto", CORPUS_TEXTO, config.tamanho, ""},
+        {"logs", CORPUS_LOGS, config.tamanho, ""},
+        {"zeros", CORPUS_ZEROS, config.tamanho, ""},
+        {"aleatorio", CORPUS_ALEATORIO, config.tamanho, ""},
+        {"enviesado", CORPUS_ENVIESADO, config.tamanho, ""},
+        {"pequeno", CORPUS_TEXTO, TAMANHO_CORPUS_PEQUENO, ""},
+        {"grande", CORPUS_MISTO, config.tamanho_grande, ""}
+    };
+    int quantidade_corpus = sizeof(corpus) / sizeof(corpus[0]) - (config.tamanho_grande == 0 ? 1 : 0);
+
+    char diretorio[512];
+    snprintf(diretorio, sizeof(diretorio), "%s/huffman_benchmark_XXXXXX", config.diretorio);
+    if(mkdtemp(diretorio) == NULL)
+    {
+        printf("\nNão foi possível criar o diretório do corpus\n");
+        exit(1);
+    }
+    for(int c = 0; c < quantidade_corpus; c++)
+    {
+        snprintf(corpus[c].caminho, sizeof(corpus[c].caminho), "%s/%s.bin", diretorio, corpus[c].nome);
+        fprintf(stderr, "gerando %s (%llu bytes)\n", corpus[c].nome, (unsigned long long)corpus[c].tamanho);
+        //a semente depende so da posicao no corpus, entao o mesmo arquivo sai igual em toda execucao
+        if(!gravar_corpus(&corpus[c], 0x9E3779B97F4A7C15ULL * (c + 1)))
+        {
+            printf("\nNão foi possível gravar o corpus em %s\n", diretorio);
+            exit(1);
+        }
+    }
+
+    FILE *saida = config.saida != NULL ? fopen(config.saida, "w") : stdout;
+    if(saida == NULL)
+    {
+        printf("\nNão foi possível criar o arquivo de saída\n");
+        exit(1);
+    }
+    fprintf(saida, "{\n  \"versao\": 1,\n  \"processadores\": %d,\n  \"threads\": %d,\n  \"tamanho_pedido\": %zu,\n"
+            "  \"resultados\": [\n", processadores_disponiveis(), config.threads, config.tamanho_pedido);
+    bool primeiro = true, todos_corretos = true;
+    for(int c = 0; c < quantidade_corpus; c++)
+    {
+        for(Motor motor = MOTOR_LEGADO; motor <= MOTOR_INTERCALADO; motor++)
+        {
+            //o arquivo grande nao cabe na memoria de uma vez, entao so os motores de arquivo o medem
+            if(motor == MOTOR_BIBLIOTECA && corpus[c].tipo == CORPUS_MISTO)
+            {
+                continue;
+            }
+            fprintf(stderr, "medindo %s com %s\n", corpus[c].nome, nomes_motores[motor]);
+            ResultadoCaso resultado;
+            long pico_rss;
+            rodar_caso(&config, &corpus[c], motor, &resultado, &pico_rss);
+            todos_corretos = todos_corretos && resultado.correto;
+            fprintf(saida, primeiro ? "" : ",\n");
+            escrever_caso_json(saida, &corpus[c], motor, &resultado, pico_rss);
+            primeiro = false;
+        }
+        remove(corpus[c].caminho);
+    }
+    fprintf(saida, "\n  ]\n}\n");
+    if(saida != stdout)
+    {
+        fclose(saida);
+    }
+    rmdir(diretorio);
+    return todos_corretos ? 0 : 1;
+}
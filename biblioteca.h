@@ -0,0 +1,723 @@
+#ifndef BIBLIOTECA_H
+#define BIBLIOTECA_H
+
+#include "comprimir.h"
+#include "descomprimir.h"
+
+/**
+ * Interface de biblioteca: comprime e descomprime de um buffer para outro, sem arquivos e sem encerrar o programa.
+ * Os erros voltam como códigos. O resultado da compressão é sempre o formato em blocos; a descompressão aceita todos
+ * os formatos. Cada contexto guarda a arena da árvore ou a tabela de decodificação entre as chamadas, então depois
+ * das primeiras chamadas nenhuma memória é alocada. Um contexto só pode ser usado por uma thread de cada vez; threads
+ * diferentes usam contextos diferentes. Cada contexto também pode somar as medidas das chamadas feitas com ele.
+ * Com um dicionário ligado ao contexto, a compressão grava só a identificação dele no lugar dos códigos, e a
+ * descompressão usa a tabela montada uma única vez quando o dicionário foi ligado.
+ */
+
+//codigos de retorno da biblioteca
+#define HUFF_OK 0
+#define HUFF_ERRO_PARAMETRO -1
+#define HUFF_ERRO_DESTINO_PEQUENO -2
+#define HUFF_ERRO_DADOS_INVALIDOS -3
+#define HUFF_ERRO_MEMORIA -4
+#define HUFF_ERRO_TAMANHO_DESCONHECIDO -5
+#define HUFF_ERRO_DICIONARIO -6
+#define HUFF_ERRO_SEM_INDICE -7
+
+//contexto de compressao: as opcoes dos blocos, a arena da arvore de cada bloco, o custo do limite dos codigos na
+//ultima chamada e as medidas das chamadas
+typedef struct contexto_compressao
+{
+    OpcoesCompressao opcoes;
+    ArenaArvore arena;
+    long bits_extras;
+    long bits_codificados;
+    Estatisticas estatisticas;
+} ContextoCompressao;
+
+//contexto de descompressao: a tabela de decodificacao, com as subtabelas que vao sendo reaproveitadas, o dicionario 
+//ligado ao contexto (NULL se nenhum) com a tabela dele, o buffer dos blocos que um intervalo so cobre em parte e as 
+//medidas das chamadas
+typedef struct contexto_descompressao
+{
+    TabelaDecodificacao tabela;
+    const Dicionario *dicionario;
+    TabelaDecodificacao tabela_dicionario;
+    uint8_t *bloco;
+    size_t capacidade_bloco;
+    Estatisticas estatisticas;
+} ContextoDescompressao;
+
+/**
+ * @brief   Descreve um código de retorno da biblioteca.
+ *
+ * @param codigo    O código de retorno.
+ * @return          Uma mensagem curta.
+ */
+const char* huff_mensagem_erro(int codigo)
+{
+    switch(codigo)
+    {
+    case HUFF_OK:
+        return "sucesso";
+    case HUFF_ERRO_PARAMETRO:
+        return "parâmetro inválido";
+    case HUFF_ERRO_DESTINO_PEQUENO:
+        return "o destino não tem espaço suficiente";
+    case HUFF_ERRO_DADOS_INVALIDOS:
+        return "dados comprimidos inválidos";
+    case HUFF_ERRO_MEMORIA:
+        return "memória insuficiente";
+    case HUFF_ERRO_TAMANHO_DESCONHECIDO:
+        return "o formato antigo não guarda o tamanho original";
+    case HUFF_ERRO_DICIONARIO:
+        return "o arquivo foi comprimido com um dicionário que não foi carregado";
+    case HUFF_ERRO_SEM_INDICE:
+        return "só um arquivo em blocos com índice permite descomprimir um intervalo";
+    default:
+        return "erro desconhecido";
+    }
+}
+
+/**
+ * @brief   Cria um contexto de compressão. O formato e o número de threads das opções são ignorados: a biblioteca
+ *          sempre grava o formato em blocos, ou o formato com dicionário se as opções tiverem um, na thread que chama.
+ *
+ * @param opcoes    O tamanho dos blocos, se são canônicos, o limite do tamanho dos códigos e o dicionário, ou NULL
+ *                  para as opções padrão.
+ * @return          O contexto, ou NULL se faltar memória.
+ */
+ContextoCompressao* huff_criar_contexto_compressao(const OpcoesCompressao *opcoes)
+{
+    ContextoCompressao *contexto = (ContextoCompressao*)malloc(sizeof(ContextoCompressao));
+    if(contexto == NULL)
+    {
+        return NULL;
+    }
+    OpcoesCompressao padrao = opcoes_padrao();
+    contexto->opcoes = opcoes_blocos_validas(opcoes != NULL ? opcoes : &padrao);
+    contexto->opcoes.formato = FORMATO_BLOCOS;
+    contexto->opcoes.threads = 1;
+    contexto->opcoes.estatisticas = NULL;
+    contexto->arena.quantidade = 0;
+    contexto->bits_extras = 0;
+    contexto->bits_codificados = 0;
+    zerar_estatisticas(&contexto->estatisticas);
+    return contexto;
+}
+
+/**
+ * @brief   Libera um contexto de compressão.
+ *
+ * @param contexto  O contexto, que pode ser NULL.
+ */
+void huff_destruir_contexto_compressao(ContextoCompressao *contexto)
+{
+    free(contexto);
+}
+
+/**
+ * @brief   O maior tamanho que a compressão de tamanho bytes pode ter com esse contexto: os bytes sem compressão, o
+ *          cabeçalho, o marcador de fim e o rodapé, e o cabeçalho e a entrada do índice de cada bloco. Um destino
+ *          desse tamanho nunca dá HUFF_ERRO_DESTINO_PEQUENO.
+ *
+ * @param contexto  O contexto de compressão.
+ * @param tamanho   A quantidade de bytes a comprimir.
+ * @return          O tamanho máximo do resultado.
+ */
+size_t huff_limite_compressao(const ContextoCompressao *contexto, size_t tamanho)
+{
+    size_t blocos = (tamanho + contexto->opcoes.tamanho_bloco - 1) / contexto->opcoes.tamanho_bloco;
+    return TAMANHO_CABECALHO_BLOCOS + 1 + TAMANHO_RODAPE_BLOCOS +
+           blocos * (TAMANHO_CABECALHO_BLOCO + TAMANHO_ENTRADA_INDICE) + tamanho;
+}
+
+/**
+ * @brief   Comprime um buffer para outro com o dicionário do contexto, bloco a bloco, direto no destino.
+ *
+ * @param contexto          O contexto de compressão, com um dicionário.
+ * @param dados             Os bytes a comprimir.
+ * @param tamanho_origem    A quantidade de bytes.
+ * @param saida             A saída em memória, sobre o destino.
+ * @return                  HUFF_OK ou HUFF_ERRO_DESTINO_PEQUENO.
+ */
+int comprimir_memoria_dicionario(ContextoCompressao *contexto, const uint8_t *dados, size_t tamanho_origem, 
+                                 Saida *saida)
+{
+    Estatisticas *estatisticas = contexto->opcoes.estatisticas;
+    size_t tamanho_bloco = contexto->opcoes.tamanho_bloco;
+    escrever_cabecalho_dicionario(saida, contexto->opcoes.dicionario, tamanho_origem);
+    for(size_t consumidos = 0; consumidos < tamanho_origem && !saida->erro; )
+    {
+        size_t tamanho = tamanho_origem - consumidos < tamanho_bloco ? tamanho_origem - consumidos : tamanho_bloco;
+        comprimir_trecho_dicionario(contexto->opcoes.dicionario, dados + consumidos, tamanho, saida, estatisticas);
+        consumidos += tamanho;
+    }
+    saida_byte(saida, BLOCO_FIM);
+    if(saida->erro)
+    {
+        return HUFF_ERRO_DESTINO_PEQUENO;
+    }
+    ESTATISTICA_SOMAR(estatisticas, bytes_entrada, tamanho_origem);
+    ESTATISTICA_SOMAR(estatisticas, bytes_saida, saida->posicao);
+    ESTATISTICA_SOMAR(estatisticas, bytes_cabecalho, TAMANHO_CABECALHO_BLOCOS + 1);
+    return HUFF_OK;
+}
+
+/**
+ * @brief   Comprime um buffer para outro no formato em blocos, com índice. Cada bloco é comprimido direto no
+ *          destino; um bloco que não diminui é copiado sem compressão. Com um dicionário no contexto, o resultado é o
+ *          formato com dicionário, sem índice.
+ *
+ * @param contexto          O contexto de compressão.
+ * @param origem            Os bytes a comprimir.
+ * @param tamanho_origem    A quantidade de bytes.
+ * @param destino           Onde o resultado é gravado.
+ * @param capacidade        Quantos bytes cabem no destino; huff_limite_compressao sempre basta.
+ * @param tamanho_destino   Recebe o tamanho do resultado.
+ * @return                  HUFF_OK ou um código de erro.
+ */
+int huff_comprimir(ContextoCompressao *contexto, const void *origem, size_t tamanho_origem, void *destino,
+                   size_t capacidade, size_t *tamanho_destino)
+{
+    if(contexto == NULL || (origem == NULL && tamanho_origem > 0) || destino == NULL || tamanho_destino == NULL)
+    {
+        return HUFF_ERRO_PARAMETRO;
+    }
+    const uint8_t *dados = (const uint8_t*)origem;
+    uint8_t *resultado = (uint8_t*)destino;
+    size_t tamanho_bloco = contexto->opcoes.tamanho_bloco;
+    Estatisticas *estatisticas = contexto->opcoes.estatisticas;
+    Saida saida;
+    saida_memoria(&saida, resultado, capacidade);
+    contexto->bits_extras = 0;
+    contexto->bits_codificados = 0;
+    if(contexto->opcoes.dicionario != NULL)
+    {
+        int codigo = comprimir_memoria_dicionario(contexto, dados, tamanho_origem, &saida);
+        if(codigo == HUFF_OK)
+        {
+            *tamanho_destino = saida.posicao;
+        }
+        return codigo;
+    }
+    escrever_cabecalho_blocos(&saida, contexto->opcoes.limite_codigo, tamanho_bloco, tamanho_origem);
+
+    for(size_t consumidos = 0; consumidos < tamanho_origem && !saida.erro; )
+    {
+        size_t tamanho = tamanho_origem - consumidos < tamanho_bloco ? tamanho_origem - consumidos : tamanho_bloco;
+        if(capacidade - saida.posicao < TAMANHO_CABECALHO_BLOCO)
+        {
+            return HUFF_ERRO_DESTINO_PEQUENO;
+        }
+        //o conteudo vai direto para depois do cabecalho do bloco, que e escrito quando o tamanho dele for conhecido
+        size_t quadro = saida.posicao;
+        Saida conteudo;
+        saida_memoria(&conteudo, resultado + quadro + TAMANHO_CABECALHO_BLOCO,
+                      capacidade - quadro - TAMANHO_CABECALHO_BLOCO);
+        long bits_extras;
+        uint8_t tipo;
+        if(!comprimir_bloco(dados + consumidos, tamanho, contexto->opcoes.canonico, contexto->opcoes.fluxos,
+                            contexto->opcoes.limite_codigo, &bits_extras, &tipo, &contexto->arena, &conteudo,
+                            estatisticas))
+        {
+            return conteudo.erro ? HUFF_ERRO_DESTINO_PEQUENO : HUFF_ERRO_PARAMETRO;
+        }
+        if(tipo == BLOCO_BRUTO && !saida_escrever(&conteudo, dados + consumidos, tamanho))
+        {
+            return HUFF_ERRO_DESTINO_PEQUENO;
+        }
+        saida_byte(&saida, tipo);
+        saida_u32(&saida, (uint32_t)tamanho);
+        saida_u32(&saida, (uint32_t)conteudo.posicao);
+        saida.posicao += conteudo.posicao;
+        consumidos += tamanho;
+        contexto->bits_extras += bits_extras;
+        registrar_bloco(estatisticas, numero_thread_pool);
+    }
+    saida_byte(&saida, BLOCO_FIM);
+
+    //o indice e montado percorrendo os blocos ja gravados no destino
+    uint64_t deslocamento_indice = saida.posicao, quantidade_blocos = 0;
+    for(size_t quadro = TAMANHO_CABECALHO_BLOCOS; !saida.erro && resultado[quadro] != BLOCO_FIM; )
+    {
+        IndiceBloco bloco;
+        uint32_t tamanho_conteudo = ler_u32(resultado + quadro + 5);
+        const uint8_t *conteudo = resultado + quadro + TAMANHO_CABECALHO_BLOCO;
+        bloco.deslocamento = quadro;
+        bloco.bits = (uint64_t)tamanho_conteudo * 8 - (resultado[quadro] == BLOCO_BRUTO ? 0 : conteudo[0] >> 5);
+        bloco.tamanho_original = ler_u32(resultado + quadro + 1);
+        escrever_entrada_indice(&saida, &bloco);
+        contexto->bits_codificados += (long)bloco.bits;
+        quantidade_blocos++;
+        quadro += TAMANHO_CABECALHO_BLOCO + tamanho_conteudo;
+    }
+    escrever_rodape_blocos(&saida, quantidade_blocos, deslocamento_indice, tamanho_origem);
+    if(saida.erro)
+    {
+        return HUFF_ERRO_DESTINO_PEQUENO;
+    }
+    ESTATISTICA_SOMAR(estatisticas, bytes_entrada, tamanho_origem);
+    ESTATISTICA_SOMAR(estatisticas, bytes_saida, saida.posicao);
+    ESTATISTICA_SOMAR(estatisticas, bytes_cabecalho, TAMANHO_CABECALHO_BLOCOS + 1 + TAMANHO_RODAPE_BLOCOS +
+                      quantidade_blocos * (TAMANHO_CABECALHO_BLOCO + TAMANHO_ENTRADA_INDICE));
+    *tamanho_destino = saida.posicao;
+    return HUFF_OK;
+}
+
+/**
+ * @brief   O custo do limite do tamanho dos códigos na última compressão feita com o contexto: quantos bits o
+ *          resultado tem a mais do que teria sem o limite, e quantos bits os blocos têm ao todo.
+ *
+ * @param contexto          O contexto de compressão.
+ * @param bits_extras       Recebe os bits a mais; 0 sem limite ou com dicionário.
+ * @param bits_codificados  Recebe os bits de todos os blocos.
+ */
+void huff_custo_limite(const ContextoCompressao *contexto, long *bits_extras, long *bits_codificados)
+{
+    *bits_extras = contexto->bits_extras;
+    *bits_codificados = contexto->bits_codificados;
+}
+
+/**
+ * @brief   Liga ou desliga as medidas das compressões feitas com o contexto. Ligar zera as medidas anteriores.
+ *
+ * @param contexto  O contexto de compressão.
+ * @param medir     true para medir as próximas chamadas.
+ */
+void huff_medir_compressao(ContextoCompressao *contexto, bool medir)
+{
+    if(medir)
+    {
+        zerar_estatisticas(&contexto->estatisticas);
+    }
+    contexto->opcoes.estatisticas = medir ? &contexto->estatisticas : NULL;
+}
+
+/**
+ * @brief   As medidas somadas desde que huff_medir_compressao ligou as medidas do contexto.
+ *
+ * @param contexto  O contexto de compressão.
+ * @return          As medidas, que continuam pertencendo ao contexto.
+ */
+const Estatisticas* huff_estatisticas_compressao(const ContextoCompressao *contexto)
+{
+    return &contexto->estatisticas;
+}
+
+/**
+ * @brief   Cria um contexto de descompressão.
+ *
+ * @return  O contexto, ou NULL se faltar memória.
+ */
+ContextoDescompressao* huff_criar_contexto_descompressao()
+{
+    ContextoDescompressao *contexto = (ContextoDescompressao*)malloc(sizeof(ContextoDescompressao));
+    if(contexto != NULL)
+    {
+        iniciar_tabela_decodificacao(&contexto->tabela);
+        iniciar_tabela_decodificacao(&contexto->tabela_dicionario);
+        contexto->dicionario = NULL;
+        contexto->bloco = NULL;
+        contexto->capacidade_bloco = 0;
+        zerar_estatisticas(&contexto->estatisticas);
+    }
+    return contexto;
+}
+
+/**
+ * @brief   Liga ou desliga as medidas das descompressões feitas com o contexto. Ligar zera as medidas anteriores.
+ *
+ * @param contexto  O contexto de descompressão.
+ * @param medir     true para medir as próximas chamadas.
+ */
+void huff_medir_descompressao(ContextoDescompressao *contexto, bool medir)
+{
+    if(medir)
+    {
+        zerar_estatisticas(&contexto->estatisticas);
+    }
+    contexto->tabela.estatisticas = medir ? &contexto->estatisticas : NULL;
+    contexto->tabela_dicionario.estatisticas = contexto->tabela.estatisticas;
+}
+
+/**
+ * @brief   As medidas somadas desde que huff_medir_descompressao ligou as medidas do contexto.
+ *
+ * @param contexto  O contexto de descompressão.
+ * @return          As medidas, que continuam pertencendo ao contexto.
+ */
+const Estatisticas* huff_estatisticas_descompressao(const ContextoDescompressao *contexto)
+{
+    return &contexto->estatisticas;
+}
+
+/**
+ * @brief   Libera um contexto de descompressão, as subtabelas guardadas nele, inclusive as do dicionário, e o buffer 
+ *          dos intervalos.
+ *
+ * @param contexto  O contexto, que pode ser NULL.
+ */
+void huff_destruir_contexto_descompressao(ContextoDescompressao *contexto)
+{
+    if(contexto != NULL)
+    {
+        free_tabela_decodificacao(&contexto->tabela);
+        free_tabela_decodificacao(&contexto->tabela_dicionario);
+        free(contexto->bloco);
+        free(contexto);
+    }
+}
+
+/**
+ * @brief   Treina um dicionário com as frequências dos bytes de várias amostras, que devem ser parecidas com os
+ *          arquivos que serão comprimidos com ele.
+ *
+ * @param amostras      Os bytes de cada amostra.
+ * @param tamanhos      O tamanho de cada amostra.
+ * @param quantidade    A quantidade de amostras.
+ * @param limite        O maior tamanho de código, 0 para o padrão.
+ * @param dicionario    Recebe o dicionário.
+ * @return              HUFF_OK ou HUFF_ERRO_PARAMETRO.
+ */
+int huff_treinar_dicionario(const void *const *amostras, const size_t *tamanhos, size_t quantidade, int limite, 
+                            Dicionario *dicionario)
+{
+    if((quantidade > 0 && (amostras == NULL || tamanhos == NULL)) || dicionario == NULL)
+    {
+        return HUFF_ERRO_PARAMETRO;
+    }
+    long frequencia[Max_table];
+    memset(frequencia, 0, sizeof(frequencia));
+    for(size_t i = 0; i < quantidade; i++)
+    {
+        if(amostras[i] == NULL && tamanhos[i] > 0)
+        {
+            return HUFF_ERRO_PARAMETRO;
+        }
+        histograma_bytes((const uint8_t*)amostras[i], tamanhos[i], frequencia);
+    }
+    treinar_dicionario(frequencia, limite, dicionario);
+    return HUFF_OK;
+}
+
+/**
+ * @brief   Grava um dicionário num buffer, no formato do arquivo de dicionário.
+ *
+ * @param dicionario        O dicionário.
+ * @param destino           Onde o dicionário é gravado.
+ * @param capacidade        Quantos bytes cabem no destino; TAMANHO_MAXIMO_DICIONARIO sempre basta.
+ * @param tamanho_destino   Recebe o tamanho gravado.
+ * @return                  HUFF_OK ou um código de erro.
+ */
+int huff_gravar_dicionario(const Dicionario *dicionario, void *destino, size_t capacidade, size_t *tamanho_destino)
+{
+    if(dicionario == NULL || destino == NULL || tamanho_destino == NULL)
+    {
+        return HUFF_ERRO_PARAMETRO;
+    }
+    Saida saida;
+    saida_memoria(&saida, (uint8_t*)destino, capacidade);
+    escrever_dicionario(&saida, dicionario);
+    if(saida.erro)
+    {
+        return HUFF_ERRO_DESTINO_PEQUENO;
+    }
+    *tamanho_destino = saida.posicao;
+    return HUFF_OK;
+}
+
+/**
+ * @brief   Lê um dicionário gravado por huff_gravar_dicionario.
+ *
+ * @param origem        Os bytes do dicionário.
+ * @param tamanho       A quantidade de bytes.
+ * @param dicionario    Recebe o dicionário.
+ * @return              HUFF_OK ou HUFF_ERRO_DADOS_INVALIDOS.
+ */
+int huff_ler_dicionario(const void *origem, size_t tamanho, Dicionario *dicionario)
+{
+    if(origem == NULL || dicionario == NULL)
+    {
+        return HUFF_ERRO_PARAMETRO;
+    }
+    return ler_dicionario((const uint8_t*)origem, tamanho, dicionario) ? HUFF_OK : HUFF_ERRO_DADOS_INVALIDOS;
+}
+
+/**
+ * @brief   Liga um dicionário ao contexto de compressão: as próximas compressões usam o formato com dicionário. O
+ *          dicionário precisa existir enquanto o contexto o usar.
+ *
+ * @param contexto      O contexto de compressão.
+ * @param dicionario    O dicionário, ou NULL para voltar ao formato em blocos.
+ * @return              HUFF_OK ou HUFF_ERRO_PARAMETRO.
+ */
+int huff_usar_dicionario_compressao(ContextoCompressao *contexto, const Dicionario *dicionario)
+{
+    if(contexto == NULL)
+    {
+        return HUFF_ERRO_PARAMETRO;
+    }
+    contexto->opcoes.dicionario = dicionario;
+    return HUFF_OK;
+}
+
+/**
+ * @brief   Liga um dicionário ao contexto de descompressão e monta a tabela dele uma única vez, para todos os
+ *          arquivos comprimidos com ele. O dicionário precisa existir enquanto o contexto o usar.
+ *
+ * @param contexto      O contexto de descompressão.
+ * @param dicionario    O dicionário, ou NULL para desligar.
+ * @return              HUFF_OK ou um código de erro.
+ */
+int huff_usar_dicionario_descompressao(ContextoDescompressao *contexto, const Dicionario *dicionario)
+{
+    if(contexto == NULL)
+    {
+        return HUFF_ERRO_PARAMETRO;
+    }
+    contexto->dicionario = NULL;
+    if(dicionario != NULL && !montar_tabela_canonica(&contexto->tabela_dicionario, dicionario->tamanhos))
+    {
+        return HUFF_ERRO_MEMORIA;
+    }
+    contexto->dicionario = dicionario;
+    return HUFF_OK;
+}
+
+/**
+ * @brief   Lê de um arquivo em blocos o tamanho que ele tem descomprimido, para o destino ser alocado antes de
+ *          descomprimir: do cabeçalho, se ele tiver o tamanho, ou do rodapé.
+ *
+ * @param origem            Os bytes comprimidos.
+ * @param tamanho_origem    A quantidade de bytes.
+ * @param tamanho_original  Recebe o tamanho descomprimido.
+ * @return                  HUFF_OK, HUFF_ERRO_TAMANHO_DESCONHECIDO para o formato antigo, o fluxo adaptativo e um
+ *                          arquivo com dicionário comprimido de um pipe, ou HUFF_ERRO_DADOS_INVALIDOS.
+ */
+int huff_tamanho_original(const void *origem, size_t tamanho_origem, uint64_t *tamanho_original)
+{
+    const uint8_t *dados = (const uint8_t*)origem;
+    if((origem == NULL && tamanho_origem > 0) || tamanho_original == NULL)
+    {
+        return HUFF_ERRO_PARAMETRO;
+    }
+    if(!formato_blocos(dados, tamanho_origem))
+    {
+        return HUFF_ERRO_TAMANHO_DESCONHECIDO;
+    }
+    size_t tamanho_cabecalho = tamanho_cabecalho_blocos(dados);
+    if(tamanho_cabecalho == 0 || tamanho_origem < tamanho_cabecalho)
+    {
+        return HUFF_ERRO_DADOS_INVALIDOS;
+    }
+    if(tamanho_original_cabecalho(dados) != TAMANHO_DESCONHECIDO)
+    {
+        *tamanho_original = tamanho_original_cabecalho(dados);
+        return HUFF_OK;
+    }
+    if(fluxo_adaptativo(dados, tamanho_origem) || fluxo_dicionario(dados, tamanho_origem))
+    {
+        return HUFF_ERRO_TAMANHO_DESCONHECIDO;
+    }
+    if(!(dados[4] & FLAG_INDICE_BLOCOS) || tamanho_origem < tamanho_cabecalho + 1 + TAMANHO_RODAPE_BLOCOS)
+    {
+        return HUFF_ERRO_DADOS_INVALIDOS;
+    }
+    const uint8_t *rodape = dados + tamanho_origem - TAMANHO_RODAPE_BLOCOS;
+    if(memcmp(rodape + 24, MAGICO_BLOCOS, 3) != 0 || rodape[27] != dados[3])
+    {
+        return HUFF_ERRO_DADOS_INVALIDOS;
+    }
+    *tamanho_original = ler_u64(rodape + 16);
+    return HUFF_OK;
+}
+
+/**
+ * @brief   Verifica se o dicionário ligado ao contexto é o dicionário com que um arquivo foi comprimido.
+ *
+ * @param contexto      O contexto de descompressão.
+ * @param cabecalho     O cabeçalho de um arquivo comprimido com dicionário.
+ * @return              true se o contexto tem esse dicionário.
+ */
+bool dicionario_confere(const ContextoDescompressao *contexto, const uint8_t *cabecalho)
+{
+    return contexto->dicionario != NULL && contexto->dicionario->id == id_dicionario_cabecalho(cabecalho);
+}
+
+/**
+ * @brief   Descomprime um buffer no formato antigo, em blocos, adaptativo ou com dicionário para outro. O destino é
+ *          preenchido direto, bloco a bloco, e a tabela do contexto é reaproveitada por todos os blocos.
+ *
+ * @param contexto          O contexto de descompressão.
+ * @param origem            Os bytes comprimidos.
+ * @param tamanho_origem    A quantidade de bytes.
+ * @param destino           Onde o resultado é gravado.
+ * @param capacidade        Quantos bytes cabem no destino; huff_tamanho_original diz quanto é preciso.
+ * @param tamanho_destino   Recebe o tamanho do resultado.
+ * @return                  HUFF_OK ou um código de erro.
+ */
+int huff_descomprimir(ContextoDescompressao *contexto, const void *origem, size_t tamanho_origem, void *destino,
+                      size_t capacidade, size_t *tamanho_destino)
+{
+    if(contexto == NULL || origem == NULL || (destino == NULL && capacidade > 0) || tamanho_destino == NULL)
+    {
+        return HUFF_ERRO_PARAMETRO;
+    }
+    Entrada entrada;
+    Saida saida;
+    entrada_memoria(&entrada, (const uint8_t*)origem, tamanho_origem);
+    saida_memoria(&saida, (uint8_t*)destino, capacidade);
+
+    bool valido;
+    if(fluxo_adaptativo((const uint8_t*)origem, tamanho_origem))
+    {
+        valido = descomprimir_adaptativo(&entrada, &contexto->tabela, &saida);
+    }
+    else if(fluxo_dicionario((const uint8_t*)origem, tamanho_origem))
+    {
+        if(!dicionario_confere(contexto, (const uint8_t*)origem))
+        {
+            return HUFF_ERRO_DICIONARIO;
+        }
+        uint64_t tamanho_original;
+        if(huff_tamanho_original(origem, tamanho_origem, &tamanho_original) == HUFF_OK &&
+           tamanho_original > capacidade)
+        {
+            return HUFF_ERRO_DESTINO_PEQUENO;
+        }
+        valido = descomprimir_dicionario(&entrada, &contexto->tabela_dicionario, &saida);
+    }
+    else if(formato_blocos((const uint8_t*)origem, tamanho_origem))
+    {
+        //com o tamanho no rodape, um destino pequeno e detectado antes de descomprimir qualquer bloco
+        uint64_t tamanho_original;
+        if(huff_tamanho_original(origem, tamanho_origem, &tamanho_original) == HUFF_OK &&
+           tamanho_original > capacidade)
+        {
+            return HUFF_ERRO_DESTINO_PEQUENO;
+        }
+        valido = descomprimir_blocos(&entrada, &contexto->tabela, &saida);
+    }
+    else
+    {
+        valido = descomprimir_legado(&entrada, &contexto->tabela, &saida);
+    }
+    //numa saida de capacidade fixa o unico erro possivel e faltar espaco
+    if(saida.erro)
+    {
+        return HUFF_ERRO_DESTINO_PEQUENO;
+    }
+    if(!valido)
+    {
+        return HUFF_ERRO_DADOS_INVALIDOS;
+    }
+    ESTATISTICA_SOMAR(contexto->tabela.estatisticas, bytes_entrada, tamanho_origem);
+    ESTATISTICA_SOMAR(contexto->tabela.estatisticas, bytes_saida, saida.posicao);
+    *tamanho_destino = saida.posicao;
+    return HUFF_OK;
+}
+
+/**
+ * @brief   Descomprime só os bytes [deslocamento, deslocamento + quantidade) do original, a partir de um arquivo em
+ *          blocos com índice que está na memória. O índice diz quais blocos cobrem o intervalo, e só esses são
+ *          descomprimidos: os que estão inteiros no intervalo vão direto para o destino, e os das pontas passam pelo
+ *          buffer do contexto, que só cresce.
+ *
+ * @param contexto          O contexto de descompressão.
+ * @param origem            Os bytes comprimidos.
+ * @param tamanho_origem    A quantidade de bytes.
+ * @param deslocamento      A posição do primeiro byte desejado no original.
+ * @param quantidade        Quantos bytes são desejados; o destino precisa ter espaço para todos.
+ * @param destino           Onde os bytes do intervalo são gravados.
+ * @param tamanho_destino   Recebe quantos bytes foram gravados, menos que quantidade se o intervalo passar do fim.
+ * @return                  HUFF_OK ou um código de erro.
+ */
+int huff_descomprimir_intervalo(ContextoDescompressao *contexto, const void *origem, size_t tamanho_origem,
+                                uint64_t deslocamento, size_t quantidade, void *destino, size_t *tamanho_destino)
+{
+    const uint8_t *dados = (const uint8_t*)origem;
+    uint8_t *resultado = (uint8_t*)destino;
+    if(contexto == NULL || origem == NULL || (destino == NULL && quantidade > 0) || tamanho_destino == NULL)
+    {
+        return HUFF_ERRO_PARAMETRO;
+    }
+    if(!formato_blocos(dados, tamanho_origem) || !(dados[4] & FLAG_INDICE_BLOCOS))
+    {
+        return HUFF_ERRO_SEM_INDICE;
+    }
+    size_t tamanho_cabecalho = tamanho_cabecalho_blocos(dados);
+    if(tamanho_cabecalho == 0 || tamanho_origem < tamanho_cabecalho + 1 + TAMANHO_RODAPE_BLOCOS)
+    {
+        return HUFF_ERRO_DADOS_INVALIDOS;
+    }
+    const uint8_t *rodape = dados + tamanho_origem - TAMANHO_RODAPE_BLOCOS;
+    uint64_t n = ler_u64(rodape), deslocamento_indice = ler_u64(rodape + 8);
+    uint64_t fim_indice = tamanho_origem - TAMANHO_RODAPE_BLOCOS;
+    if(memcmp(rodape + 24, MAGICO_BLOCOS, 3) != 0 || rodape[27] != dados[3] ||
+       deslocamento_indice < tamanho_cabecalho + 1 || deslocamento_indice > fim_indice ||
+       (fim_indice - deslocamento_indice) / TAMANHO_ENTRADA_INDICE != n ||
+       (fim_indice - deslocamento_indice) % TAMANHO_ENTRADA_INDICE != 0)
+    {
+        return HUFF_ERRO_DADOS_INVALIDOS;
+    }
+
+    //as entradas sao lidas direto do indice, conferidas uma a uma como em ler_indice_blocos, sem alocar o indice
+    uint64_t comeco_bloco = 0, minimo = tamanho_cabecalho;
+    size_t escritos = 0;
+    for(uint64_t k = 0; k < n && escritos < quantidade; k++)
+    {
+        const uint8_t *entrada = dados + deslocamento_indice + k * TAMANHO_ENTRADA_INDICE;
+        IndiceBloco bloco;
+        bloco.deslocamento = ler_u64(entrada);
+        bloco.bits = ler_u64(entrada + 8);
+        bloco.tamanho_original = ler_u32(entrada + 16);
+        uint64_t tamanho_comprimido = (bloco.bits + 7) / 8;
+        if(bloco.deslocamento < minimo || tamanho_comprimido < 1 || tamanho_comprimido > deslocamento_indice ||
+           bloco.deslocamento + TAMANHO_CABECALHO_BLOCO + tamanho_comprimido > deslocamento_indice ||
+           bloco.tamanho_original > TAMANHO_BLOCO_MAXIMO)
+        {
+            return HUFF_ERRO_DADOS_INVALIDOS;
+        }
+        minimo = bloco.deslocamento + TAMANHO_CABECALHO_BLOCO + tamanho_comprimido;
+        uint64_t fim_bloco = comeco_bloco + bloco.tamanho_original, desejado = deslocamento + escritos;
+        //o bloco so interessa se o proximo byte desejado estiver nele
+        if(desejado >= comeco_bloco && desejado < fim_bloco)
+        {
+            const uint8_t *quadro = dados + bloco.deslocamento;
+            size_t de = (size_t)(desejado - comeco_bloco);
+            size_t copiar = fim_bloco - desejado < quantidade - escritos ? (size_t)(fim_bloco - desejado) :
+                            quantidade - escritos;
+            bool inteiro = copiar == bloco.tamanho_original;
+            if(!inteiro && contexto->capacidade_bloco < bloco.tamanho_original)
+            {
+                uint8_t *novo = (uint8_t*)realloc(contexto->bloco, bloco.tamanho_original);
+                if(novo == NULL)
+                {
+                    return HUFF_ERRO_MEMORIA;
+                }
+                contexto->bloco = novo;
+                contexto->capacidade_bloco = bloco.tamanho_original;
+            }
+            Saida saida;
+            saida_memoria(&saida, inteiro ? resultado + escritos : contexto->bloco, bloco.tamanho_original);
+            if(!bloco_confere_indice(quadro, &bloco) ||
+               !descomprimir_bloco(quadro[0], quadro + TAMANHO_CABECALHO_BLOCO, (size_t)tamanho_comprimido,
+                                   bloco.tamanho_original, &contexto->tabela, &saida))
+            {
+                return HUFF_ERRO_DADOS_INVALIDOS;
+            }
+            if(!inteiro)
+            {
+                memcpy(resultado + escritos, contexto->bloco + de, copiar);
+            }
+            escritos += copiar;
+        }
+        comeco_bloco = fim_bloco;
+    }
+    ESTATISTICA_SOMAR(contexto->tabela.estatisticas, bytes_saida, escritos);
+    *tamanho_destino = escritos;
+    return HUFF_OK;
+}
+
+#endif
@@ -0,0 +1,225 @@
+#ifndef BUFFER_ENTRADA_H
+#define BUFFER_ENTRADA_H
+
+#include "structs_huffman.h"
+#include "estatisticas.h"
+
+/**
+ * Origem de bytes usada pelo descompressor. Os bytes de um arquivo são lidos em trechos grandes para um buffer, e quem
+ * lê consome direto do buffer. Quando a origem é a memória o próprio buffer é a origem e não há leituras.
+ */
+typedef struct entrada
+{
+    FILE *arquivo;
+    uint8_t *buffer;
+    size_t capacidade;
+    size_t inicio;
+    size_t fim;
+    bool acabou;
+    bool erro;
+    Estatisticas *estatisticas;
+} Entrada;
+
+/**
+ * @brief   Prepara uma entrada que lê de um arquivo já aberto.
+ *
+ * @param entrada       A entrada que será preparada.
+ * @param arquivo       O arquivo de origem.
+ * @param capacidade    O tamanho do buffer de leitura.
+ * @return              true se o buffer foi alocado.
+ */
+bool entrada_arquivo(Entrada *entrada, FILE *arquivo, size_t capacidade)
+{
+    entrada->arquivo = arquivo;
+    entrada->buffer = (uint8_t*)malloc(capacidade);
+    entrada->capacidade = capacidade;
+    entrada->inicio = 0;
+    entrada->fim = 0;
+    entrada->acabou = false;
+    entrada->erro = entrada->buffer == NULL;
+    entrada->estatisticas = NULL;
+    return !entrada->erro;
+}
+
+/**
+ * @brief   Prepara uma entrada que lê de uma região de memória. Todos os bytes já estão disponíveis.
+ *
+ * @param entrada   A entrada que será preparada.
+ * @param dados     Os bytes de origem.
+ * @param tamanho   A quantidade de bytes.
+ */
+void entrada_memoria(Entrada *entrada, const uint8_t *dados, size_t tamanho)
+{
+    entrada->arquivo = NULL;
+    entrada->buffer = (uint8_t*)dados;
+    entrada->capacidade = tamanho;
+    entrada->inicio = 0;
+    entrada->fim = tamanho;
+    entrada->acabou = true;
+    entrada->erro = false;
+    entrada->estatisticas = NULL;
+}
+
+/**
+ * @brief   Os bytes disponíveis no buffer, a partir do primeiro ainda não consumido.
+ *
+ * @param entrada   A entrada.
+ * @return          Um ponteiro para o primeiro byte disponível.
+ */
+static inline const uint8_t* entrada_dados(Entrada *entrada)
+{
+    return entrada->buffer + entrada->inicio;
+}
+
+/**
+ * @brief   Quantos bytes estão disponíveis no buffer.
+ *
+ * @param entrada   A entrada.
+ * @return          A quantidade de bytes disponíveis.
+ */
+static inline size_t entrada_disponivel(Entrada *entrada)
+{
+    return entrada->fim - entrada->inicio;
+}
+
+/**
+ * @brief   Marca os n primeiros bytes disponíveis como consumidos.
+ *
+ * @param entrada   A entrada.
+ * @param n         A quantidade de bytes consumidos.
+ */
+static inline void entrada_avancar(Entrada *entrada, size_t n)
+{
+    entrada->inicio += n;
+}
+
+/**
+ * @brief   Move os bytes não consumidos para o começo do buffer e completa o buffer com o arquivo. Se forem pedidos
+ *          mais bytes do que cabem, o buffer cresce. Em memória não faz nada.
+ *
+ * @param entrada   A entrada.
+ * @param minimo    Quantos bytes precisam ficar disponíveis, se o arquivo tiver.
+ * @return          A quantidade de bytes disponíveis depois da leitura.
+ */
+size_t entrada_carregar(Entrada *entrada, size_t minimo)
+{
+    if(entrada->arquivo == NULL || entrada->acabou || entrada->erro)
+    {
+        return entrada_disponivel(entrada);
+    }
+    size_t disponiveis = entrada_disponivel(entrada);
+    memmove(entrada->buffer, entrada->buffer + entrada->inicio, disponiveis);
+    entrada->inicio = 0;
+    entrada->fim = disponiveis;
+    if(minimo > entrada->capacidade)
+    {
+        uint8_t *novo = (uint8_t*)realloc(entrada->buffer, minimo);
+        if(novo == NULL)
+        {
+            entrada->erro = true;
+            return disponiveis;
+        }
+        entrada->buffer = novo;
+        entrada->capacidade = minimo;
+        ESTATISTICA_SOMAR(entrada->estatisticas, alocacoes, 1);
+    }
+    uint64_t marca = iniciar_entrada_saida(entrada->estatisticas);
+    size_t lidos = fread(entrada->buffer + entrada->fim, 1, entrada->capacidade - entrada->fim, entrada->arquivo);
+    terminar_entrada_saida(entrada->estatisticas, FASE_LEITURA, marca);
+    ESTATISTICA_SOMAR(entrada->estatisticas, bytes_entrada, lidos);
+    entrada->fim += lidos;
+    if(entrada->fim < entrada->capacidade)
+    {
+        entrada->acabou = true;
+        entrada->erro = ferror(entrada->arquivo) != 0;
+    }
+    return entrada_disponivel(entrada);
+}
+
+/**
+ * @brief   Garante que pelo menos minimo bytes estejam disponíveis, lendo do arquivo só o que falta. Ao contrário de
+ *          entrada_carregar, não espera o buffer encher, então num pipe volta assim que os bytes pedidos chegam.
+ *
+ * @param entrada   A entrada.
+ * @param minimo    Quantos bytes precisam ficar disponíveis, se o arquivo tiver.
+ * @return          A quantidade de bytes disponíveis depois da leitura.
+ */
+size_t entrada_garantir(Entrada *entrada, size_t minimo)
+{
+    size_t disponiveis = entrada_disponivel(entrada);
+    if(disponiveis >= minimo || entrada->arquivo == NULL || entrada->acabou || entrada->erro)
+    {
+        return disponiveis;
+    }
+    if(entrada->capacidade - entrada->inicio < minimo)
+    {
+        memmove(entrada->buffer, entrada->buffer + entrada->inicio, disponiveis);
+        entrada->inicio = 0;
+        entrada->fim = disponiveis;
+    }
+    if(minimo > entrada->capacidade)
+    {
+        uint8_t *novo = (uint8_t*)realloc(entrada->buffer, minimo);
+        if(novo == NULL)
+        {
+            entrada->erro = true;
+            return disponiveis;
+        }
+        entrada->buffer = novo;
+        entrada->capacidade = minimo;
+        ESTATISTICA_SOMAR(entrada->estatisticas, alocacoes, 1);
+    }
+    size_t pedidos = minimo - disponiveis;
+    uint64_t marca = iniciar_entrada_saida(entrada->estatisticas);
+    size_t lidos = fread(entrada->buffer + entrada->fim, 1, pedidos, entrada->arquivo);
+    terminar_entrada_saida(entrada->estatisticas, FASE_LEITURA, marca);
+    ESTATISTICA_SOMAR(entrada->estatisticas, bytes_entrada, lidos);
+    entrada->fim += lidos;
+    if(lidos < pedidos)
+    {
+        entrada->acabou = true;
+        entrada->erro = ferror(entrada->arquivo) != 0;
+    }
+    return entrada_disponivel(entrada);
+}
+
+/**
+ * @brief   Libera o buffer de uma entrada de arquivo. Em memória os bytes continuam com quem chamou.
+ *
+ * @param entrada   A entrada.
+ */
+void entrada_finalizar(Entrada *entrada)
+{
+    if(entrada->arquivo != NULL)
+    {
+        free(entrada->buffer);
+    }
+    entrada->buffer = NULL;
+    entrada->capacidade = 0;
+    entrada->inicio = 0;
+    entrada->fim = 0;
+}
+
+/**
+ * @brief   Lê um inteiro de 32 bits gravado do byte mais significativo para o menos significativo.
+ *
+ * @param p     Os 4 bytes.
+ * @return      O inteiro.
+ */
+static inline uint32_t ler_u32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+/**
+ * @brief   Lê um inteiro de 64 bits gravado do byte mais significativo para o menos significativo.
+ *
+ * @param p     Os 8 bytes.
+ * @return      O inteiro.
+ */
+static inline uint64_t ler_u64(const uint8_t *p)
+{
+    return ((uint64_t)ler_u32(p) << 32) | ler_u32(p + 4);
+}
+
+#endif
@@ -0,0 +1,304 @@
+#ifndef BUFFER_SAIDA_H
+#define BUFFER_SAIDA_H
+
+#include "structs_huffman.h"
+#include "estatisticas.h"
+
+//limites do buffer de saida em arquivo, o tamanho pedido e ajustado para ficar dentro deles
+#define TAMANHO_BUFFER_SAIDA_MINIMO (256 * 1024)
+#define TAMANHO_BUFFER_SAIDA_PADRAO (1024 * 1024)
+#define TAMANHO_BUFFER_SAIDA_MAXIMO (4 * 1024 * 1024)
+//os buffers proprios sao alinhados em pagina
+#define ALINHAMENTO_BUFFER_SAIDA 4096
+
+/**
+ * Destino de bytes usado pelo compressor e pelo descompressor. Os bytes vão sendo acumulados em um buffer grande e,
+ * quando o destino é um arquivo, cada descarga é uma única escrita. Quando o destino é a memória o próprio buffer é o
+ * destino: ou ele tem capacidade fixa (erro ao encher) ou cresce com realloc.
+ */
+typedef struct saida
+{
+    uint8_t *buffer;
+    size_t capacidade;
+    size_t posicao;
+    FILE *arquivo;
+    bool crescer;
+    uint64_t descarregados;
+    bool erro;
+    Estatisticas *estatisticas;
+} Saida;
+
+/**
+ * @brief   Aloca um bloco de memória alinhado em ALINHAMENTO_BUFFER_SAIDA.
+ *
+ * @param tamanho   O tamanho em bytes, múltiplo do alinhamento.
+ * @return          O bloco alocado, ou NULL.
+ */
+void* alocar_alinhado(size_t tamanho)
+{
+#ifdef _WIN32
+    return _aligned_malloc(tamanho, ALINHAMENTO_BUFFER_SAIDA);
+#else
+    return aligned_alloc(ALINHAMENTO_BUFFER_SAIDA, tamanho);
+#endif
+}
+
+/**
+ * @brief   Libera um bloco alocado por alocar_alinhado.
+ *
+ * @param ponteiro  O bloco a ser liberado.
+ */
+void liberar_alinhado(void *ponteiro)
+{
+#ifdef _WIN32
+    _aligned_free(ponteiro);
+#else
+    free(ponteiro);
+#endif
+}
+
+/**
+ * @brief   Prepara uma saída que grava em um arquivo já aberto. O stdio do arquivo fica sem buffer, já que cada
+ *          descarga grava o buffer inteiro de uma vez.
+ *
+ * @param saida         A saída que será preparada.
+ * @param arquivo       O arquivo de destino.
+ * @param capacidade    O tamanho desejado do buffer, ajustado entre o mínimo e o máximo.
+ * @return              true se o buffer foi alocado.
+ */
+bool saida_arquivo(Saida *saida, FILE *arquivo, size_t capacidade)
+{
+    if(capacidade < TAMANHO_BUFFER_SAIDA_MINIMO)
+    {
+        capacidade = TAMANHO_BUFFER_SAIDA_MINIMO;
+    }
+    if(capacidade > TAMANHO_BUFFER_SAIDA_MAXIMO)
+    {
+        capacidade = TAMANHO_BUFFER_SAIDA_MAXIMO;
+    }
+    capacidade = (capacidade + ALINHAMENTO_BUFFER_SAIDA - 1) / ALINHAMENTO_BUFFER_SAIDA * ALINHAMENTO_BUFFER_SAIDA;
+
+    saida->buffer = (uint8_t*)alocar_alinhado(capacidade);
+    saida->capacidade = capacidade;
+    saida->posicao = 0;
+    saida->arquivo = arquivo;
+    saida->crescer = false;
+    saida->descarregados = 0;
+    saida->erro = saida->buffer == NULL;
+    saida->estatisticas = NULL;
+    if(!saida->erro)
+    {
+        setvbuf(arquivo, NULL, _IONBF, 0);
+    }
+    return !saida->erro;
+}
+
+/**
+ * @brief   Prepara uma saída que grava direto em uma região de memória de capacidade fixa.
+ *
+ * @param saida         A saída que será preparada.
+ * @param destino       A região de memória de destino.
+ * @param capacidade    Quantos bytes cabem no destino.
+ */
+void saida_memoria(Saida *saida, uint8_t *destino, size_t capacidade)
+{
+    saida->buffer = destino;
+    saida->capacidade = capacidade;
+    saida->posicao = 0;
+    saida->arquivo = NULL;
+    saida->crescer = false;
+    saida->descarregados = 0;
+    saida->erro = false;
+    saida->estatisticas = NULL;
+}
+
+/**
+ * @brief   Prepara uma saída em memória que cresce conforme necessário. O buffer final pertence a quem chamou e deve
+ *          ser liberado com free.
+ *
+ * @param saida         A saída que será preparada.
+ * @param capacidade    A capacidade inicial.
+ * @return              true se a capacidade inicial foi alocada.
+ */
+bool saida_memoria_crescente(Saida *saida, size_t capacidade)
+{
+    if(capacidade < 64)
+    {
+        capacidade = 64;
+    }
+    saida_memoria(saida, (uint8_t*)malloc(capacidade), capacidade);
+    saida->crescer = true;
+    saida->erro = saida->buffer == NULL;
+    return !saida->erro;
+}
+
+/**
+ * @brief   Grava no arquivo tudo que está no buffer com uma única escrita. Em memória não faz nada.
+ *
+ * @param saida     A saída.
+ * @return          false se a escrita falhou.
+ */
+bool saida_descarregar(Saida *saida)
+{
+    if(saida->arquivo == NULL || saida->posicao == 0 || saida->erro)
+    {
+        return !saida->erro;
+    }
+    uint64_t marca = iniciar_entrada_saida(saida->estatisticas);
+    bool ok = fwrite(saida->buffer, 1, saida->posicao, saida->arquivo) == saida->posicao;
+    terminar_entrada_saida(saida->estatisticas, FASE_ESCRITA, marca);
+    if(!ok)
+    {
+        saida->erro = true;
+        return false;
+    }
+    saida->descarregados += saida->posicao;
+    saida->posicao = 0;
+    return true;
+}
+
+/**
+ * @brief   Garante que existam pelo menos n bytes livres no buffer, descarregando o arquivo ou fazendo a memória
+ *          crescer. Em memória de capacidade fixa, a falta de espaço é marcada como erro.
+ *
+ * @param saida     A saída.
+ * @param n         Quantos bytes precisam caber.
+ * @return          true se os n bytes cabem.
+ */
+bool saida_reservar(Saida *saida, size_t n)
+{
+    if(saida->capacidade - saida->posicao >= n)
+    {
+        return !saida->erro;
+    }
+    if(saida->arquivo != NULL)
+    {
+        return saida_descarregar(saida) && saida->capacidade >= n;
+    }
+    if(!saida->crescer)
+    {
+        saida->erro = true;
+        return false;
+    }
+    size_t capacidade = saida->capacidade * 2;
+    while(capacidade - saida->posicao < n)
+    {
+        capacidade *= 2;
+    }
+    uint8_t *novo = (uint8_t*)realloc(saida->buffer, capacidade);
+    if(novo == NULL)
+    {
+        saida->erro = true;
+        return false;
+    }
+    saida->buffer = novo;
+    saida->capacidade = capacidade;
+    ESTATISTICA_SOMAR(saida->estatisticas, alocacoes, 1);
+    return true;
+}
+
+/**
+ * @brief   Acrescenta n bytes à saída. Blocos maiores que o buffer de um arquivo são gravados direto, sem cópia.
+ *
+ * @param saida     A saída.
+ * @param dados     Os bytes a serem acrescentados.
+ * @param n         A quantidade de bytes.
+ * @return          false se houve erro.
+ */
+bool saida_escrever(Saida *saida, const void *dados, size_t n)
+{
+    if(saida->arquivo != NULL && n > saida->capacidade)
+    {
+        if(!saida_descarregar(saida))
+        {
+            return false;
+        }
+        uint64_t marca = iniciar_entrada_saida(saida->estatisticas);
+        bool ok = fwrite(dados, 1, n, saida->arquivo) == n;
+        terminar_entrada_saida(saida->estatisticas, FASE_ESCRITA, marca);
+        if(!ok)
+        {
+            saida->erro = true;
+            return false;
+        }
+        saida->descarregados += n;
+        return true;
+    }
+    if(!saida_reservar(saida, n))
+    {
+        return false;
+    }
+    memcpy(saida->buffer + saida->posicao, dados, n);
+    saida->posicao += n;
+    return true;
+}
+
+/**
+ * @brief   Acrescenta um único byte à saída.
+ *
+ * @param saida     A saída.
+ * @param byte      O byte.
+ */
+static inline void saida_byte(Saida *saida, uint8_t byte)
+{
+    if(saida->posicao == saida->capacidade && !saida_reservar(saida, 1))
+    {
+        return;
+    }
+    saida->buffer[saida->posicao++] = byte;
+}
+
+/**
+ * @brief   Acrescenta um inteiro de 32 bits à saída, do byte mais significativo para o menos significativo.
+ *
+ * @param saida     A saída.
+ * @param valor     O inteiro.
+ */
+void saida_u32(Saida *saida, uint32_t valor)
+{
+    uint8_t bytes[4] = {(uint8_t)(valor >> 24), (uint8_t)(valor >> 16), (uint8_t)(valor >> 8), (uint8_t)valor};
+    saida_escrever(saida, bytes, 4);
+}
+
+/**
+ * @brief   Acrescenta um inteiro de 64 bits à saída, do byte mais significativo para o menos significativo.
+ *
+ * @param saida     A saída.
+ * @param valor     O inteiro.
+ */
+void saida_u64(Saida *saida, uint64_t valor)
+{
+    saida_u32(saida, (uint32_t)(valor >> 32));
+    saida_u32(saida, (uint32_t)valor);
+}
+
+/**
+ * @brief   Quantos bytes já foram entregues à saída, descarregados ou não.
+ *
+ * @param saida     A saída.
+ * @return          O total de bytes.
+ */
+uint64_t saida_tamanho(Saida *saida)
+{
+    return saida->descarregados + saida->posicao;
+}
+
+/**
+ * @brief   Descarrega o que sobrou e, para arquivos, libera o buffer. Em memória o buffer continua com quem chamou.
+ *
+ * @param saida     A saída.
+ * @return          false se alguma escrita falhou.
+ */
+bool saida_finalizar(Saida *saida)
+{
+    bool ok = saida_descarregar(saida);
+    if(saida->arquivo != NULL)
+    {
+        liberar_alinhado(saida->buffer);
+        saida->buffer = NULL;
+        saida->capacidade = 0;
+    }
+    return ok && !saida->erro;
+}
+
+#endif
@@ -0,0 +1,254 @@
+#ifndef CANONICO_H
+#define CANONICO_H
+
+#include "structs_huffman.h"
+#include "buffer_saida.h"
+
+//maior tamanho de codigo canonico, o mesmo que cabe no acumulador do escritor de bits
+#define TAMANHO_CANONICO_MAXIMO 64
+//tamanhos dos codigos no cabecalho: 0 a 64 e o tamanho de um byte; 0x80 | (k - 1) sao k bytes sem codigo e 
+//0xC0 | (k - 1) repete k vezes o ultimo tamanho, com k de 1 a 64
+#define CANONICO_ZEROS 0x80
+#define CANONICO_REPETIR 0xC0
+#define CANONICO_MAXIMO_REPETICAO 64
+
+/**
+ * @brief   Calcula os códigos canônicos a partir do tamanho do código de cada byte: os bytes são ordenados por tamanho 
+ *          e, no empate, pelo valor, e cada um recebe o código seguinte ao do anterior, com zeros à direita quando o 
+ *          tamanho aumenta. Como só os tamanhos definem os códigos, só eles precisam ir no cabeçalho.
+ * 
+ * @param tamanhos  O tamanho do código de cada byte, 0 para os que não aparecem.
+ * @param codigos   Recebe o código de cada byte, alinhado à direita.
+ */
+void codigos_canonicos(const uint8_t *tamanhos, uint64_t *codigos)
+{
+    uint64_t quantidade[TAMANHO_CANONICO_MAXIMO + 1], proximo[TAMANHO_CANONICO_MAXIMO + 1];
+    memset(quantidade, 0, sizeof(quantidade));
+    for(int i = 0; i < Max_table; i++)
+    {
+        quantidade[tamanhos[i]]++;
+    }
+    quantidade[0] = 0;
+    proximo[0] = 0;
+    proximo[1] = 0;
+    for(int tamanho = 2; tamanho <= TAMANHO_CANONICO_MAXIMO; tamanho++)
+    {
+        proximo[tamanho] = (proximo[tamanho - 1] + quantidade[tamanho - 1]) << 1;
+    }
+    for(int i = 0; i < Max_table; i++)
+    {
+        codigos[i] = tamanhos[i] != 0 ? proximo[tamanhos[i]]++ : 0;
+    }
+}
+
+/**
+ * @brief   Escreve o tamanho do código de cada um dos 256 bytes, compactando as repetições.
+ * 
+ * @param saida     A saída.
+ * @param tamanhos  O tamanho do código de cada byte, 0 para os que não aparecem.
+ */
+void escrever_tamanhos_canonicos(Saida *saida, const uint8_t *tamanhos)
+{
+    int i = 0;
+    while(i < Max_table)
+    {
+        int repeticoes = 1;
+        while(i + repeticoes < Max_table && tamanhos[i + repeticoes] == tamanhos[i] && 
+              repeticoes < CANONICO_MAXIMO_REPETICAO)
+        {
+            repeticoes++;
+        }
+        if(tamanhos[i] == 0)
+        {
+            saida_byte(saida, CANONICO_ZEROS | (repeticoes - 1));
+        }
+        else
+        {
+            //o primeiro vai literal e o resto repete ele
+            saida_byte(saida, tamanhos[i]);
+            if(repeticoes > 1)
+            {
+                saida_byte(saida, CANONICO_REPETIR | (repeticoes - 2));
+            }
+        }
+        i += repeticoes;
+    }
+}
+
+/**
+ * @brief   Lê os tamanhos escritos por escrever_tamanhos_canonicos e confere se eles formam um código de prefixo 
+ *          completo, ou um único byte.
+ * 
+ * @param dados     Os bytes do cabeçalho.
+ * @param tamanho   Quantos bytes estão disponíveis.
+ * @param tamanhos  Recebe o tamanho do código de cada byte.
+ * @return          Quantos bytes foram lidos, ou -1 se o cabeçalho for inválido.
+ */
+long ler_tamanhos_canonicos(const uint8_t *dados, size_t tamanho, uint8_t *tamanhos)
+{
+    size_t lidos = 0;
+    int i = 0, simbolos = 0;
+    while(i < Max_table)
+    {
+        if(lidos == tamanho)
+        {
+            return -1;
+        }
+        uint8_t byte = dados[lidos++];
+        int repeticoes = 1;
+        uint8_t valor = byte;
+        if((byte & CANONICO_REPETIR) == CANONICO_REPETIR)
+        {
+            if(i == 0)
+            {
+                return -1;
+            }
+            repeticoes = (byte & 0x3F) + 1;
+            valor = tamanhos[i - 1];
+        }
+        else if(byte & CANONICO_ZEROS)
+        {
+            repeticoes = (byte & 0x3F) + 1;
+            valor = 0;
+        }
+        else if(byte > TAMANHO_CANONICO_MAXIMO)
+        {
+            return -1;
+        }
+        if(i + repeticoes > Max_table)
+        {
+            return -1;
+        }
+        for(int k = 0; k < repeticoes; k++)
+        {
+            tamanhos[i++] = valor;
+            simbolos += valor != 0;
+        }
+    }
+
+    //desigualdade de kraft com igualdade: a cada nivel as folhas livres dobram e os codigos desse tamanho as ocupam
+    if(simbolos <= 1)
+    {
+        return (long)lidos;
+    }
+    int quantidade[TAMANHO_CANONICO_MAXIMO + 1];
+    memset(quantidade, 0, sizeof(quantidade));
+    for(int k = 0; k < Max_table; k++)
+    {
+        quantidade[tamanhos[k]]++;
+    }
+    long livres = 1;
+    for(int t = 1; t <= TAMANHO_CANONICO_MAXIMO; t++)
+    {
+        livres = livres * 2 - quantidade[t];
+        //mais livres que bytes restantes nunca fecham o codigo
+        if(livres < 0 || livres > 2 * Max_table)
+        {
+            return -1;
+        }
+    }
+    return livres == 0 ? (long)lidos : -1;
+}
+
+/**
+ * @brief   Calcula, com o algoritmo package-merge, o tamanho ótimo do código de cada byte sem que nenhum passe de 
+ *          limite bits. Se o limite for pequeno demais para a quantidade de bytes diferentes, ele é aumentado até o 
+ *          menor possível. Tudo fica em vetores de tamanho fixo na pilha, então nada é alocado.
+ * 
+ * @param frequencia    A frequência de cada byte.
+ * @param limite        O maior tamanho de código permitido, até TAMANHO_CANONICO_MAXIMO.
+ * @param tamanhos      Recebe o tamanho do código de cada byte, 0 para os que não aparecem.
+ */
+void tamanhos_limitados(long *frequencia, int limite, uint8_t *tamanhos)
+{
+    int simbolos[Max_table], n = 0;
+    memset(tamanhos, 0, Max_table);
+    for(int i = 0; i < Max_table; i++)
+    {
+        if(frequencia[i] != 0)
+        {
+            //insercao ordenada por frequencia e, no empate, pelo byte
+            int j = n++;
+            while(j > 0 && frequencia[simbolos[j - 1]] > frequencia[i])
+            {
+                simbolos[j] = simbolos[j - 1];
+                j--;
+            }
+            simbolos[j] = i;
+        }
+    }
+    if(n == 0)
+    {
+        return;
+    }
+    if(n == 1)
+    {
+        tamanhos[simbolos[0]] = 1;
+        return;
+    }
+    if(limite > TAMANHO_CANONICO_MAXIMO)
+    {
+        limite = TAMANHO_CANONICO_MAXIMO;
+    }
+    while((1L << limite) < n)
+    {
+        limite++;
+    }
+
+    //a lista de cada nivel tem as n folhas intercaladas com os pacotes formados com pares da lista do nivel anterior.
+    //Folhas e pacotes entram na lista na ordem em que foram criados, entao basta guardar o peso dos itens da lista 
+    //atual e, de cada nivel, quais posicoes sao pacotes
+    long pesos[2][2 * Max_table];
+    uint8_t pacote_em[TAMANHO_CANONICO_MAXIMO][2 * Max_table];
+    long *lista = pesos[0], *nova = pesos[1];
+    int tamanho_lista = n;
+    for(int k = 0; k < n; k++)
+    {
+        lista[k] = frequencia[simbolos[k]];
+        pacote_em[0][k] = 0;
+    }
+    for(int nivel = 1; nivel < limite; nivel++)
+    {
+        int pacotes = tamanho_lista / 2, folha = 0, pacote = 0, tamanho_nova = 0;
+        //intercala as folhas com os pacotes, que ja saem ordenados; no empate a folha vem primeiro
+        while(folha < n || pacote < pacotes)
+        {
+            long peso_pacote = pacote < pacotes ? lista[2 * pacote] + lista[2 * pacote + 1] : 0;
+            if(pacote == pacotes || (folha < n && frequencia[simbolos[folha]] <= peso_pacote))
+            {
+                nova[tamanho_nova] = frequencia[simbolos[folha++]];
+                pacote_em[nivel][tamanho_nova++] = 0;
+            }
+            else
+            {
+                nova[tamanho_nova] = peso_pacote;
+                pacote_em[nivel][tamanho_nova++] = 1;
+                pacote++;
+            }
+        }
+        long *troca = lista;
+        lista = nova;
+        nova = troca;
+        tamanho_lista = tamanho_nova;
+    }
+
+    //cada vez que uma folha aparece nos 2n - 2 primeiros itens, direto ou dentro de um pacote, o codigo dela ganha um 
+    //bit. Os itens de um prefixo sao as primeiras folhas e os primeiros pacotes, e esses pacotes sao formados com um 
+    //prefixo da lista do nivel anterior
+    int usados = 2 * n - 2;
+    for(int nivel = limite - 1; nivel >= 0; nivel--)
+    {
+        int pacotes = 0;
+        for(int k = 0; k < usados; k++)
+        {
+            pacotes += pacote_em[nivel][k];
+        }
+        for(int k = 0; k < usados - pacotes; k++)
+        {
+            tamanhos[simbolos[k]]++;
+        }
+        usados = 2 * pacotes;
+    }
+}
+
+#endif
@@ -1,92 +1,128 @@
 #include "structs_huffman.h"
+#include "buffer_saida.h"
+#include "pool_threads.h"
+#include "mapeamento.h"
+#include "canonico.h"
+#include "histograma.h"
+#include "adaptativo.h"
+#include "dicionario.h"
+#include <errno.h>
 
+//no da arvore de huffman; os nos ficam todos no vetor de uma ArenaArvore e os filhos apontam para dentro dele
 struct arvore
 {
-    void *byte;
+    uint8_t byte;
     long frequencia;
-    Arvore *next, *esquerda, *direita;
+    Arvore *esquerda, *direita;
 };
 
+//os nos de uma arvore de huffman num unico vetor; a arena e reaproveitada de uma arvore para outra sem alocar nada
+typedef struct arena_arvore
+{
+    Arvore nos[Max_nos_arvore];
+    int quantidade;
+} ArenaArvore;
+
+//maior codigo que cabe no acumulador de 64 bits do escritor de bits
+#define Max_tamanho_codigo 64
+
+//escritor de bits que junta os codigos em um acumulador de 64 bits e grava palavras inteiras
+typedef struct escritor_bits
+{
+    Saida *saida;
+    uint64_t acumulador;
+    int quantidade;
+} EscritorBits;
+
 /**
- * @brief Esta função é usada para criar um novo nó da árvore de Huffman, alocar memória para armazenar o byte de 
- * dados, definir a frequência do nó e inicializar os ponteiros para os nós filhos como nulos.
+ * @brief Esta função é usada para criar um novo nó da árvore de Huffman: pega o próximo nó livre da arena, guarda o 
+ * byte e a frequência e inicializa os ponteiros para os nós filhos como nulos.
  * 
- * @param i             Um ponteiro para void que vai pegar o byte para traferir para o nó da árvore.
+ * @param arena         A arena de onde o nó sai.
+ * @param byte          O byte do nó.
  * @param frequencia    Um long para para a frequencia do byte.
  * @return              Um ponteiro para o novo nó criado.
  */
-Arvore* novo_no_arvore(void *i, long frequencia)
+Arvore* novo_no_arvore(ArenaArvore *arena, uint8_t byte, long frequencia)
 {
-    Arvore *novo_no = (Arvore*)malloc(sizeof(Arvore));
-    if(novo_no == NULL)
+    if(arena->quantidade == Max_nos_arvore)
     {
         printf("\nERRO AO ALOCAR NÓ DA ÁRVORE\n");
         exit(1);
     }
-    novo_no->byte = (void*)malloc(1);
-    if(novo_no->byte == NULL)
-    {
-        printf("\nERRO AO ALOCAR BYTE\n");
-        exit(1);
-    }
-    memcpy(novo_no->byte, i, 1);
+    Arvore *novo_no = &arena->nos[arena->quantidade++];
+    novo_no->byte = byte;
     novo_no->frequencia = frequencia;
     novo_no->esquerda = NULL;
-    novo_no->next = NULL;
     novo_no->direita = NULL;
 
     return novo_no;
 }
 
 /**
- * @brief Essa função é usada para manter a fila de prioridades ordenada durante o processo de construção da árvore 
- * de Huffman, garantindo que os nós com frequências mais baixas estejam na frente da fila.
+ * @brief Diz qual de dois nós sai primeiro da fila de prioridades: o de menor frequência e, no empate, o criado por 
+ * último. É a mesma ordem da antiga lista ordenada, que inseria cada nó antes dos de frequência igual, então as 
+ * árvores (e os arquivos comprimidos) continuam iguais.
  * 
- * @param no_arvore     Um ponteiro para um ponteiro para a raiz da fila de prioridades.
- * @param no            Um ponteiro para um nó da árvore de Huffman que deve ser enfileirado.
+ * @param a     Um nó da arena.
+ * @param b     Outro nó da mesma arena.
+ * @return      true se a sai antes de b.
  */
-void enfileirar(Arvore **no_arvore, Arvore *no)
+static inline bool vem_antes(Arvore *a, Arvore *b)
 {
-    Arvore *novo_no_fila = no;
+    return a->frequencia < b->frequencia || (a->frequencia == b->frequencia && a > b);
+}
 
-    if((*no_arvore) == NULL || (*no_arvore)->frequencia >= novo_no_fila->frequencia)
-    {
-        novo_no_fila->next = *no_arvore;
-        *no_arvore = novo_no_fila;
-    }
-    else
+/**
+ * @brief Essa função insere um nó na fila de prioridades, um heap binário guardado em um vetor, mantendo o nó que 
+ * deve sair primeiro no topo.
+ * 
+ * @param fila          O vetor do heap.
+ * @param quantidade    Quantos nós estão na fila, atualizado.
+ * @param no            Um ponteiro para um nó da árvore de Huffman que deve ser enfileirado.
+ */
+void enfileirar(Arvore **fila, int *quantidade, Arvore *no)
+{
+    int i = (*quantidade)++;
+    while(i > 0 && vem_antes(no, fila[(i - 1) / 2]))
     {
-        Arvore *aux = *no_arvore;
-        while(aux->next != NULL)
-        {
-            if(aux->next->frequencia >= novo_no_fila->frequencia)
-            {
-                break;
-            }
-            aux = aux->next;
-        }   
-        novo_no_fila->next = aux->next;
-        aux->next = novo_no_fila;
+        fila[i] = fila[(i - 1) / 2];
+        i = (i - 1) / 2;
     }
+    fila[i] = no;
     return;
 }
 
 /**
- * @brief Essa função é usada para manter a fila de prioridades atualizada durante o processo de construção da 
- * árvore de Huffman, garantindo que o nó com a menor frequência seja sempre removido da frente da fila.
+ * @brief Essa função tira da fila de prioridades o nó de menor frequência e reorganiza o heap.
  * 
- * @param fila      Um ponteiro para um ponteiro para a fila de prioridades.
- * @return          Um ponteiro para o nó "desenfileirado".
+ * @param fila          O vetor do heap.
+ * @param quantidade    Quantos nós estão na fila, atualizado.
+ * @return              Um ponteiro para o nó "desenfileirado", ou NULL se a fila estiver vazia.
  */
-Arvore* desenfileirar(Arvore **fila)
+Arvore* desenfileirar(Arvore **fila, int *quantidade)
 {
-    if(fila == NULL)
+    if(*quantidade == 0)
     {
         return NULL;
     }
-    Arvore *desenfileirado = *fila;
-    *fila = desenfileirado->next;
-    desenfileirado->next = NULL;
+    Arvore *desenfileirado = fila[0], *ultimo = fila[--(*quantidade)];
+    int i = 0;
+    while(2 * i + 1 < *quantidade)
+    {
+        int filho = 2 * i + 1;
+        if(filho + 1 < *quantidade && vem_antes(fila[filho + 1], fila[filho]))
+        {
+            filho++;
+        }
+        if(!vem_antes(fila[filho], ultimo))
+        {
+            break;
+        }
+        fila[i] = fila[filho];
+        i = filho;
+    }
+    fila[i] = ultimo;
     return desenfileirado;
 }
 
@@ -94,27 +130,15 @@ Arvore* desenfileirar(Arvore **fila)
  * @brief Essa função é usada durante a construção da árvore de Huffman para criar um novo nó raiz que combina dois 
  * nós filhos em uma árvore maior.
  * 
+ * @param arena         A arena de onde o nó sai.
  * @param esquerda      Nó filho à esquerda que será a raiz de uma subárvore para montar nossa árvore de huffman.
  * @param direita       Nó filho à direita que será a raiz de uma subárvore para montar nossa árvore de huffman.
  * @param byte          O byte associado ao nó raiz que está sendo criado.
  * @return              Um ponteiro para o novo nó raiz.
  */
-Arvore* novo_no_arvore_huffman(Arvore *esquerda, Arvore *direita, void *byte)
+Arvore* novo_no_arvore_huffman(ArenaArvore *arena, Arvore *esquerda, Arvore *direita, uint8_t byte)
 {
-    Arvore *raiz = (Arvore*)malloc(sizeof(Arvore));
-    if(raiz == NULL)
-    {
-        printf("\nERRO AO ALOCAR RAIZ\n");
-        exit(1);
-    }
-    raiz->byte = (void*)malloc(1);
-    if(raiz->byte == NULL)
-    {
-        printf("\nERRO AO ALOCAR BYTE PARA RAIZ\n");
-        exit(1);
-    }
-    memcpy(raiz->byte, byte, 1);
-    raiz->frequencia = (esquerda->frequencia) + (direita->frequencia);
+    Arvore *raiz = novo_no_arvore(arena, byte, esquerda->frequencia + direita->frequencia);
     raiz->esquerda = esquerda;
     raiz->direita = direita;
 
@@ -123,24 +147,113 @@ Arvore* novo_no_arvore_huffman(Arvore *esquerda, Arvore *direita, void *byte)
 
 /**
  * @brief No geral, esta função monta a árvore de Huffman combinando gradualmente os nós da fila, até que reste 
- * apenas a árvore completa na fila. A árvore resultante é atribuída ao ponteiro arvore_huffman passado como argumento.
+ * apenas a árvore completa na fila.
  * 
- * @param fila              Um ponteiro para uma fila de prioridades.
- * @param arvore_huffman    Um ponteiro para um ponteiro para a árvore de Huffman.
+ * @param arena         A arena de onde saem os nós internos.
+ * @param fila          O heap com as folhas.
+ * @param quantidade    Quantas folhas estão no heap.
+ * @return              A raiz da árvore de Huffman, ou NULL se a fila estiver vazia.
  */
-void criar_arvore_huffman(Arvore **fila, Arvore **arvore_huffman)
+Arvore* criar_arvore_huffman(ArenaArvore *arena, Arvore **fila, int quantidade)
 {
-    uint8_t byte = '*';
+    //um arquivo vazio nao tem nenhum no na fila
+    if(quantidade == 0)
+    {
+        return NULL;
+    }
     //montando a arvore de huffman
-    while((*fila)->next != NULL)
+    while(quantidade > 1)
     {
-        Arvore *esquerda = desenfileirar(&*fila), *direita = desenfileirar(&*fila), *raiz;
-        raiz = novo_no_arvore_huffman(esquerda, direita, &byte);
-        enfileirar(&*fila, raiz);
+        Arvore *esquerda = desenfileirar(fila, &quantidade), *direita = desenfileirar(fila, &quantidade);
+        enfileirar(fila, &quantidade, novo_no_arvore_huffman(arena, esquerda, direita, '*'));
     }
 
-    *arvore_huffman = desenfileirar(&*fila);
-    return;
+    return desenfileirar(fila, &quantidade);
+}
+
+/**
+ * @brief Monta a fila de frequências com os bytes que aparecem na entrada e cria a árvore de Huffman a partir dela. 
+ * Os nós anteriores da arena são descartados.
+ * 
+ * @param arena         A arena que recebe os nós da árvore.
+ * @param frequencia    Um array de longs com a frequência de cada byte.
+ * @return              A raiz da árvore de Huffman, ou NULL se nenhum byte aparece.
+ */
+Arvore* construir_arvore_huffman(ArenaArvore *arena, long *frequencia)
+{
+    Arvore *fila[Max_table];
+    int quantidade = 0;
+    arena->quantidade = 0;
+    //montando a fila de frequência, com as folhas na ordem dos bytes
+    for(int i = 0; i < Max_table; i++)
+    {
+        //avaliando se a frequencia e igual a 0 para nao pegarmos o byte que nao tem no arquivo
+        if(frequencia[i] != 0)
+        {
+            enfileirar(fila, &quantidade, novo_no_arvore(arena, (uint8_t)i, frequencia[i]));
+        }
+    }
+    //criando a arvore de huffman
+    return criar_arvore_huffman(arena, fila, quantidade);
+}
+
+/**
+ * @brief Garante que a árvore do formato antigo tenha pelo menos duas folhas. Com um único byte diferente na entrada 
+ * a folha dele é a raiz, com código de 0 bits, e como o formato antigo não guarda o tamanho original o descompressor 
+ * não teria como saber quantas vezes repeti-lo. A folha ganha então uma irmã de frequência 0, e o código dela passa 
+ * a ter 1 bit.
+ * 
+ * @param arena         A arena onde está a árvore.
+ * @param arvore        A raiz da árvore de Huffman, ou NULL.
+ * @return              A raiz da árvore, nova se a antiga era uma folha.
+ */
+Arvore* completar_arvore_legado(ArenaArvore *arena, Arvore *arvore)
+{
+    if(arvore == NULL || arvore->esquerda != NULL || arvore->direita != NULL)
+    {
+        return arvore;
+    }
+    //a irma nunca aparece na entrada, so precisa ser um byte diferente
+    Arvore *irma = novo_no_arvore(arena, (uint8_t)(arvore->byte + 1), 0);
+    return novo_no_arvore_huffman(arena, irma, arvore, '*');
+}
+
+/**
+ * @brief   Monta a árvore dos códigos canônicos com os tamanhos dados. Os nós anteriores da arena são descartados.
+ * 
+ * @param arena     A arena que recebe os nós da árvore.
+ * @param tamanhos  O tamanho do código de cada byte, 0 para os que não aparecem.
+ * @return          A raiz da árvore, ou NULL se nenhum byte tiver código.
+ */
+Arvore* arvore_de_tamanhos(ArenaArvore *arena, uint8_t *tamanhos)
+{
+    uint64_t codigos[Max_table];
+    Arvore *raiz = NULL;
+    arena->quantidade = 0;
+    codigos_canonicos(tamanhos, codigos);
+    for(int i = 0; i < Max_table; i++)
+    {
+        if(tamanhos[i] == 0)
+        {
+            continue;
+        }
+        if(raiz == NULL)
+        {
+            raiz = novo_no_arvore(arena, '*', 0);
+        }
+        //desce pelo caminho do codigo criando os nos que faltam, e a folha no fim
+        Arvore *no = raiz;
+        for(int bit = tamanhos[i] - 1; bit >= 0; bit--)
+        {
+            Arvore **filho = (codigos[i] >> bit) & 1 ? &no->direita : &no->esquerda;
+            if(*filho == NULL)
+            {
+                *filho = novo_no_arvore(arena, bit == 0 ? (uint8_t)i : '*', 0);
+            }
+            no = *filho;
+        }
+    }
+    return raiz;
 }
 
 /**
@@ -185,73 +298,52 @@ long tamanho_arvore(Arvore *no_arvore)
     }
     return 1 + (no_arvore->esquerda == NULL &&
                 no_arvore->direita == NULL &&
-                (*(unsigned char*)no_arvore->byte == '*' ||
-                *(unsigned char*)no_arvore->byte == '\\'))
+                (no_arvore->byte == '*' ||
+                no_arvore->byte == '\\'))
                 +
                 tamanho_arvore(no_arvore->esquerda)
                 +
                 tamanho_arvore(no_arvore->direita);
 }
 
-//cria o dicionario
 /**
- * @brief Essa função é usada para preparar uma estrutura de dados que armazenará os códigos de Huffman 
- * associados a cada símbolo na árvore de Huffman.
+ * @brief Essa função é usada para percorrer a árvore de Huffman a partir da raiz até as folhas, 
+ * construindo os códigos de Huffman associados a cada símbolo e armazenando-os na tabela de códigos como um 
+ * par (bits, tamanho) para uso posterior na codificação.
  * 
- * @param tamanho_arvore    O tamanho da nossa árvore de Huffman.
- * @return                  Um ponteiro para um array de ponteiros de onde cada elemento desse array será 
- *                          uma sequência de bytes que representa o código para um símbolo.
+ * @param codigos           Um array de Max_table códigos, indexado pelo byte.
+ * @param raiz              O nó raiz da árvore de Huffman.
+ * @param profundidade      A profundidade atual na árvore durante a recursão.
+ * @param codigo            Os bits do caminho da raiz até o nó atual.
  */
-uint8_t** criar_dicionario(int tamanho_arvore)
+void gerar_codigos(Codigo *codigos, Arvore *raiz, long profundidade, uint64_t codigo)
 {
-    uint8_t **dicionario = (uint8_t**)malloc(sizeof(uint8_t*) * Max_table);
-    if(dicionario == NULL)
-    {
-        printf("\nERRO AO ALOCAR DICIONÁRIO\n");
-        exit(1);
-    }
-    for(int i = 0; i < Max_table; i++)
+    if(raiz->esquerda == NULL && raiz->direita == NULL)
     {
-        dicionario[i] = (uint8_t*)malloc(sizeof(uint8_t) * tamanho_arvore);
-        if(dicionario[i] == NULL)
-        {
-            printf("\nERRO AO ALOCAR RESTO DO DICIONÁRIO\n");
-            exit(1);
-        }
-        dicionario[i][0] = '\0';
+        codigos[raiz->byte].bits = codigo;
+        codigos[raiz->byte].tamanho = profundidade;
+        return;
     }
 
-    return dicionario;
+    gerar_codigos(codigos, raiz->esquerda, profundidade + 1, codigo << 1);
+    gerar_codigos(codigos, raiz->direita, profundidade + 1, (codigo << 1) | 1);
 }
 
 /**
- * @brief Essa função é usada para percorrer a árvore de Huffman a partir da raiz até as folhas, 
- * construindo os códigos de Huffman associados a cada símbolo e armazenando-os no dicionário para 
- * uso posterior na codificação e decodificação de dados.
+ * @brief Calcula quantos bits a entrada ocupa depois de codificada, somando frequência vezes tamanho do código.
  * 
- * @param dicionario        Um array de ponteiros representando o dicionário de códigos de Huffman.
- * @param raiz              O nó raiz da árvore de Huffman.
- * @param profundidade      A profundidade atual na árvore durante a recursão.
- * @param aux               Um array usado temporariamente para construir os códigos de Huffman.
+ * @param codigos           A tabela de códigos de Huffman.
+ * @param frequencia        Um array de longs representando as frequências dos símbolos.
+ * @return                  O total de bits compactados.
  */
-void gerar_codigos(uint8_t **dicionario, Arvore *raiz, long profundidade, uint8_t *aux)
+uint64_t bits_compactados(Codigo *codigos, long *frequencia)
 {
-    if(raiz->esquerda == NULL && raiz->direita == NULL)
+    uint64_t bits = 0;
+    for(int i = 0; i < Max_table; i++)
     {
-        uint8_t byte = *(uint8_t*)raiz->byte;
-        for(int i = 0; i < profundidade; i++)
-        {
-            dicionario[byte][i] = aux[i];
-        }
-        dicionario[byte][profundidade] = '\0';
-        return;
+        bits += (uint64_t)frequencia[i] * codigos[i].tamanho;
     }
-
-    aux[profundidade] = '0';
-    gerar_codigos(dicionario, raiz->esquerda, profundidade + 1, aux);
-
-    aux[profundidade] = '1';
-    gerar_codigos(dicionario, raiz->direita, profundidade + 1, aux);
+    return bits;
 }
 
 /**
@@ -259,26 +351,16 @@ void gerar_codigos(uint8_t **dicionario, Arvore *raiz, long profundidade, uint8_
  * Ela faz isso comparando o número de bits necessários para representar os dados originais com o número de bits 
  * necessários após a compressão de Huffman.
  * 
- * @param dicionario        Um array de ponteiros representando o dicionário de códigos de Huffman.
+ * @param codigos           A tabela de códigos de Huffman.
  * @param frequencia        Um array de longs representando as frequências dos símbolos.
  * @return                  Determina o número de bits economizados (ou desperdiçados) que indica 
  *                          quantos bits não se ajustam completamente em um byte.
  */
-int lixo(uint8_t **dicionario, long *frequencia){
-    long bits_antes = 0;
-    long bits_depois = 0;
-    for(int i = 0; i < Max_table; i++)
-    {
-        if (frequencia[i] != 0)
-        {
-            bits_antes += frequencia[i] * 8;
-            bits_depois += frequencia[i] * strlen(dicionario[i]);
-        }
-    }
+int lixo(Codigo *codigos, long *frequencia){
+    //o que falta para o ultimo byte ficar completo; nao depende de a saida ser menor que a entrada
+    uint64_t bits_depois = bits_compactados(codigos, frequencia);
 
-    printf("\nbits antes: %ld || bits depois: %ld\n", bits_antes, bits_depois);
-
-    return (bits_antes - bits_depois) % 8;
+    return (int)((8 - bits_depois % 8) % 8);
 }
 
 /**
@@ -286,43 +368,42 @@ int lixo(uint8_t **dicionario, long *frequencia){
  *          comprimido. Isso é necessário para que o arquivo descomprimido saiba como reconstruir a árvore de Huffman 
  *          durante o processo de descompressão.
  * 
- * @param arquivo_comprimido    Um ponteiro para o arquivo comprimido onde a estrutura da árvore de Huffman será 
- *                              escrita no cabeçalho.
- * @param arvore                O nó raiz da árvore de Huffman.
+ * @param saida     A saída do arquivo comprimido onde a estrutura da árvore de Huffman será escrita no cabeçalho.
+ * @param arvore    O nó raiz da árvore de Huffman.
  */
-void escrever_arvore_no_cabecalho(FILE *arquivo_comprimido, Arvore *arvore)
+void escrever_arvore_no_cabecalho(Saida *saida, Arvore *arvore)
 {
     if(arvore == NULL)
     {
         return;
     }
-    if(arvore->esquerda == NULL && arvore->direita == NULL && (*(uint8_t*)arvore->byte == '*' || *(uint8_t*)arvore->byte == '\\'))
+    if(arvore->esquerda == NULL && arvore->direita == NULL && (arvore->byte == '*' || arvore->byte == '\\'))
     {
-        uint8_t scape = (uint8_t)'\\';
-        fwrite(&scape, sizeof(uint8_t), 1, arquivo_comprimido);
+        saida_byte(saida, (uint8_t)'\\');
     }
-    uint8_t byte = *(uint8_t*)arvore->byte;
-    fwrite(&byte, sizeof(uint8_t), 1, arquivo_comprimido);
-    escrever_arvore_no_cabecalho(arquivo_comprimido, arvore->esquerda);
-    escrever_arvore_no_cabecalho(arquivo_comprimido, arvore->direita);
+    saida_byte(saida, arvore->byte);
+    escrever_arvore_no_cabecalho(saida, arvore->esquerda);
+    escrever_arvore_no_cabecalho(saida, arvore->direita);
 }
 
 /**
  * @brief   Essa função permite que o arquivo descomprimido saiba quantos bits de lixo ignorar e como reconstruir 
  *          a árvore de Huffman para decodificar os dados comprimidos.
  * 
- * @param arquivo_comprimido    Um ponteiro para o arquivo comprimido onde o cabeçalho será escrito.
+ * @param saida                 A saída do arquivo comprimido onde o cabeçalho será escrito.
  * @param bits_de_lixo          O número de bits de "lixo" (bits extras) que podem ser ignorados na descompressão.
  * @param tamanho_arvore        O tamanho da árvore de Huffman (em bytes).
  * @param arvore                O nó raiz da árvore de Huffman.
  */
-void escrever_cabecalho_no_arquivo(FILE *arquivo_comprimido, int bits_de_lixo,
+void escrever_cabecalho_no_arquivo(Saida *saida, int bits_de_lixo,
  int tamanho_arvore, Arvore *arvore)
 {
     //setando os bits
     uint16_t tamanho_lixo_e_arvore = 0, mascara;
-    //guarda o lixo no vetor para ser gravado no arquivo
-    tamanho_lixo_e_arvore |= bits_de_lixo << 13;
+    //guarda o lixo no vetor para ser gravado no arquivo, com os bits invertidos: o descompressor le o bit 15 como o
+    //menos significativo do lixo, que e como os arquivos .huff existentes foram gravados
+    int lixo_invertido = ((bits_de_lixo & 1) << 2) | (bits_de_lixo & 2) | ((bits_de_lixo >> 2) & 1);
+    tamanho_lixo_e_arvore |= lixo_invertido << 13;
     //gravando o tamanho da arvore no vetor
     for(int i = 0; i < 13; i++)
     {
@@ -342,228 +423,1601 @@ void escrever_cabecalho_no_arquivo(FILE *arquivo_comprimido, int bits_de_lixo,
     //para isso usamos a funcao htons da biblioteca arpa/inet.h
     tamanho_lixo_e_arvore = htons(tamanho_lixo_e_arvore);
     //gravando o lixo e o tamanho da arvore
-    fwrite(&tamanho_lixo_e_arvore, 1, 2, arquivo_comprimido);
+    saida_escrever(saida, &tamanho_lixo_e_arvore, 2);
     //gravando a arvore
-    escrever_arvore_no_cabecalho(arquivo_comprimido, arvore);
+    escrever_arvore_no_cabecalho(saida, arvore);
 }
 
 /**
- * @brief   Em resumo, essa função lê os dados originais, mapeia cada byte para seu código Huffman correspondente 
- *          e escreve os bits compactados no arquivo comprimido, garantindo que os bytes sejam escritos corretamente 
- *          no arquivo, mesmo quando eles não formam múltiplos de 8 bits.
+ * @brief   Prepara o escritor de bits para gravar em uma saída.
  * 
- * @param arquivo_comprimido    Um ponteiro para o arquivo no qual os bits compactados serão escritos.
- * @param dados                 Um ponteiro para um array de bytes contendo os dados originais que serão compactados.
- * @param dicionario            Um array de strings (códigos de Huffman) que mapeiam cada byte para sua representação 
- *                              compactada.
- * @param tamanho_arquivo       O tamanho do array de dados (número de bytes) que serão compactados e escritos no 
- *                              arquivo.
+ * @param escritor  O escritor de bits.
+ * @param saida     A saída onde as palavras serão gravadas.
+ */
+void iniciar_escritor_bits(EscritorBits *escritor, Saida *saida)
+{
+    escritor->saida = saida;
+    escritor->acumulador = 0;
+    escritor->quantidade = 0;
+}
+
+/**
+ * @brief   Grava o acumulador cheio como 8 bytes, do mais significativo para o menos significativo, que é a mesma 
+ *          ordem em que os bits eram gravados um a um.
+ * 
+ * @param escritor  O escritor de bits.
  */
-void escrever_bits_compactados(FILE *arquivo_comprimido, uint8_t *dados, uint8_t **dicionario, long tamanho_arquivo)
+static inline void escritor_gravar_palavra(EscritorBits *escritor)
 {
-    long indice_bit = 7;
-    uint8_t byte = 0;
-    for(int i = 0; i < tamanho_arquivo; i++)
+    Saida *saida = escritor->saida;
+    if(saida->capacidade - saida->posicao < 8 && !saida_reservar(saida, 8))
     {
-        for(int j = 0; dicionario[dados[i]][j] != '\0'; j++)
-        {
-            if(dicionario[dados[i]][j] == '1')
-            {
-                byte |= 1 << indice_bit;
-            }
-            indice_bit--;
-            if(indice_bit < 0)
-            {
-                fwrite(&byte, sizeof(unsigned char), 1, arquivo_comprimido);
-                indice_bit = 7;
-                byte = 0;
-            }
-        }
+        return;
+    }
+    uint8_t *palavra = saida->buffer + saida->posicao;
+    for(int k = 0; k < 8; k++)
+    {
+        palavra[k] = (uint8_t)(escritor->acumulador >> (56 - 8 * k));
     }
-    if(indice_bit != 7)
+    saida->posicao += 8;
+}
+
+/**
+ * @brief   Junta um código inteiro ao acumulador com um OR. Quando o acumulador enche, a palavra é gravada e o que 
+ *          sobrou do código começa a próxima palavra.
+ * 
+ * @param escritor  O escritor de bits.
+ * @param bits      Os bits do código, alinhados à direita.
+ * @param tamanho   A quantidade de bits do código (de 1 a Max_tamanho_codigo).
+ */
+static inline void escritor_escrever(EscritorBits *escritor, uint64_t bits, int tamanho)
+{
+    int livres = 64 - escritor->quantidade;
+    if(tamanho < livres)
     {
-        fwrite(&byte, sizeof(unsigned char), 1, arquivo_comprimido);
+        escritor->acumulador |= bits << (livres - tamanho);
+        escritor->quantidade += tamanho;
+        return;
     }
+    int resto = tamanho - livres;
+    escritor->acumulador |= bits >> resto;
+    escritor_gravar_palavra(escritor);
+    escritor->acumulador = resto ? bits << (64 - resto) : 0;
+    escritor->quantidade = resto;
+}
 
-    return;
+/**
+ * @brief   Grava os bytes que ainda estão no acumulador. O último byte é completado com zeros, que são os bits de 
+ *          lixo indicados no cabeçalho.
+ * 
+ * @param escritor  O escritor de bits.
+ */
+void finalizar_escritor_bits(EscritorBits *escritor)
+{
+    int bytes = (escritor->quantidade + 7) / 8;
+    for(int k = 0; k < bytes; k++)
+    {
+        saida_byte(escritor->saida, (uint8_t)(escritor->acumulador >> (56 - 8 * k)));
+    }
+    escritor->acumulador = 0;
+    escritor->quantidade = 0;
 }
 
 /**
- * @brief É responsável por liberar a memória alocada dinamicamente para o dicionário de códigos de Huffman. 
+ * @brief   Mapeia cada byte de um trecho para seu código Huffman e junta os códigos no escritor de bits. Pode ser 
+ *          chamada várias vezes com o mesmo escritor para codificar a entrada em trechos.
  * 
- * @param dicionario    Um ponteiro para um array de ponteiros para strings que representa o dicionário de códigos de 
- *                      Huffman.
+ * @param escritor      O escritor de bits.
+ * @param dados         Os bytes do trecho.
+ * @param tamanho       A quantidade de bytes do trecho.
+ * @param codigos       A tabela de códigos de Huffman, sem códigos vazios.
  */
-void free_dicionario(uint8_t **dicionario)
+void codificar_bytes(EscritorBits *escritor, const uint8_t *dados, size_t tamanho, Codigo *codigos)
 {
-    for(int i = 0; i < 256; i++)
+    for(size_t i = 0; i < tamanho; i++)
     {
-        free(dicionario[i]);
+        Codigo codigo = codigos[dados[i]];
+        escritor_escrever(escritor, codigo.bits, codigo.tamanho);
     }
-    free(dicionario);
-    return;
 }
 
 /**
- * @brief É responsável por liberar a memória alocada dinamicamente para a nossa árvore de Huffman. 
+ * @brief   Em resumo, essa função lê os dados originais, mapeia cada byte para seu código Huffman correspondente 
+ *          e escreve os bits compactados no arquivo comprimido, garantindo que os bytes sejam escritos corretamente 
+ *          no arquivo, mesmo quando eles não formam múltiplos de 8 bits.
  * 
- * @param raiz  Um ponteiro para a raiz da nossa árvore de Huffman.
+ * @param saida                 A saída na qual os bits compactados serão escritos.
+ * @param dados                 Um ponteiro para um array de bytes contendo os dados originais que serão compactados.
+ * @param codigos               A tabela de códigos de Huffman que mapeia cada byte para sua representação compactada.
+ * @param tamanho_arquivo       O tamanho do array de dados (número de bytes) que serão compactados e escritos no 
+ *                              arquivo.
  */
-void free_arvore_huffman(Arvore *raiz)
+void escrever_bits_compactados(Saida *saida, uint8_t *dados, Codigo *codigos, size_t tamanho_arquivo)
 {
-    if(raiz == NULL)
+    //uma arvore de um unico no gera codigos vazios, entao nao ha bits para escrever
+    if(tamanho_arquivo == 0 || codigos[dados[0]].tamanho == 0)
     {
         return;
     }
-    free_arvore_huffman(raiz->esquerda);
-    free_arvore_huffman(raiz->direita);
-    free(raiz->byte);
-    free(raiz);
+    EscritorBits escritor;
+    iniciar_escritor_bits(&escritor, saida);
+    codificar_bytes(&escritor, dados, tamanho_arquivo, codigos);
+    finalizar_escritor_bits(&escritor);
+
     return;
 }
 
 /**
- * @brief   Essa função comprime um arquivo de entrada usando o algoritmo de Huffman, cria um arquivo comprimido com 
- *          a extensão ".huff" e armazena a árvore de Huffman e os bits compactados no cabeçalho do arquivo.
+ * @brief   Lê a entrada inteira em trechos e conta a frequência de cada byte. Se a entrada não puder ser relida 
+ *          (pipe ou entrada padrão), cada trecho também é copiado para um arquivo temporário.
  * 
- * @param nome_arquivo  Uma string contendo o nome do arquivo que será comprimido.
+ * @param arquivo       O arquivo de entrada.
+ * @param copia         O arquivo temporário onde os trechos são copiados, ou NULL.
+ * @param trecho        Um buffer de TAMANHO_TRECHO_LEITURA bytes.
+ * @param frequencia    A tabela de frequências, que deve começar zerada.
+ * @param estatisticas  Onde o tempo da leitura e da contagem é somado, ou NULL.
+ * @param total         Recebe o total de bytes lidos.
+ * @return              NULL se deu certo, senão a mensagem do erro.
  */
-void comprimir(char *nome_arquivo)
+const char* contar_frequencias(FILE *arquivo, FILE *copia, uint8_t *trecho, long *frequencia, 
+                               Estatisticas *estatisticas, uint64_t *total)
 {
-    //cria a fila de frequências
-    Arvore *fila = NULL;
-    //criando arvore de huffman
-    Arvore *arvore_huffman = NULL;
-    //criando a variavel do dicionario
-    uint8_t **dicionario; 
-    //criando a variavel auxiliar para preencher o dicionario
-    uint8_t *aux;
-
-    //abrindo o arquivo
-    FILE *arquivo = fopen(nome_arquivo, "rb"), *arquivo_comprimido;
-    if(arquivo == NULL)
+    size_t lidos;
+    *total = 0;
+    while(true)
     {
-        printf("\nArquivo não encontrado!\n");
-        exit(1);
+        uint64_t marca = iniciar_entrada_saida(estatisticas);
+        lidos = fread(trecho, 1, TAMANHO_TRECHO_LEITURA, arquivo);
+        terminar_entrada_saida(estatisticas, FASE_LEITURA, marca);
+        if(lidos == 0)
+        {
+            break;
+        }
+        marca = iniciar_fase(estatisticas);
+        histograma_bytes(trecho, lidos, frequencia);
+        terminar_fase(estatisticas, FASE_HISTOGRAMA, marca);
+        if(copia != NULL && fwrite(trecho, 1, lidos, copia) != lidos)
+        {
+            return "Erro ao gravar a cópia temporária da entrada";
+        }
+        *total += lidos;
     }
+    return ferror(arquivo) ? "Erro ao ler o arquivo" : NULL;
+}
 
-    //criando a variavel que vai manter todos os bytes
-    uint8_t *dados;
-    //criando a tabela de frequencia
-    long frequencia[Max_table], i;
-
-    //lendo os bytes do arquivo
-    //procura o fim do arquivo
-    fseek(arquivo, 0, SEEK_END);
-    //pega o tamanho do arquivo
-    long tamanho_arquivo = ftell(arquivo);
-    //volta o ponteiro para o inicio do arquivo
-    fseek(arquivo, 0, SEEK_SET);
-    //aloca memoria para a variavel dados que usaremos para pegar todos os bytes do arquivo
-    dados = malloc(tamanho_arquivo);
-    if(dados == NULL)
-    {
-        printf("\nNão foi possível alocar memória para o vetor do arquivo\n");
-        exit(1);
+/**
+ * @brief   Garante que nenhum código da árvore passe de limite bits. Se a árvore já respeita o limite ela não muda; 
+ *          senão ela é refeita, na mesma arena, com os códigos canônicos dos tamanhos calculados pelo package-merge.
+ * 
+ * @param arena             A arena onde está a árvore.
+ * @param arvore_huffman    A árvore, que pode ser trocada por uma nova.
+ * @param frequencia        A frequência de cada byte.
+ * @param limite            O maior tamanho de código permitido, 0 para não limitar.
+ * @return                  Quantos bits a mais a entrada ocupa por causa do limite.
+ */
+long limitar_arvore_huffman(ArenaArvore *arena, Arvore **arvore_huffman, long *frequencia, int limite)
+{
+    if(limite <= 0 || *arvore_huffman == NULL || altura_arvore(*arvore_huffman) <= limite)
+    {
+        return 0;
     }
-    //setando os bytes para 0
-    memset(dados, 0, tamanho_arquivo);
-    //pegando todos os bytes do arquivo
-    fread(dados, 1, tamanho_arquivo, arquivo);
-    //fechando o arquivo
-    fclose(arquivo);
+    Codigo codigos[Max_table];
+    uint8_t tamanhos[Max_table];
+    memset(codigos, 0, sizeof(codigos));
+    gerar_codigos(codigos, *arvore_huffman, 0, 0);
+    uint64_t bits_sem_limite = bits_compactados(codigos, frequencia);
 
-    //iniciando as frequencias como 0
-    memset(frequencia, 0, Max_table*sizeof(long));
+    tamanhos_limitados(frequencia, limite, tamanhos);
+    *arvore_huffman = arvore_de_tamanhos(arena, tamanhos);
 
-    //obtendo frequencias dos bytes
-    for(i = 0; i < tamanho_arquivo; i++)
-    {
-        //pegando a frequencia de cada byte
-        frequencia[dados[i]]++;
-    }
-    
-    //montando a lista de frequência
-    for(i = 0; i < Max_table; i++)
+    memset(codigos, 0, sizeof(codigos));
+    gerar_codigos(codigos, *arvore_huffman, 0, 0);
+    return (long)(bits_compactados(codigos, frequencia) - bits_sem_limite);
+}
+
+/**
+ * @brief   Mostra quanto a compressão perdeu por limitar o tamanho dos códigos.
+ * 
+ * @param limite        O limite usado.
+ * @param bits_extras   Quantos bits a mais a saída tem por causa do limite.
+ * @param bits_total    O total de bits codificados, já com o limite.
+ */
+void relatar_limite(int limite, long bits_extras, long bits_total)
+{
+    fprintf(stderr, "\nCódigos limitados a %d bits: %ld bits a mais (%.4f%% do tamanho comprimido)\n", limite, 
+            bits_extras, bits_total > 0 ? 100.0 * bits_extras / bits_total : 0.0);
+}
+
+/**
+ * @brief   Codifica os fluxos de um bloco intercalado, um depois do outro: o fluxo k tem os bytes k, k + fluxos, 
+ *          k + 2 * fluxos... e termina num byte inteiro. O cabeçalho do bloco já está na saída, com o espaço do 
+ *          tamanho de cada fluxo reservado logo antes dos fluxos; os tamanhos e o lixo do último fluxo são 
+ *          preenchidos no fim.
+ * 
+ * @param saida     A saída em memória do bloco, com o cabeçalho.
+ * @param dados     Os bytes do bloco.
+ * @param tamanho   A quantidade de bytes do bloco.
+ * @param codigos   Os códigos canônicos de cada byte.
+ * @param fluxos    A quantidade de fluxos.
+ */
+void escrever_fluxos_intercalados(Saida *saida, const uint8_t *dados, size_t tamanho, Codigo *codigos, int fluxos)
+{
+    size_t tamanhos = saida->posicao - 4 * (fluxos - 1);
+    int bits_de_lixo = 0;
+    EscritorBits escritor;
+    for(int k = 0; k < fluxos; k++)
     {
-        //avaliando se a frequencia e igual a 0 para nao pegarmos o byte que nao tem no arquivo
-        if(frequencia[i] != 0)
+        size_t inicio = saida->posicao;
+        iniciar_escritor_bits(&escritor, saida);
+        for(size_t i = k; i < tamanho; i += fluxos)
+        {
+            escritor_escrever(&escritor, codigos[dados[i]].bits, codigos[dados[i]].tamanho);
+        }
+        bits_de_lixo = (64 - escritor.quantidade) % 8;
+        finalizar_escritor_bits(&escritor);
+        if(saida->erro)
+        {
+            return;
+        }
+        if(k < fluxos - 1)
         {
-            //fazendo o cast da variavel i para do tipo unsigned char
-            (uint8_t)i;
-            //insere na fila de frequencia de maneira organizada
-            enfileirar(&fila, novo_no_arvore(&i, frequencia[i]));
+            uint32_t tamanho_fluxo = (uint32_t)(saida->posicao - inicio);
+            for(int b = 0; b < 4; b++)
+            {
+                saida->buffer[tamanhos + 4 * k + b] = (uint8_t)(tamanho_fluxo >> (24 - 8 * b));
+            }
         }
     }
+    saida->buffer[0] |= (uint8_t)(bits_de_lixo << 5);
+}
 
-    //criando a arvore de huffman
-    criar_arvore_huffman(&fila, &arvore_huffman);
+/**
+ * @brief   Comprime um bloco do formato em blocos. No bloco com árvore o conteúdo é igual a um arquivo no formato 
+ *          antigo: os 2 bytes de lixo e tamanho da árvore, a árvore em pré-ordem e os bits. No bloco canônico o 
+ *          primeiro byte tem o lixo nos 3 bits mais altos, seguido do tamanho do código de cada byte e dos bits; um 
+ *          bloco com um único byte diferente não tem bits. Se pelo cabeçalho e pela soma de frequência vezes tamanho 
+ *          do código o conteúdo não ficar menor que o bloco, nenhum bit é codificado e o bloco vai sem compressão: a 
+ *          saída fica vazia e quem chamou grava os próprios bytes do bloco. Um bloco canônico com mais de um fluxo e 
+ *          pelo menos dois bytes diferentes vira um bloco intercalado, com os códigos limitados a 
+ *          TAMANHO_CODIGO_INTERCALADO bits. Não usa nada global, então vários blocos podem ser comprimidos ao mesmo 
+ *          tempo.
+ * 
+ * @param dados         Os bytes do bloco.
+ * @param tamanho       A quantidade de bytes do bloco.
+ * @param canonico      true para um bloco canônico, false para um bloco com árvore.
+ * @param fluxos        Em quantos fluxos de bits um bloco canônico é dividido, 1 para um fluxo só.
+ * @param limite        O maior tamanho de código permitido, 0 para não limitar.
+ * @param bits_extras   Recebe quantos bits a mais o bloco ocupa por causa do limite.
+ * @param tipo          Recebe o tipo do bloco: BLOCO_CANONICO, BLOCO_INTERCALADO, BLOCO_HUFFMAN ou BLOCO_BRUTO.
+ * @param arena         A arena usada para a árvore do bloco.
+ * @param saida         A saída em memória que recebe o conteúdo do bloco.
+ * @param estatisticas  Onde as medidas do bloco são somadas, ou NULL.
+ * @return              false se a árvore tiver códigos grandes demais ou a saída falhar.
+ */
+bool comprimir_bloco(const uint8_t *dados, size_t tamanho, bool canonico, int fluxos, int limite, long *bits_extras, 
+                     uint8_t *tipo, ArenaArvore *arena, Saida *saida, Estatisticas *estatisticas)
+{
+    long frequencia[Max_table];
+    Codigo codigos[Max_table];
 
-    //pegando a altura da arvore
-    long altura_da_arvore = altura_arvore(arvore_huffman);
-    //pegando o tamanho da arvore
-    long tamanho_da_arvore = tamanho_arvore(arvore_huffman);
+    uint64_t marca = iniciar_fase(estatisticas);
+    memset(frequencia, 0, sizeof(frequencia));
+    histograma_bytes(dados, tamanho, frequencia);
+    terminar_fase(estatisticas, FASE_HISTOGRAMA, marca);
 
-    
-    //criando o dicionário
-    dicionario = criar_dicionario(altura_da_arvore + 1);
+    //com um unico byte diferente nao ha bits, entao nao ha o que intercalar
+    int distintos = 0;
+    for(int i = 0; i < Max_table; i++)
+    {
+        distintos += frequencia[i] != 0;
+    }
+    bool intercalado = canonico && fluxos > 1 && distintos > 1;
+    if(intercalado && (limite <= 0 || limite > TAMANHO_CODIGO_INTERCALADO))
+    {
+        limite = TAMANHO_CODIGO_INTERCALADO;
+    }
 
-    //criando o vetor auxiliar para preencher o dicionario
-    aux = (uint8_t*)malloc(sizeof(uint8_t) * (altura_da_arvore + 1));
-    if(aux == NULL)
+    marca = iniciar_fase(estatisticas);
+    Arvore *arvore_huffman = construir_arvore_huffman(arena, frequencia);
+    *bits_extras = limitar_arvore_huffman(arena, &arvore_huffman, frequencia, limite);
+    long altura = altura_arvore(arvore_huffman);
+    terminar_fase(estatisticas, FASE_ARVORE, marca);
+    if(altura > Max_tamanho_codigo)
     {
-        printf("\nNão foi possível alocar memória para o array auxiliar\n");
-        exit(1);
+        return false;
     }
-    
-    //preenchendo o dicionario
-    gerar_codigos(dicionario, arvore_huffman, 0, aux);
-    
-    //calculo do lixo de bits
-    int bits_de_lixo = lixo(dicionario, frequencia);
-    //mudanca do nome, exemplo: arquivo.txt vira arquivo.txt.huff
-    for(i = 0; i != 106; i++)
+    marca = iniciar_fase(estatisticas);
+    memset(codigos, 0, sizeof(codigos));
+    if(arvore_huffman != NULL)
     {
-        if(nome_arquivo[i] == '\0' && i + 6 <= 106)
+        gerar_codigos(codigos, arvore_huffman, 0, 0);
+    }
+    //no bloco canonico os tamanhos continuam os da arvore e os codigos passam a ser os canonicos; um unico byte 
+    //fica com tamanho 1 no cabecalho e sem bits
+    uint8_t tamanhos[Max_table];
+    if(canonico)
+    {
+        uint64_t bits[Max_table];
+        for(int i = 0; i < Max_table; i++)
         {
-            nome_arquivo[i] = '.';
-            nome_arquivo[i + 1] = 'h';
-            nome_arquivo[i + 2] = 'u';
-            nome_arquivo[i + 3] = 'f';
-            nome_arquivo[i + 4] = 'f';
-            nome_arquivo[i + 5] = '\0';
-            break;
+            tamanhos[i] = frequencia[i] != 0 && codigos[i].tamanho == 0 ? 1 : codigos[i].tamanho;
+        }
+        codigos_canonicos(tamanhos, bits);
+        for(int i = 0; i < Max_table; i++)
+        {
+            codigos[i].bits = codigos[i].tamanho != 0 ? bits[i] : 0;
         }
     }
+    long bits = bits_compactados(codigos, frequencia);
+    int bits_de_lixo = (8 - bits % 8) % 8;
+    terminar_fase(estatisticas, FASE_CODIGOS, marca);
 
-    //escrevendo o arquivo comprimido
-    arquivo_comprimido = fopen(nome_arquivo,"wb");
-    if(arquivo_comprimido == NULL)
+    *tipo = intercalado ? BLOCO_INTERCALADO : canonico ? BLOCO_CANONICO : BLOCO_HUFFMAN;
+    //cada fluxo termina num byte inteiro, entao o bloco intercalado pode ter ate 7 bits de lixo por fluxo
+    long bits_reservados = bits;
+    if(intercalado)
     {
-        printf("\nNão foi possível abrir o arquivo de saída\n");
-        exit(1);
+        //o lixo do ultimo fluxo so e conhecido depois de codificar, e o tamanho dos fluxos fica reservado
+        saida_byte(saida, (uint8_t)fluxos);
+        escrever_tamanhos_canonicos(saida, tamanhos);
+        for(int k = 0; k < fluxos - 1; k++)
+        {
+            saida_u32(saida, 0);
+        }
+        bits_reservados = bits + 7 * fluxos;
     }
-    //escrevendo o cabecalho
-    escrever_cabecalho_no_arquivo(arquivo_comprimido, bits_de_lixo, tamanho_da_arvore, arvore_huffman);
-    //escrevendo os bytes compactados
-    escrever_bits_compactados(arquivo_comprimido, dados, dicionario, tamanho_arquivo);
-    //fechando o arquivo
-    fclose(arquivo_comprimido);
-
-    printf("\nArquivo comprimido com sucesso!!!\n");
-
-    //libera a memoria do dicionario
-    free_dicionario(dicionario);
-    //libera a memoria da arvore
-    free_arvore_huffman(arvore_huffman);
-    //libera a memoria do vetor auxiliar
-    free(aux);
-    //libera a memoria alocada para o vetor dados
-    free(dados);
-    aux = NULL;
-    dicionario = NULL;
-    arvore_huffman = NULL;
-    dados = NULL;
-    
-    return;
+    else if(canonico)
+    {
+        saida_byte(saida, (uint8_t)(bits_de_lixo << 5));
+        escrever_tamanhos_canonicos(saida, tamanhos);
+    }
+    else
+    {
+        escrever_cabecalho_no_arquivo(saida, bits_de_lixo, tamanho_arvore(arvore_huffman), arvore_huffman);
+    }
+    //o cabecalho ja esta na saida e os bits sao conhecidos pelas frequencias, entao da para saber o tamanho final 
+    //antes de codificar; um cabecalho que nao coube numa saida de capacidade fixa tambem leva ao bloco sem 
+    //compressao, que nao usa a saida
+    if(saida->erro || saida->posicao + (size_t)(bits_reservados / 8) >= tamanho)
+    {
+        saida->posicao = 0;
+        saida->erro = false;
+        *tipo = BLOCO_BRUTO;
+        return true;
+    }
+    ESTATISTICA_SOMAR(estatisticas, bytes_cabecalho, saida->posicao);
+    ESTATISTICA_SOMAR(estatisticas, bits_lixo, bits_de_lixo);
+    ESTATISTICA_SOMAR(estatisticas, simbolos, tamanho);
+    registrar_maior_codigo(estatisticas, altura);
+    marca = iniciar_fase(estatisticas);
+    if(intercalado)
+    {
+        escrever_fluxos_intercalados(saida, dados, tamanho, codigos, fluxos);
+    }
+    else
+    {
+        escrever_bits_compactados(saida, (uint8_t*)dados, codigos, tamanho);
+    }
+    terminar_fase(estatisticas, FASE_CODIFICACAO, marca);
+    return !saida->erro;
+}
+
+/**
+ * @brief   Ajusta as opções do formato em blocos para valores aceitos: o tamanho dos blocos entre o mínimo e o 
+ *          máximo, pelo menos uma thread, de 1 a FLUXOS_MAXIMO fluxos e o limite do tamanho dos códigos entre 0 e 
+ *          Max_tamanho_codigo.
+ * 
+ * @param opcoes    As opções pedidas.
+ * @return          As opções ajustadas.
+ */
+OpcoesCompressao opcoes_blocos_validas(const OpcoesCompressao *opcoes)
+{
+    OpcoesCompressao validas = *opcoes;
+    if(validas.tamanho_bloco < TAMANHO_BLOCO_MINIMO)
+    {
+        validas.tamanho_bloco = TAMANHO_BLOCO_MINIMO;
+    }
+    if(validas.tamanho_bloco > TAMANHO_BLOCO_MAXIMO)
+    {
+        validas.tamanho_bloco = TAMANHO_BLOCO_MAXIMO;
+    }
+    if(validas.threads < 1)
+    {
+        validas.threads = 1;
+    }
+    if(validas.fluxos < 1)
+    {
+        validas.fluxos = 1;
+    }
+    if(validas.fluxos > FLUXOS_MAXIMO)
+    {
+        validas.fluxos = FLUXOS_MAXIMO;
+    }
+    if(validas.limite_codigo < 0)
+    {
+        validas.limite_codigo = 0;
+    }
+    if(validas.limite_codigo > Max_tamanho_codigo)
+    {
+        validas.limite_codigo = Max_tamanho_codigo;
+    }
+    return validas;
+}
+
+/**
+ * @brief   Escreve o cabeçalho do formato em blocos.
+ * 
+ * @param saida             A saída.
+ * @param limite            O limite do tamanho dos códigos, 0 se não houver.
+ * @param tamanho_bloco     O tamanho dos blocos.
+ * @param tamanho_original  O tamanho total da entrada, ou TAMANHO_DESCONHECIDO se ele só é conhecido no fim.
+ */
+void escrever_cabecalho_blocos(Saida *saida, int limite, size_t tamanho_bloco, uint64_t tamanho_original)
+{
+    uint8_t reservado[2] = {0, 0};
+    saida_escrever(saida, MAGICO_BLOCOS, 3);
+    saida_byte(saida, VERSAO_BLOCOS);
+    saida_byte(saida, FLAG_INDICE_BLOCOS);
+    saida_byte(saida, (uint8_t)limite);
+    saida_escrever(saida, reservado, 2);
+    saida_u32(saida, (uint32_t)tamanho_bloco);
+    saida_u64(saida, tamanho_original);
+}
+
+/**
+ * @brief   Escreve uma entrada do índice dos blocos.
+ * 
+ * @param saida     A saída.
+ * @param bloco     A entrada do índice.
+ */
+void escrever_entrada_indice(Saida *saida, IndiceBloco *bloco)
+{
+    saida_u64(saida, bloco->deslocamento);
+    saida_u64(saida, bloco->bits);
+    saida_u32(saida, bloco->tamanho_original);
+}
+
+/**
+ * @brief   Escreve o rodapé do formato em blocos, depois do índice.
+ * 
+ * @param saida                 A saída.
+ * @param quantidade_blocos     A quantidade de blocos.
+ * @param deslocamento_indice   Onde o índice começa.
+ * @param tamanho_total         O tamanho original total.
+ */
+void escrever_rodape_blocos(Saida *saida, uint64_t quantidade_blocos, uint64_t deslocamento_indice, 
+                            uint64_t tamanho_total)
+{
+    saida_u64(saida, quantidade_blocos);
+    saida_u64(saida, deslocamento_indice);
+    saida_u64(saida, tamanho_total);
+    saida_escrever(saida, MAGICO_BLOCOS, 3);
+    saida_byte(saida, VERSAO_BLOCOS);
+}
+
+//um bloco a ser comprimido por uma das threads, com a saida em memoria onde o resultado fica ate ser gravado
+typedef struct tarefa_bloco
+{
+    const uint8_t *dados;
+    size_t tamanho;
+    bool canonico;
+    int fluxos;
+    int limite_codigo;
+    long bits_extras;
+    uint8_t tipo;
+    ArenaArvore arena;
+    Saida saida;
+    Estatisticas *estatisticas;
+    bool ok;
+} TarefaBloco;
+
+/**
+ * @brief   Tarefa do pool de threads que comprime o bloco de índice i de um lote.
+ * 
+ * @param argumento     O array de tarefas do lote.
+ * @param indice        O índice do bloco no lote.
+ */
+void comprimir_tarefa_bloco(void *argumento, size_t indice)
+{
+    TarefaBloco *tarefa = (TarefaBloco*)argumento + indice;
+    tarefa->saida.posicao = 0;
+    tarefa->saida.erro = false;
+    tarefa->ok = comprimir_bloco(tarefa->dados, tarefa->tamanho, tarefa->canonico, tarefa->fluxos, 
+                                 tarefa->limite_codigo, &tarefa->bits_extras, &tarefa->tipo, &tarefa->arena, 
+                                 &tarefa->saida, tarefa->estatisticas);
+    registrar_bloco(tarefa->estatisticas, numero_thread_pool);
+}
+
+/**
+ * @brief   Comprime uma entrada no formato em blocos. A entrada é lida em lotes de dois blocos por thread; os 
+ *          blocos de um lote são comprimidos em paralelo, cada um com a sua árvore, e gravados na ordem original. 
+ *          A memória usada depende só do tamanho do lote, e a entrada pode ser um pipe. Um arquivo comum é mapeado 
+ *          em memória e os blocos são comprimidos direto do mapeamento. No fim vai o índice com a 
+ *          posição de cada bloco, usado para descomprimir os blocos em paralelo.
+ * 
+ * @param arquivo               O arquivo de entrada, aberto para leitura.
+ * @param arquivo_comprimido    O arquivo onde o resultado será gravado.
+ * @param opcoes                O tamanho dos blocos e o número de threads.
+ * @return                      NULL se deu certo, senão a mensagem do erro.
+ */
+const char* comprimir_blocos(FILE *arquivo, FILE *arquivo_comprimido, OpcoesCompressao *opcoes)
+{
+    OpcoesCompressao validas = opcoes_blocos_validas(opcoes);
+    size_t tamanho_bloco = validas.tamanho_bloco;
+    int threads = validas.threads;
+    int limite = validas.limite_codigo;
+    Estatisticas *estatisticas = validas.estatisticas;
+    size_t lote = (size_t)threads * 2;
+    const char *erro = NULL;
+
+    //um arquivo comum e mapeado e os blocos apontam direto para o mapeamento; senao cada lote e lido para um buffer
+    Mapeamento mapa;
+    bool mapeado = mapear_leitura(&mapa, arquivo);
+    size_t consumidos = 0;
+    uint8_t *dados = mapeado ? NULL : (uint8_t*)malloc(lote * tamanho_bloco);
+    uint8_t *buffer_leitura = dados;
+    TarefaBloco *tarefas = (TarefaBloco*)calloc(lote, sizeof(TarefaBloco));
+    if((dados == NULL && !mapeado) || tarefas == NULL)
+    {
+        erro = "Não foi possível alocar memória para os blocos";
+    }
+    ESTATISTICA_SOMAR(estatisticas, alocacoes, mapeado ? 1 : 2);
+    for(size_t k = 0; erro == NULL && k < lote; k++)
+    {
+        if(!saida_memoria_crescente(&tarefas[k].saida, tamanho_bloco + tamanho_bloco / 8))
+        {
+            erro = "Não foi possível alocar memória para os blocos";
+        }
+        tarefas[k].saida.estatisticas = estatisticas;
+        tarefas[k].estatisticas = estatisticas;
+    }
+    ESTATISTICA_SOMAR(estatisticas, alocacoes, lote);
+    //o pool sempre e criado, para ser destruido no fim mesmo se uma alocacao anterior falhou
+    PoolThreads pool;
+    if(!pool_criar(&pool, erro == NULL ? threads : 1) && erro == NULL)
+    {
+        erro = "Não foi possível criar as threads";
+    }
+
+    Saida saida;
+    bool saida_criada = erro == NULL && saida_arquivo(&saida, arquivo_comprimido, TAMANHO_BUFFER_SAIDA_PADRAO);
+    if(erro == NULL && !saida_criada)
+    {
+        erro = "Não foi possível alocar o buffer de saída";
+    }
+
+    //indice dos blocos, gravado no fim para permitir descomprimir os blocos em paralelo
+    IndiceBloco *indice = NULL;
+    uint64_t quantidade_blocos = 0, capacidade_indice = 0, tamanho_total = 0;
+    long bits_extras = 0, bits_total = 0;
+
+    if(erro == NULL)
+    {
+        saida.estatisticas = estatisticas;
+        ESTATISTICA_SOMAR(estatisticas, alocacoes, 1);
+        //cabecalho do formato em blocos; so a entrada mapeada tem o tamanho conhecido antes de ser lida
+        escrever_cabecalho_blocos(&saida, limite, tamanho_bloco, 
+                                  mapeado ? (uint64_t)mapa.tamanho : TAMANHO_DESCONHECIDO);
+    }
+
+    while(erro == NULL)
+    {
+        size_t lidos;
+        if(mapeado)
+        {
+            dados = mapa.dados + consumidos;
+            lidos = mapa.tamanho - consumidos < lote * tamanho_bloco ? mapa.tamanho - consumidos : lote * tamanho_bloco;
+            consumidos += lidos;
+        }
+        else
+        {
+            uint64_t marca = iniciar_entrada_saida(estatisticas);
+            lidos = fread(dados, 1, lote * tamanho_bloco, arquivo);
+            terminar_entrada_saida(estatisticas, FASE_LEITURA, marca);
+        }
+        size_t blocos = (lidos + tamanho_bloco - 1) / tamanho_bloco;
+        for(size_t k = 0; k < blocos; k++)
+        {
+            tarefas[k].dados = dados + k * tamanho_bloco;
+            tarefas[k].tamanho = lidos - k * tamanho_bloco < tamanho_bloco ? lidos - k * tamanho_bloco : tamanho_bloco;
+            tarefas[k].canonico = opcoes->canonico;
+            tarefas[k].fluxos = validas.fluxos;
+            tarefas[k].limite_codigo = limite;
+        }
+        pool_executar(&pool, comprimir_tarefa_bloco, tarefas, blocos);
+        //gravando os blocos do lote na ordem
+        for(size_t k = 0; k < blocos && erro == NULL; k++)
+        {
+            if(!tarefas[k].ok)
+            {
+                erro = "Erro ao comprimir um bloco";
+                break;
+            }
+            if(quantidade_blocos == capacidade_indice)
+            {
+                capacidade_indice = capacidade_indice ? capacidade_indice * 2 : 64;
+                IndiceBloco *novo = (IndiceBloco*)realloc(indice, sizeof(IndiceBloco) * capacidade_indice);
+                if(novo == NULL)
+                {
+                    erro = "Não foi possível alocar memória para o índice dos blocos";
+                    break;
+                }
+                indice = novo;
+                ESTATISTICA_SOMAR(estatisticas, alocacoes, 1);
+            }
+            //um bloco sem compressao e gravado direto dos dados de entrada
+            bool bruto = tarefas[k].tipo == BLOCO_BRUTO;
+            const uint8_t *conteudo = bruto ? tarefas[k].dados : tarefas[k].saida.buffer;
+            size_t tamanho_conteudo = bruto ? tarefas[k].tamanho : tarefas[k].saida.posicao;
+            //o lixo do bloco fica nos 3 bits mais altos do primeiro byte do conteudo
+            indice[quantidade_blocos].deslocamento = saida_tamanho(&saida);
+            indice[quantidade_blocos].bits = (uint64_t)tamanho_conteudo * 8 - (bruto ? 0 : conteudo[0] >> 5);
+            indice[quantidade_blocos].tamanho_original = (uint32_t)tarefas[k].tamanho;
+            bits_extras += tarefas[k].bits_extras;
+            bits_total += indice[quantidade_blocos].bits;
+            quantidade_blocos++;
+            tamanho_total += tarefas[k].tamanho;
+
+            saida_byte(&saida, tarefas[k].tipo);
+            saida_u32(&saida, (uint32_t)tarefas[k].tamanho);
+            saida_u32(&saida, (uint32_t)tamanho_conteudo);
+            saida_escrever(&saida, conteudo, tamanho_conteudo);
+        }
+        if(lidos < lote * tamanho_bloco)
+        {
+            break;
+        }
+    }
+
+    if(erro == NULL)
+    {
+        saida_byte(&saida, BLOCO_FIM);
+        //indice e rodape
+        uint64_t deslocamento_indice = saida_tamanho(&saida);
+        for(uint64_t k = 0; k < quantidade_blocos; k++)
+        {
+            escrever_entrada_indice(&saida, &indice[k]);
+        }
+        escrever_rodape_blocos(&saida, quantidade_blocos, deslocamento_indice, tamanho_total);
+        ESTATISTICA_SOMAR(estatisticas, bytes_entrada, tamanho_total);
+        ESTATISTICA_SOMAR(estatisticas, bytes_saida, saida_tamanho(&saida));
+        ESTATISTICA_SOMAR(estatisticas, bytes_cabecalho, TAMANHO_CABECALHO_BLOCOS + 1 + TAMANHO_RODAPE_BLOCOS + 
+                          quantidade_blocos * (TAMANHO_CABECALHO_BLOCO + TAMANHO_ENTRADA_INDICE));
+    }
+    if(saida_criada && !saida_finalizar(&saida) && erro == NULL)
+    {
+        erro = "Erro ao gravar o arquivo comprimido";
+    }
+    if(erro == NULL && !mapeado && ferror(arquivo))
+    {
+        erro = "Erro ao ler o arquivo";
+    }
+    if(erro == NULL && limite > 0)
+    {
+        relatar_limite(limite, bits_extras, bits_total);
+    }
+
+    pool_destruir(&pool);
+    for(size_t k = 0; tarefas != NULL && k < lote; k++)
+    {
+        free(tarefas[k].saida.buffer);
+    }
+    free(tarefas);
+    free(indice);
+    free(buffer_leitura);
+    desmapear(&mapa);
+    return erro;
+}
+
+//compressor do fluxo adaptativo: o modelo e os codigos canonicos que saem dele
+typedef struct compressor_adaptativo
+{
+    ModeloAdaptativo modelo;
+    Codigo codigos[Max_table];
+} CompressorAdaptativo;
+
+/**
+ * @brief   Refaz os códigos do compressor a partir do tamanho dos códigos do modelo.
+ * 
+ * @param compressor    O compressor.
+ * @return              O tamanho do maior código.
+ */
+int codigos_adaptativos(CompressorAdaptativo *compressor)
+{
+    uint64_t bits[Max_table];
+    int maior = 0;
+    codigos_canonicos(compressor->modelo.tamanhos, bits);
+    for(int i = 0; i < Max_table; i++)
+    {
+        compressor->codigos[i].bits = bits[i];
+        compressor->codigos[i].tamanho = compressor->modelo.tamanhos[i];
+        if(compressor->modelo.tamanhos[i] > maior)
+        {
+            maior = compressor->modelo.tamanhos[i];
+        }
+    }
+    return maior;
+}
+
+/**
+ * @brief   Escreve o cabeçalho do fluxo adaptativo: o mesmo do formato em blocos, com a flag adaptativa no lugar da 
+ *          do índice e o intervalo no lugar do tamanho dos blocos. O tamanho original fica desconhecido, porque o 
+ *          fluxo é gravado conforme a entrada chega e ela pode continuar crescendo.
+ * 
+ * @param saida         A saída.
+ * @param limite        O limite do tamanho dos códigos.
+ * @param intervalo     O intervalo entre as reconstruções dos códigos.
+ */
+void escrever_cabecalho_adaptativo(Saida *saida, int limite, size_t intervalo)
+{
+    uint8_t reservado[2] = {0, 0};
+    saida_escrever(saida, MAGICO_BLOCOS, 3);
+    saida_byte(saida, VERSAO_BLOCOS);
+    saida_byte(saida, FLAG_ADAPTATIVO);
+    saida_byte(saida, (uint8_t)limite);
+    saida_escrever(saida, reservado, 2);
+    saida_u32(saida, (uint32_t)intervalo);
+    saida_u64(saida, TAMANHO_DESCONHECIDO);
+}
+
+/**
+ * @brief   Comprime um trecho do fluxo adaptativo com os códigos atuais e depois soma o trecho ao modelo. Um trecho 
+ *          que não diminui é gravado sem compressão, mas entra no modelo do mesmo jeito.
+ * 
+ * @param compressor    O compressor.
+ * @param dados         Os bytes do trecho, no máximo o intervalo do modelo.
+ * @param tamanho       A quantidade de bytes, pelo menos 1.
+ * @param saida         A saída.
+ * @param estatisticas  Onde as medidas são somadas, ou NULL.
+ * @return              false se a saída falhou.
+ */
+bool comprimir_trecho_adaptativo(CompressorAdaptativo *compressor, const uint8_t *dados, size_t tamanho, 
+                                 Saida *saida, Estatisticas *estatisticas)
+{
+    long frequencia[Max_table];
+    uint64_t marca = iniciar_fase(estatisticas);
+    memset(frequencia, 0, sizeof(frequencia));
+    histograma_bytes(dados, tamanho, frequencia);
+    terminar_fase(estatisticas, FASE_HISTOGRAMA, marca);
+
+    long bits = bits_compactados(compressor->codigos, frequencia);
+    size_t tamanho_comprimido = 1 + (size_t)((bits + 7) / 8);
+    bool bruto = tamanho_comprimido >= tamanho;
+    saida_byte(saida, bruto ? BLOCO_BRUTO : BLOCO_ADAPTATIVO);
+    saida_u32(saida, (uint32_t)tamanho);
+    saida_u32(saida, (uint32_t)(bruto ? tamanho : tamanho_comprimido));
+    marca = iniciar_fase(estatisticas);
+    if(bruto)
+    {
+        saida_escrever(saida, dados, tamanho);
+    }
+    else
+    {
+        saida_byte(saida, (uint8_t)(((8 - bits % 8) % 8) << 5));
+        escrever_bits_compactados(saida, (uint8_t*)dados, compressor->codigos, tamanho);
+        ESTATISTICA_SOMAR(estatisticas, bytes_cabecalho, 1);
+        ESTATISTICA_SOMAR(estatisticas, bits_lixo, (8 - bits % 8) % 8);
+        ESTATISTICA_SOMAR(estatisticas, simbolos, tamanho);
+    }
+    terminar_fase(estatisticas, FASE_CODIFICACAO, marca);
+    ESTATISTICA_SOMAR(estatisticas, bytes_cabecalho, TAMANHO_CABECALHO_BLOCO);
+    registrar_bloco(estatisticas, numero_thread_pool);
+
+    marca = iniciar_fase(estatisticas);
+    if(atualizar_modelo_adaptativo(&compressor->modelo, frequencia, tamanho))
+    {
+        registrar_maior_codigo(estatisticas, codigos_adaptativos(compressor));
+    }
+    terminar_fase(estatisticas, FASE_ARVORE, marca);
+    return !saida->erro;
+}
+
+/**
+ * @brief   Lê até tamanho bytes, mas devolve assim que houver algum: num pipe, o que já chegou é comprimido sem 
+ *          esperar o resto.
+ * 
+ * @param arquivo   O arquivo de entrada.
+ * @param destino   Onde os bytes são lidos.
+ * @param tamanho   O máximo de bytes.
+ * @param erro      Recebe true se a leitura falhou.
+ * @return          Quantos bytes foram lidos, 0 no fim do arquivo.
+ */
+size_t ler_disponivel(FILE *arquivo, uint8_t *destino, size_t tamanho, bool *erro)
+{
+#ifdef _WIN32
+    size_t lidos = fread(destino, 1, tamanho, arquivo);
+    *erro = ferror(arquivo) != 0;
+    return lidos;
+#else
+    ssize_t lidos;
+    do
+    {
+        lidos = read(fileno(arquivo), destino, tamanho);
+    } while(lidos < 0 && errno == EINTR);
+    *erro = lidos < 0;
+    return lidos > 0 ? (size_t)lidos : 0;
+#endif
+}
+
+/**
+ * @brief   Comprime um arquivo no fluxo adaptativo, numa única passada: cada leitura vira um trecho, e quando a 
+ *          leitura volta com menos que o intervalo (os dados de um pipe ainda estão chegando) o que já foi comprimido 
+ *          é gravado na hora. Assim a saída acompanha a entrada, sem esperar o fim dela.
+ * 
+ * @param arquivo               O arquivo de entrada.
+ * @param arquivo_comprimido    O arquivo onde o resultado será gravado.
+ * @param opcoes                O intervalo entre as reconstruções e o limite do tamanho dos códigos.
+ * @return                      NULL se deu certo, senão a mensagem do erro.
+ */
+const char* comprimir_adaptativo(FILE *arquivo, FILE *arquivo_comprimido, OpcoesCompressao *opcoes)
+{
+    Estatisticas *estatisticas = opcoes->estatisticas;
+    size_t intervalo = opcoes->intervalo_adaptativo;
+    if(intervalo < INTERVALO_ADAPTATIVO_MINIMO)
+    {
+        intervalo = INTERVALO_ADAPTATIVO_MINIMO;
+    }
+    if(intervalo > INTERVALO_ADAPTATIVO_MAXIMO)
+    {
+        intervalo = INTERVALO_ADAPTATIVO_MAXIMO;
+    }
+    int limite = opcoes->limite_codigo > 0 ? opcoes->limite_codigo : LIMITE_ADAPTATIVO_PADRAO;
+    if(limite < LIMITE_ADAPTATIVO_MINIMO)
+    {
+        limite = LIMITE_ADAPTATIVO_MINIMO;
+    }
+    if(limite > Max_tamanho_codigo)
+    {
+        limite = Max_tamanho_codigo;
+    }
+
+    uint8_t *trecho = (uint8_t*)malloc(intervalo);
+    CompressorAdaptativo *compressor = (CompressorAdaptativo*)malloc(sizeof(CompressorAdaptativo));
+    Saida saida;
+    if(trecho == NULL || compressor == NULL || !saida_arquivo(&saida, arquivo_comprimido, TAMANHO_BUFFER_SAIDA_PADRAO))
+    {
+        free(trecho);
+        free(compressor);
+        return "Não foi possível alocar os buffers do fluxo adaptativo";
+    }
+    saida.estatisticas = estatisticas;
+    ESTATISTICA_SOMAR(estatisticas, alocacoes, 3);
+    iniciar_modelo_adaptativo(&compressor->modelo, intervalo, limite);
+    registrar_maior_codigo(estatisticas, codigos_adaptativos(compressor));
+    escrever_cabecalho_adaptativo(&saida, limite, intervalo);
+
+    uint64_t total = 0;
+    bool erro = false;
+    while(!saida.erro)
+    {
+        uint64_t marca = iniciar_entrada_saida(estatisticas);
+        size_t lidos = ler_disponivel(arquivo, trecho, intervalo, &erro);
+        terminar_entrada_saida(estatisticas, FASE_LEITURA, marca);
+        if(lidos == 0)
+        {
+            break;
+        }
+        total += lidos;
+        //um trecho nunca passa da proxima reconstrucao, para os codigos novos valerem a partir dali
+        for(size_t feitos = 0; feitos < lidos; )
+        {
+            ModeloAdaptativo *modelo = &compressor->modelo;
+            size_t tamanho = lidos - feitos < modelo->proxima - modelo->acumulados ? lidos - feitos : 
+                             modelo->proxima - modelo->acumulados;
+            comprimir_trecho_adaptativo(compressor, trecho + feitos, tamanho, &saida, estatisticas);
+            feitos += tamanho;
+        }
+        if(lidos < intervalo)
+        {
+            saida_descarregar(&saida);
+        }
+    }
+    saida_byte(&saida, BLOCO_FIM);
+    ESTATISTICA_SOMAR(estatisticas, bytes_cabecalho, TAMANHO_CABECALHO_BLOCOS + 1);
+    ESTATISTICA_SOMAR(estatisticas, bytes_entrada, total);
+    ESTATISTICA_SOMAR(estatisticas, bytes_saida, saida_tamanho(&saida));
+    bool gravado = saida_finalizar(&saida);
+    free(trecho);
+    free(compressor);
+    if(erro)
+    {
+        return "Erro ao ler o arquivo";
+    }
+    return gravado ? NULL : "Erro ao gravar o arquivo comprimido";
+}
+
+/**
+ * @brief   Escreve o cabeçalho de um arquivo comprimido com dicionário: o mesmo do formato em blocos, com a flag do
+ *          dicionário no lugar da do índice e a identificação do dicionário no lugar do tamanho dos blocos.
+ * 
+ * @param saida             A saída.
+ * @param dicionario        O dicionário.
+ * @param tamanho_original  O tamanho da entrada, ou TAMANHO_DESCONHECIDO.
+ */
+void escrever_cabecalho_dicionario(Saida *saida, const Dicionario *dicionario, uint64_t tamanho_original)
+{
+    uint8_t reservado[2] = {0, 0};
+    saida_escrever(saida, MAGICO_BLOCOS, 3);
+    saida_byte(saida, VERSAO_BLOCOS);
+    saida_byte(saida, FLAG_DICIONARIO);
+    saida_byte(saida, 0);
+    saida_escrever(saida, reservado, 2);
+    saida_u32(saida, dicionario->id);
+    saida_u64(saida, tamanho_original);
+}
+
+/**
+ * @brief   Comprime um bloco com os códigos do dicionário, ou sem compressão se ele não diminuir. Só o histograma é
+ *          calculado, para saber o lixo e se o bloco diminui; nenhum código é montado.
+ * 
+ * @param dicionario    O dicionário.
+ * @param dados         Os bytes do bloco.
+ * @param tamanho       O tamanho do bloco, no máximo TAMANHO_BLOCO_MAXIMO.
+ * @param saida         A saída.
+ * @param estatisticas  Onde as medidas são somadas, ou NULL.
+ * @return              false se a saída falhou.
+ */
+bool comprimir_trecho_dicionario(const Dicionario *dicionario, const uint8_t *dados, size_t tamanho, Saida *saida, 
+                                 Estatisticas *estatisticas)
+{
+    long frequencia[Max_table];
+    Codigo *codigos = (Codigo*)dicionario->codigos;
+    uint64_t marca = iniciar_fase(estatisticas);
+    memset(frequencia, 0, sizeof(frequencia));
+    histograma_bytes(dados, tamanho, frequencia);
+    terminar_fase(estatisticas, FASE_HISTOGRAMA, marca);
+
+    uint64_t bits = bits_compactados(codigos, frequencia);
+    size_t tamanho_comprimido = 1 + (size_t)((bits + 7) / 8);
+    bool bruto = tamanho_comprimido >= tamanho;
+    saida_byte(saida, bruto ? BLOCO_BRUTO : BLOCO_DICIONARIO);
+    saida_u32(saida, (uint32_t)tamanho);
+    saida_u32(saida, (uint32_t)(bruto ? tamanho : tamanho_comprimido));
+    marca = iniciar_fase(estatisticas);
+    if(bruto)
+    {
+        saida_escrever(saida, dados, tamanho);
+    }
+    else
+    {
+        saida_byte(saida, (uint8_t)(((8 - bits % 8) % 8) << 5));
+        escrever_bits_compactados(saida, (uint8_t*)dados, codigos, tamanho);
+        ESTATISTICA_SOMAR(estatisticas, bytes_cabecalho, 1);
+        ESTATISTICA_SOMAR(estatisticas, bits_lixo, (8 - bits % 8) % 8);
+        ESTATISTICA_SOMAR(estatisticas, simbolos, tamanho);
+    }
+    terminar_fase(estatisticas, FASE_CODIFICACAO, marca);
+    ESTATISTICA_SOMAR(estatisticas, bytes_cabecalho, TAMANHO_CABECALHO_BLOCO);
+    registrar_bloco(estatisticas, numero_thread_pool);
+    return !saida->erro;
+}
+
+/**
+ * @brief   Comprime um arquivo com o dicionário das opções, bloco a bloco, na ordem. Um arquivo comum é mapeado e
+ *          tem o tamanho gravado no cabeçalho; um pipe é lido um bloco de cada vez.
+ * 
+ * @param arquivo               O arquivo de entrada.
+ * @param arquivo_comprimido    O arquivo onde o resultado será gravado.
+ * @param opcoes                O dicionário e o tamanho dos blocos.
+ * @return                      NULL se deu certo, senão a mensagem do erro.
+ */
+const char* comprimir_dicionario(FILE *arquivo, FILE *arquivo_comprimido, OpcoesCompressao *opcoes)
+{
+    OpcoesCompressao validas = opcoes_blocos_validas(opcoes);
+    size_t tamanho_bloco = validas.tamanho_bloco;
+    Estatisticas *estatisticas = validas.estatisticas;
+    const Dicionario *dicionario = validas.dicionario;
+    Mapeamento mapa;
+    bool mapeado = mapear_leitura(&mapa, arquivo);
+    uint8_t *bloco = mapeado ? NULL : (uint8_t*)malloc(tamanho_bloco);
+    Saida saida;
+    if((bloco == NULL && !mapeado) || !saida_arquivo(&saida, arquivo_comprimido, TAMANHO_BUFFER_SAIDA_PADRAO))
+    {
+        free(bloco);
+        desmapear(&mapa);
+        return "Não foi possível alocar os buffers de leitura e escrita";
+    }
+    saida.estatisticas = estatisticas;
+    ESTATISTICA_SOMAR(estatisticas, alocacoes, mapeado ? 1 : 2);
+    escrever_cabecalho_dicionario(&saida, dicionario, mapeado ? (uint64_t)mapa.tamanho : TAMANHO_DESCONHECIDO);
+
+    uint64_t total = 0;
+    while(!saida.erro)
+    {
+        size_t lidos;
+        const uint8_t *dados;
+        if(mapeado)
+        {
+            lidos = mapa.tamanho - total < tamanho_bloco ? (size_t)(mapa.tamanho - total) : tamanho_bloco;
+            dados = mapa.dados + total;
+        }
+        else
+        {
+            uint64_t marca = iniciar_entrada_saida(estatisticas);
+            lidos = fread(bloco, 1, tamanho_bloco, arquivo);
+            terminar_entrada_saida(estatisticas, FASE_LEITURA, marca);
+            dados = bloco;
+        }
+        if(lidos == 0)
+        {
+            break;
+        }
+        comprimir_trecho_dicionario(dicionario, dados, lidos, &saida, estatisticas);
+        total += lidos;
+    }
+    saida_byte(&saida, BLOCO_FIM);
+    ESTATISTICA_SOMAR(estatisticas, bytes_cabecalho, TAMANHO_CABECALHO_BLOCOS + 1);
+    ESTATISTICA_SOMAR(estatisticas, bytes_entrada, total);
+    ESTATISTICA_SOMAR(estatisticas, bytes_saida, saida_tamanho(&saida));
+    bool gravado = saida_finalizar(&saida);
+    free(bloco);
+    desmapear(&mapa);
+    if(!mapeado && ferror(arquivo))
+    {
+        return "Erro ao ler o arquivo";
+    }
+    return gravado ? NULL : "Erro ao gravar o arquivo comprimido";
+}
+
+//tamanho dos trechos codificados ao mesmo tempo no formato antigo, e o menor arquivo que vale dividir
+#define TRECHO_PARALELO_LEGADO (1024 * 1024)
+
+//um trecho de um arquivo antigo codificado por uma das threads: as frequencias dele, quantos bits os codigos dele 
+//ocupam, em que bit do primeiro byte ele comeca e a saida em memoria com os bytes dele
+typedef struct tarefa_trecho_legado
+{
+    const uint8_t *dados;
+    size_t tamanho;
+    Codigo *codigos;
+    long frequencia[Max_table];
+    uint64_t bits;
+    int deslocamento;
+    Saida saida;
+} TarefaTrechoLegado;
+
+/**
+ * @brief   Tarefa do pool de threads que conta as frequências do trecho de índice i.
+ * 
+ * @param argumento     O array de tarefas.
+ * @param indice        O índice do trecho.
+ */
+void histograma_tarefa_legado(void *argumento, size_t indice)
+{
+    TarefaTrechoLegado *tarefa = (TarefaTrechoLegado*)argumento + indice;
+    memset(tarefa->frequencia, 0, sizeof(tarefa->frequencia));
+    histograma_bytes(tarefa->dados, tarefa->tamanho, tarefa->frequencia);
+}
+
+/**
+ * @brief   Tarefa do pool de threads que soma o tamanho do código de cada byte do trecho de índice i.
+ * 
+ * @param argumento     O array de tarefas.
+ * @param indice        O índice do trecho.
+ */
+void contar_bits_tarefa_legado(void *argumento, size_t indice)
+{
+    TarefaTrechoLegado *tarefa = (TarefaTrechoLegado*)argumento + indice;
+    //os tamanhos numa tabela de bytes cabem em poucas linhas de cache, e 4 somas independentes nao esperam uma a outra
+    uint8_t tamanhos[Max_table];
+    uint64_t bits[4] = {0, 0, 0, 0};
+    const uint8_t *dados = tarefa->dados;
+    size_t i = 0;
+    for(int b = 0; b < Max_table; b++)
+    {
+        tamanhos[b] = (uint8_t)tarefa->codigos[b].tamanho;
+    }
+    for(; i + 4 <= tarefa->tamanho; i += 4)
+    {
+        bits[0] += tamanhos[dados[i]];
+        bits[1] += tamanhos[dados[i + 1]];
+        bits[2] += tamanhos[dados[i + 2]];
+        bits[3] += tamanhos[dados[i + 3]];
+    }
+    for(; i < tarefa->tamanho; i++)
+    {
+        bits[0] += tamanhos[dados[i]];
+    }
+    tarefa->bits = bits[0] + bits[1] + bits[2] + bits[3];
+}
+
+/**
+ * @brief   Tarefa do pool de threads que codifica o trecho de índice i na saída dele. O escritor começa com os bits 
+ *          do deslocamento já ocupados por zeros, então os bytes saem alinhados com a posição final do trecho e o 
+ *          primeiro só precisa de um OR com o último byte incompleto do trecho anterior.
+ * 
+ * @param argumento     O array de tarefas.
+ * @param indice        O índice do trecho.
+ */
+void codificar_tarefa_legado(void *argumento, size_t indice)
+{
+    TarefaTrechoLegado *tarefa = (TarefaTrechoLegado*)argumento + indice;
+    EscritorBits escritor;
+    tarefa->saida.posicao = 0;
+    tarefa->saida.erro = false;
+    iniciar_escritor_bits(&escritor, &tarefa->saida);
+    escritor.quantidade = tarefa->deslocamento;
+    codificar_bytes(&escritor, tarefa->dados, tarefa->tamanho, tarefa->codigos);
+    finalizar_escritor_bits(&escritor);
+}
+
+/**
+ * @brief   Conta as frequências de uma entrada em memória dividida em uma fatia por thread.
+ * 
+ * @param pool          O pool de threads.
+ * @param dados         Os bytes da entrada.
+ * @param tamanho       A quantidade de bytes.
+ * @param frequencia    Recebe a frequência de cada byte; deve começar zerada.
+ * @return              false se faltar memória.
+ */
+bool histograma_paralelo(PoolThreads *pool, const uint8_t *dados, size_t tamanho, long *frequencia)
+{
+    //a thread que chama tambem trabalha
+    size_t fatias = (size_t)pool->quantidade + 1, tamanho_fatia = (tamanho + fatias - 1) / fatias;
+    TarefaTrechoLegado *tarefas = (TarefaTrechoLegado*)calloc(fatias, sizeof(TarefaTrechoLegado));
+    if(tarefas == NULL)
+    {
+        return false;
+    }
+    for(size_t k = 0; k < fatias; k++)
+    {
+        size_t inicio = k * tamanho_fatia < tamanho ? k * tamanho_fatia : tamanho;
+        tarefas[k].dados = dados + inicio;
+        tarefas[k].tamanho = tamanho - inicio < tamanho_fatia ? tamanho - inicio : tamanho_fatia;
+    }
+    pool_executar(pool, histograma_tarefa_legado, tarefas, fatias);
+    for(size_t k = 0; k < fatias; k++)
+    {
+        for(int i = 0; i < Max_table; i++)
+        {
+            frequencia[i] += tarefas[k].frequencia[i];
+        }
+    }
+    free(tarefas);
+    return true;
+}
+
+/**
+ * @brief   Codifica uma entrada em memória em várias threads e grava um único fluxo de bits, igual byte a byte ao 
+ *          do escritor serial. A entrada é dividida em trechos de TRECHO_PARALELO_LEGADO bytes e processada em lotes 
+ *          de dois trechos por thread: primeiro cada thread soma os bits de um trecho, e a soma dos trechos 
+ *          anteriores dá o bit onde cada um começa; depois cada thread codifica um trecho já na posição certa 
+ *          dentro do byte, e os trechos são gravados na ordem, juntando o byte da fronteira entre dois trechos. O 
+ *          último byte incompleto vai para o próximo lote e, no fim, é completado com os zeros do lixo.
+ * 
+ * @param saida         A saída, já com o cabeçalho.
+ * @param pool          O pool de threads.
+ * @param dados         Os bytes da entrada.
+ * @param tamanho       A quantidade de bytes.
+ * @param codigos       A tabela de códigos, sem códigos vazios.
+ * @param estatisticas  Onde as alocações são somadas, ou NULL.
+ * @return              false se faltar memória.
+ */
+bool codificar_paralelo(Saida *saida, PoolThreads *pool, const uint8_t *dados, size_t tamanho, Codigo *codigos, 
+                        Estatisticas *estatisticas)
+{
+    size_t lote = ((size_t)pool->quantidade + 1) * 2;
+    TarefaTrechoLegado *tarefas = (TarefaTrechoLegado*)calloc(lote, sizeof(TarefaTrechoLegado));
+    if(tarefas == NULL)
+    {
+        return false;
+    }
+    bool ok = true;
+    for(size_t k = 0; k < lote; k++)
+    {
+        ok = ok && saida_memoria_crescente(&tarefas[k].saida, TRECHO_PARALELO_LEGADO + TRECHO_PARALELO_LEGADO / 8);
+        tarefas[k].saida.estatisticas = estatisticas;
+        tarefas[k].codigos = codigos;
+    }
+    ESTATISTICA_SOMAR(estatisticas, alocacoes, lote + 1);
+
+    //o byte incompleto do fim do ultimo trecho gravado e quantos bits dele ja estao ocupados
+    uint8_t pendente = 0;
+    int bits_pendentes = 0;
+    for(size_t consumidos = 0; ok && consumidos < tamanho; )
+    {
+        size_t trechos = 0;
+        while(trechos < lote && consumidos < tamanho)
+        {
+            tarefas[trechos].dados = dados + consumidos;
+            tarefas[trechos].tamanho = tamanho - consumidos < TRECHO_PARALELO_LEGADO ? tamanho - consumidos : 
+                                       TRECHO_PARALELO_LEGADO;
+            consumidos += tarefas[trechos].tamanho;
+            trechos++;
+        }
+        pool_executar(pool, contar_bits_tarefa_legado, tarefas, trechos);
+        int deslocamento = bits_pendentes;
+        for(size_t k = 0; k < trechos; k++)
+        {
+            tarefas[k].deslocamento = deslocamento;
+            deslocamento = (int)((deslocamento + tarefas[k].bits) % 8);
+        }
+        pool_executar(pool, codificar_tarefa_legado, tarefas, trechos);
+        for(size_t k = 0; k < trechos; k++)
+        {
+            uint8_t *bytes = tarefas[k].saida.buffer;
+            size_t quantidade = tarefas[k].saida.posicao;
+            if(tarefas[k].saida.erro)
+            {
+                ok = false;
+                break;
+            }
+            //os bits do deslocamento sao zeros no primeiro byte do trecho e ja estao no byte pendente
+            bytes[0] |= pendente;
+            bits_pendentes = (int)((tarefas[k].deslocamento + tarefas[k].bits) % 8);
+            size_t completos = bits_pendentes != 0 ? quantidade - 1 : quantidade;
+            saida_escrever(saida, bytes, completos);
+            pendente = bits_pendentes != 0 ? bytes[quantidade - 1] : 0;
+        }
+    }
+    if(ok && bits_pendentes != 0)
+    {
+        saida_byte(saida, pendente);
+    }
+    for(size_t k = 0; k < lote; k++)
+    {
+        free(tarefas[k].saida.buffer);
+    }
+    free(tarefas);
+    return ok;
+}
+
+/**
+ * @brief   Grava o arquivo no formato antigo, depois de contadas as frequências: o cabeçalho com a árvore e os bytes 
+ *          codificados, do mapeamento (em várias threads, se houver um pool) ou lidos de novo trecho a trecho.
+ * 
+ * @param arquivo_comprimido    O arquivo onde o resultado será gravado.
+ * @param pool                  O pool que divide a codificação, ou NULL.
+ * @param mapa                  A entrada mapeada, ou NULL se ela é lida de origem.
+ * @param origem                A entrada, já no início, quando não está mapeada.
+ * @param trecho                Um buffer de TAMANHO_TRECHO_LEITURA bytes para a leitura de origem.
+ * @param arvore_huffman        A árvore de Huffman.
+ * @param codigos               A tabela de códigos.
+ * @param bits_de_lixo          Os bits de lixo do último byte.
+ * @param tamanho_entrada       A quantidade de bytes da entrada.
+ * @param estatisticas          Onde as medidas são somadas, ou NULL.
+ * @return                      NULL se deu certo, senão a mensagem do erro.
+ */
+const char* gravar_legado(FILE *arquivo_comprimido, PoolThreads *pool, Mapeamento *mapa, FILE *origem, 
+                          uint8_t *trecho, Arvore *arvore_huffman, Codigo *codigos, int bits_de_lixo, 
+                          uint64_t tamanho_entrada, Estatisticas *estatisticas)
+{
+    //preparando o buffer de saida
+    Saida saida;
+    if(!saida_arquivo(&saida, arquivo_comprimido, TAMANHO_BUFFER_SAIDA_PADRAO))
+    {
+        return "Não foi possível alocar o buffer de saída";
+    }
+    saida.estatisticas = estatisticas;
+    ESTATISTICA_SOMAR(estatisticas, alocacoes, 1);
+    //escrevendo o cabecalho
+    long tamanho_da_arvore = tamanho_arvore(arvore_huffman), altura_da_arvore = altura_arvore(arvore_huffman);
+    escrever_cabecalho_no_arquivo(&saida, bits_de_lixo, tamanho_da_arvore, arvore_huffman);
+    ESTATISTICA_SOMAR(estatisticas, bytes_cabecalho, 2 + tamanho_da_arvore);
+    ESTATISTICA_SOMAR(estatisticas, bits_lixo, bits_de_lixo);
+    registrar_maior_codigo(estatisticas, altura_da_arvore);
+
+    //uma entrada vazia nao tem arvore, entao nao ha bits para escrever
+    bool ok = true;
+    if(altura_da_arvore > 0)
+    {
+        EscritorBits escritor;
+        size_t lidos;
+        uint64_t marca = iniciar_fase(estatisticas);
+        iniciar_escritor_bits(&escritor, &saida);
+        if(pool != NULL)
+        {
+            ok = codificar_paralelo(&saida, pool, mapa->dados, mapa->tamanho, codigos, estatisticas);
+        }
+        else if(mapa != NULL)
+        {
+            codificar_bytes(&escritor, mapa->dados, mapa->tamanho, codigos);
+        }
+        else
+        {
+            while(true)
+            {
+                uint64_t marca_leitura = iniciar_entrada_saida(estatisticas);
+                lidos = fread(trecho, 1, TAMANHO_TRECHO_LEITURA, origem);
+                terminar_entrada_saida(estatisticas, FASE_LEITURA, marca_leitura);
+                if(lidos == 0)
+                {
+                    break;
+                }
+                codificar_bytes(&escritor, trecho, lidos, codigos);
+            }
+        }
+        finalizar_escritor_bits(&escritor);
+        terminar_fase(estatisticas, FASE_CODIFICACAO, marca);
+        ESTATISTICA_SOMAR(estatisticas, simbolos, tamanho_entrada);
+    }
+    ESTATISTICA_SOMAR(estatisticas, bytes_entrada, tamanho_entrada);
+    ESTATISTICA_SOMAR(estatisticas, bytes_saida, saida_tamanho(&saida));
+    bool gravado = saida_finalizar(&saida);
+    if(!ok)
+    {
+        return "Não foi possível alocar memória para os trechos";
+    }
+    if(mapa == NULL && ferror(origem))
+    {
+        return "Erro ao ler o arquivo";
+    }
+    return gravado ? NULL : "Erro ao gravar o arquivo comprimido";
+}
+
+/**
+ * @brief   Comprime uma entrada já aberta em duas passadas: a primeira conta as frequências e a segunda codifica. 
+ *          Um arquivo comum é mapeado em memória e as duas passadas leem direto do cache de páginas. Nos outros 
+ *          casos a entrada é lida em trechos de tamanho fixo, então a memória usada não depende do tamanho dela, 
+ *          que pode ser um pipe ou a entrada padrão; nesse caso a primeira passada guarda uma cópia em um arquivo 
+ *          temporário. Um arquivo mapeado com mais de um trecho de TRECHO_PARALELO_LEGADO bytes é contado e 
+ *          codificado em várias threads, com o mesmo resultado da codificação serial. Com FORMATO_AUTOMATICO, um 
+ *          arquivo que não diminui no formato antigo é gravado no formato em blocos; com FORMATO_LEGADO ele é 
+ *          sempre gravado no formato antigo, mesmo maior que a entrada.
+ * 
+ * @param arquivo               O arquivo de entrada, aberto para leitura.
+ * @param arquivo_comprimido    O arquivo onde o resultado será gravado.
+ * @param opcoes                O formato, o limite do tamanho dos códigos e o número de threads. O formato passa a 
+ *                              ser o que foi gravado, FORMATO_LEGADO ou FORMATO_BLOCOS.
+ * @return                      NULL se deu certo, senão a mensagem do erro.
+ */
+const char* comprimir_arquivo(FILE *arquivo, FILE *arquivo_comprimido, OpcoesCompressao *opcoes)
+{
+    //criando arvore de huffman, com os nos numa arena na pilha
+    ArenaArvore arena;
+    Arvore *arvore_huffman = NULL;
+    //criando a tabela de codigos
+    Codigo codigos[Max_table];
+    //criando a tabela de frequencia
+    long frequencia[Max_table];
+    Estatisticas *estatisticas = opcoes->estatisticas;
+    const char *erro = NULL;
+
+    //iniciando as frequencias como 0
+    memset(frequencia, 0, Max_table*sizeof(long));
+
+    //um arquivo comum e lido direto do mapeamento, sem copias
+    Mapeamento mapa;
+    bool mapeado = mapear_leitura(&mapa, arquivo);
+    uint8_t *trecho = NULL;
+    off_t inicio = 0;
+    bool pesquisavel = false;
+    FILE *copia = NULL;
+    uint64_t total_lido = 0;
+    //so um arquivo mapeado e dividido entre as threads, porque os trechos precisam estar todos na memoria
+    bool paralelo = mapeado && opcoes->threads > 1 && mapa.tamanho > TRECHO_PARALELO_LEGADO;
+    PoolThreads pool;
+    if(paralelo && !pool_criar(&pool, opcoes->threads))
+    {
+        erro = "Não foi possível criar as threads";
+    }
+    if(erro == NULL && mapeado)
+    {
+        uint64_t marca = iniciar_fase(estatisticas);
+        if(paralelo)
+        {
+            if(!histograma_paralelo(&pool, mapa.dados, mapa.tamanho, frequencia))
+            {
+                erro = "Não foi possível alocar memória para as frequências";
+            }
+        }
+        else
+        {
+            histograma_bytes(mapa.dados, mapa.tamanho, frequencia);
+        }
+        terminar_fase(estatisticas, FASE_HISTOGRAMA, marca);
+    }
+    else if(erro == NULL)
+    {
+        //criando o buffer que vai receber cada trecho da entrada
+        trecho = (uint8_t*)malloc(TAMANHO_TRECHO_LEITURA);
+        ESTATISTICA_SOMAR(estatisticas, alocacoes, 1);
+
+        //so da para ler a entrada duas vezes se der para voltar ao inicio dela
+        inicio = ftello(arquivo);
+        pesquisavel = inicio >= 0 && fseeko(arquivo, inicio, SEEK_SET) == 0;
+        if(trecho == NULL)
+        {
+            erro = "Não foi possível alocar memória para o trecho de leitura";
+        }
+        else if(!pesquisavel && (copia = tmpfile()) == NULL)
+        {
+            erro = "Não foi possível criar a cópia temporária da entrada";
+        }
+        else
+        {
+            //obtendo frequencias dos bytes
+            erro = contar_frequencias(arquivo, copia, trecho, frequencia, estatisticas, &total_lido);
+        }
+    }
+    
+    //criando a arvore de huffman
+    uint64_t marca = iniciar_fase(estatisticas);
+    arvore_huffman = completar_arvore_legado(&arena, construir_arvore_huffman(&arena, frequencia));
+    long bits_extras = limitar_arvore_huffman(&arena, &arvore_huffman, frequencia, opcoes->limite_codigo);
+    uint64_t tamanho_entrada = mapeado ? (uint64_t)mapa.tamanho : total_lido;
+
+    //pegando a altura da arvore
+    long altura_da_arvore = altura_arvore(arvore_huffman);
+    //pegando o tamanho da arvore
+    long tamanho_da_arvore = tamanho_arvore(arvore_huffman);
+    terminar_fase(estatisticas, FASE_ARVORE, marca);
+
+    //o codigo mais longo precisa caber no acumulador do escritor de bits
+    if(erro == NULL && altura_da_arvore > Max_tamanho_codigo)
+    {
+        erro = "A árvore tem códigos maiores que o escritor de bits aceita";
+    }
+
+    //preenchendo a tabela de codigos
+    marca = iniciar_fase(estatisticas);
+    memset(codigos, 0, sizeof(codigos));
+    if(erro == NULL && arvore_huffman != NULL)
+    {
+        gerar_codigos(codigos, arvore_huffman, 0, 0);
+    }
+    
+    //calculo do lixo de bits
+    int bits_de_lixo = lixo(codigos, frequencia);
+    terminar_fase(estatisticas, FASE_CODIGOS, marca);
+    if(erro == NULL && opcoes->limite_codigo > 0)
+    {
+        relatar_limite(opcoes->limite_codigo, bits_extras, bits_compactados(codigos, frequencia));
+    }
+
+    //segunda passada: escrevendo os bytes compactados, do mapeamento ou trecho a trecho
+    FILE *origem = pesquisavel ? arquivo : copia;
+    if(erro == NULL && !mapeado && fseeko(origem, pesquisavel ? inicio : 0, SEEK_SET) != 0)
+    {
+        erro = "Não foi possível voltar ao início da entrada";
+    }
+
+    //o formato antigo nao tem como guardar dados sem compressao; se o arquivo nao diminuir e ninguem pediu o formato 
+    //antigo, ele vai para o formato em blocos, onde os blocos que nao diminuem sao gravados como estao. No pior caso 
+    //o formato em blocos ocupa a entrada mais o cabecalho, o rodape e o cabecalho e a entrada do indice de cada 
+    //bloco, entao so vale a pena se isso for menor que o arquivo no formato antigo (a conta usa o menor bloco 
+    //possivel, que da mais blocos)
+    uint64_t tamanho_legado = 2 + tamanho_da_arvore + (bits_compactados(codigos, frequencia) + 7) / 8;
+    uint64_t blocos = (tamanho_entrada + TAMANHO_BLOCO_MINIMO - 1) / TAMANHO_BLOCO_MINIMO;
+    uint64_t tamanho_blocos = TAMANHO_CABECALHO_BLOCOS + 1 + TAMANHO_RODAPE_BLOCOS + 
+                              blocos * (TAMANHO_CABECALHO_BLOCO + TAMANHO_ENTRADA_INDICE) + tamanho_entrada;
+    if(erro == NULL && opcoes->formato == FORMATO_AUTOMATICO && tamanho_legado >= tamanho_entrada && 
+       tamanho_blocos < tamanho_legado)
+    {
+        opcoes->formato = FORMATO_BLOCOS;
+        desmapear(&mapa);
+        if(paralelo)
+        {
+            pool_destruir(&pool);
+            paralelo = false;
+        }
+        erro = comprimir_blocos(mapeado ? arquivo : origem, arquivo_comprimido, opcoes);
+    }
+    else if(erro == NULL)
+    {
+        opcoes->formato = FORMATO_LEGADO;
+        erro = gravar_legado(arquivo_comprimido, paralelo ? &pool : NULL, mapeado ? &mapa : NULL, origem, trecho, 
+                             arvore_huffman, codigos, bits_de_lixo, tamanho_entrada, estatisticas);
+    }
+
+    //libera o buffer dos trechos ou o mapeamento e as threads
+    free(trecho);
+    desmapear(&mapa);
+    if(paralelo)
+    {
+        pool_destruir(&pool);
+    }
+    if(copia != NULL)
+    {
+        fclose(copia);
+    }
+    return erro;
+}
+
+/**
+ * @brief   As opções usadas quando nenhuma é escolhida: formato antigo (em blocos se o arquivo não diminuir nele), 
+ *          códigos sem limite de tamanho, blocos canônicos de 1 MiB, uma thread por processador e, no formato 
+ *          adaptativo, códigos refeitos a cada 64 KiB.
+ * 
+ * @return  As opções padrão.
+ */
+OpcoesCompressao opcoes_padrao()
+{
+    OpcoesCompressao opcoes;
+    opcoes.formato = FORMATO_AUTOMATICO;
+    opcoes.limite_codigo = 0;
+    opcoes.canonico = true;
+    opcoes.fluxos = 1;
+    opcoes.tamanho_bloco = TAMANHO_BLOCO_PADRAO;
+    opcoes.threads = processadores_disponiveis();
+    opcoes.intervalo_adaptativo = INTERVALO_ADAPTATIVO_PADRAO;
+    opcoes.dicionario = NULL;
+    opcoes.estatisticas = NULL;
+    return opcoes;
+}
+
+/**
+ * @brief   Essa função comprime um arquivo de entrada usando o algoritmo de Huffman, cria um arquivo comprimido com 
+ *          a extensão ".huff" e armazena a árvore de Huffman e os bits compactados no cabeçalho do arquivo.
+ * 
+ * @param nome_arquivo  Uma string contendo o nome do arquivo que será comprimido.
+ * @param opcoes        O formato de saída e as opções dele.
+ */
+void comprimir_com_opcoes(char *nome_arquivo, OpcoesCompressao *opcoes)
+{
+    long i;
+    //abrindo o arquivo
+    FILE *arquivo = fopen(nome_arquivo, "rb"), *arquivo_comprimido;
+    if(arquivo == NULL)
+    {
+        printf("\nArquivo não encontrado!\n");
+        exit(1);
+    }
+
+    //mudanca do nome, exemplo: arquivo.txt vira arquivo.txt.huff
+    for(i = 0; i != 106; i++)
+    {
+        if(nome_arquivo[i] == '\0' && i + 6 <= 106)
+        {
+            nome_arquivo[i] = '.';
+            nome_arquivo[i + 1] = 'h';
+            nome_arquivo[i + 2] = 'u';
+            nome_arquivo[i + 3] = 'f';
+            nome_arquivo[i + 4] = 'f';
+            nome_arquivo[i + 5] = '\0';
+            break;
+        }
+    }
+
+    //escrevendo o arquivo comprimido
+    arquivo_comprimido = fopen(nome_arquivo,"wb");
+    if(arquivo_comprimido == NULL)
+    {
+        printf("\nNão foi possível abrir o arquivo de saída\n");
+        exit(1);
+    }
+    int formato = opcoes->formato;
+    const char *erro;
+    if(opcoes->formato == FORMATO_BLOCOS)
+    {
+        erro = comprimir_blocos(arquivo, arquivo_comprimido, opcoes);
+    }
+    else if(opcoes->formato == FORMATO_ADAPTATIVO)
+    {
+        erro = comprimir_adaptativo(arquivo, arquivo_comprimido, opcoes);
+    }
+    else if(opcoes->formato == FORMATO_DICIONARIO)
+    {
+        erro = comprimir_dicionario(arquivo, arquivo_comprimido, opcoes);
+    }
+    else
+    {
+        erro = comprimir_arquivo(arquivo, arquivo_comprimido, opcoes);
+    }
+    //fechando os arquivos
+    fclose(arquivo);
+    fclose(arquivo_comprimido);
+    if(erro != NULL)
+    {
+        printf("\n%s\n", erro);
+        exit(1);
+    }
+
+    if(formato == FORMATO_AUTOMATICO && opcoes->formato == FORMATO_BLOCOS)
+    {
+        printf("\nO arquivo não diminui no formato antigo; gravado no formato em blocos\n");
+    }
+    printf("\nArquivo comprimido com sucesso!!!\n");
+    
+    return;
+}
+
+/**
+ * @brief   Comprime um arquivo no formato antigo, com as opções padrão.
+ * 
+ * @param nome_arquivo  Uma string contendo o nome do arquivo que será comprimido.
+ */
+void comprimir(char *nome_arquivo)
+{
+    OpcoesCompressao opcoes = opcoes_padrao();
+    comprimir_com_opcoes(nome_arquivo, &opcoes);
 }
@@ -1,12 +1,92 @@
 #include "structs_huffman.h"
+#include "buffer_saida.h"
+#include "buffer_entrada.h"
+#include "pool_threads.h"
+#include "mapeamento.h"
+#include "canonico.h"
+#include "histograma.h"
+#include "adaptativo.h"
+#include "dicionario.h"
 
-//struct para arvore de descompactacao
+//no da arvore de descompactacao: os filhos sao indices no vetor de nos da arvore, 0 numa folha (a raiz, que e o 
+//indice 0, nunca e filha de outro no)
+typedef struct no_descomprimido
+{
+    uint16_t esquerda, direita;
+    uint8_t byte;
+} NoDescomprimido;
+
+//arvore de descompactacao com todos os nos num vetor, sem nenhuma alocacao; vazia quando quantidade e 0
 struct arvore_descomprimida
 {
-    void *byte;
-    Arvore_D *esquerda, *direita;
+    NoDescomprimido nos[Max_nos_arvore];
+    int quantidade;
 };
 
+//quantidade de bits olhados de uma vez na tabela principal de decodificacao
+#define TABELA_BITS 11
+//maximo de bits extras resolvidos pelas subtabelas, codigos maiores caem no caminho lento pela arvore
+#define SUBTABELA_BITS 11
+
+//tipos de entrada da tabela de decodificacao
+#define ENTRADA_FOLHA 0
+#define ENTRADA_SUBTABELA 1
+#define ENTRADA_LENTA 2
+
+//entrada da tabela: um simbolo com o tamanho do codigo, ou o indice de uma subtabela com a quantidade de bits dela
+typedef struct entrada_tabela
+{
+    uint16_t valor;
+    uint8_t tamanho;
+    uint8_t tipo;
+} EntradaTabela;
+
+//quantos simbolos, no maximo, uma entrada da tabela de varios simbolos resolve
+#define SIMBOLOS_POR_ENTRADA 4
+
+//entrada da tabela de varios simbolos: os simbolos seguidos cujos codigos cabem inteiros nos TABELA_BITS bits 
+//olhados e quantos bits eles ocupam juntos; quantidade 0 quando nem o primeiro codigo cabe
+typedef struct entrada_multipla
+{
+    uint8_t simbolos[SIMBOLOS_POR_ENTRADA];
+    uint8_t quantidade;
+    uint8_t bits;
+} EntradaMultipla;
+
+//tabela de decodificacao montada a partir dos codigos; a arvore so e usada pelos codigos maiores que as subtabelas. 
+//O espaco das subtabelas e reaproveitado quando a mesma tabela e montada de novo
+typedef struct tabela_decodificacao
+{
+    EntradaTabela primaria[1 << TABELA_BITS];
+    EntradaMultipla multipla[1 << TABELA_BITS];
+    EntradaTabela *secundaria;
+    size_t capacidade_secundaria;
+    uint32_t inicio_subtabela[Max_table];
+    int quantidade_subtabelas;
+    int simbolos;
+    Arvore_D arvore;
+    Estatisticas *estatisticas;
+} TabelaDecodificacao;
+
+//codigo de um simbolo usado para montar a tabela: o tamanho do codigo e os primeiros bits dele, no maximo 
+//TABELA_BITS + SUBTABELA_BITS, que sao os unicos que a tabela olha
+typedef struct codigo_simbolo
+{
+    uint32_t inicio;
+    uint8_t tamanho;
+    uint8_t simbolo;
+} CodigoSimbolo;
+
+//leitor de bits que mantem ate 64 bits alinhados a esquerda em um acumulador
+typedef struct leitor_bits
+{
+    const uint8_t *dados;
+    size_t tamanho;
+    size_t posicao;
+    uint64_t buffer;
+    int quantidade;
+} LeitorBits;
+
 /**
  * @brief 
  * 
@@ -34,8 +114,8 @@ int esta_setado(uint8_t c, int i)
 void bits_de_lixo_e_tamanho_da_arvore(int *lixo, long *tamanho_arvore, uint8_t *dados)
 {
     int i, j, k, bit;
-    unsigned char mascara;
-    //primeiro pegamos os bits referente ao lixo
+    //primeiro pegamos os bits referente ao lixo (o bit 7 do byte e o menos significativo do lixo, como os arquivos
+    //.huff existentes foram gravados)
     for(i = 7, j = 0; i >= 5; i--, j++)
     {
         bit = esta_setado(dados[0], i); 
@@ -65,199 +145,2338 @@ void bits_de_lixo_e_tamanho_da_arvore(int *lixo, long *tamanho_arvore, uint8_t *
 }
 
 /**
- * @brief   Essa função é responsável por criar um novo nó para nossa árvore descompactada.
+ * @brief   Essa função é responsável por criar um novo nó para nossa árvore descompactada, no próximo lugar livre do 
+ *          vetor de nós.
  * 
- * @param i     O byte que deve ser inserido no nosso novo nó.
- * @return      O nosso novo nó.
+ * @param arvore    A árvore.
+ * @param byte      O byte que deve ser inserido no nosso novo nó.
+ * @return          O índice do novo nó, ou -1 se a árvore já tiver Max_nos_arvore nós.
  */
-Arvore_D* novo_no_arvore_D(void *i)
+int novo_no_arvore_D(Arvore_D *arvore, uint8_t byte)
 {
-    Arvore_D *novo_no = (Arvore_D*)malloc(sizeof(Arvore_D));
-    if(novo_no == NULL)
+    if(arvore->quantidade == Max_nos_arvore)
     {
-        printf("\nErro ao alocar nó da árvore\n");
-        exit(1);
+        return -1;
     }
-    novo_no->byte = (void*)malloc(1);
-    if(novo_no->byte == NULL)
+    NoDescomprimido *no = &arvore->nos[arvore->quantidade];
+    no->esquerda = 0;
+    no->direita = 0;
+    no->byte = byte;
+    return arvore->quantidade++;
+}
+
+/**
+ * @brief   esta função é responsável por reconstruir a árvore de Huffman a partir dos dados do cabeçalho de um 
+ *          arquivo comprimido, lendo a pré-ordem com uma pilha dos nós internos que ainda esperam filhos, sem 
+ *          recursão. A árvore só é aceita se os bytes do cabeçalho formarem exatamente uma árvore completa: nenhum 
+ *          nó interno sem os dois filhos, nenhum byte sobrando, nenhum escape no fim e no máximo Max_nos_arvore nós.
+ * 
+ * @param arvore            A árvore que será montada. Um cabeçalho de tamanho 0 (arquivo vazio) dá uma árvore vazia.
+ * @param dados             Um ponteiro para um array de bytes que contém os dados do cabeçalho do arquivo comprimido.
+ * @param inicio            A posição do primeiro byte da árvore nos dados.
+ * @param tamanho_arvore    Quantos bytes a árvore ocupa nos dados do cabeçalho.
+ * @return                  false se o cabeçalho não formar uma árvore válida.
+ */
+bool montar_arvore_huffman_D(Arvore_D *arvore, const uint8_t *dados, long inicio, long tamanho_arvore)
+{
+    uint16_t pendentes[Max_table];
+    int topo = 0;
+    long i = inicio, fim = inicio + tamanho_arvore;
+
+    arvore->quantidade = 0;
+    while(i < fim)
     {
-        printf("\nErro ao alocar byte\n");
-        exit(1);
+        //depois da arvore completa nao pode sobrar nenhum byte
+        if(arvore->quantidade > 0 && topo == 0)
+        {
+            return false;
+        }
+        bool interno = dados[i] == '*';
+        if(dados[i] == '\\')
+        {
+            i++;
+            if(i == fim)
+            {
+                return false;
+            }
+        }
+        int no = novo_no_arvore_D(arvore, dados[i]);
+        i++;
+        if(no < 0)
+        {
+            return false;
+        }
+        //o novo no e o filho esquerdo do no interno do topo, ou o direito se o esquerdo ja existir
+        if(topo > 0)
+        {
+            NoDescomprimido *pai = &arvore->nos[pendentes[topo - 1]];
+            if(pai->esquerda == 0)
+            {
+                pai->esquerda = no;
+            }
+            else
+            {
+                pai->direita = no;
+                topo--;
+            }
+        }
+        if(interno)
+        {
+            if(topo == Max_table)
+            {
+                return false;
+            }
+            pendentes[topo++] = no;
+        }
     }
-    memcpy(novo_no->byte, i, 1);
-    novo_no->esquerda = NULL;
-    novo_no->direita = NULL;
+    return topo == 0;
+}
 
-    return novo_no;
+/**
+ * @brief   Preenche uma faixa de entradas da tabela com o mesmo símbolo: todas as entradas cujo índice começa com o 
+ *          código dele, assim um único acesso resolve o símbolo e o tamanho do código.
+ * 
+ * @param tabela    As entradas da tabela (principal ou subtabela).
+ * @param bits      Quantos bits indexam essa tabela.
+ * @param codigo    O código do símbolo relativo ao início dessa tabela.
+ * @param tamanho   O tamanho do código relativo ao início dessa tabela.
+ * @param simbolo   O símbolo.
+ */
+void preencher_faixa(EntradaTabela *tabela, int bits, uint32_t codigo, int tamanho, uint8_t simbolo)
+{
+    int livres = bits - tamanho;
+    for(uint32_t k = codigo << livres; k < (codigo + 1) << livres; k++)
+    {
+        tabela[k].valor = simbolo;
+        tabela[k].tamanho = tamanho;
+        tabela[k].tipo = ENTRADA_FOLHA;
+    }
 }
 
 /**
- * @brief   esta função é responsável por reconstruir a árvore de Huffman a partir dos dados do cabeçalho de um 
- *          arquivo comprimido. A árvore resultante é usada na descompactação para mapear os códigos binários de 
- *          volta para os caracteres originais.
+ * @brief   Monta a tabela de vários símbolos a partir da tabela principal já montada: cada entrada junta os símbolos 
+ *          cujos códigos aparecem um depois do outro dentro dos TABELA_BITS bits do índice, até 
+ *          SIMBOLOS_POR_ENTRADA. Com códigos curtos, como em logs e binários esparsos, um acesso resolve vários bytes.
  * 
- * @param raiz              Um ponteiro para um nó da árvore de Huffman que representa a raiz da árvore.
- * @param dados             Um ponteiro para um array de bytes que contém os dados do cabeçalho do arquivo comprimido.
- * @param i                 Um ponteiro para um inteiro que representa a posição atual nos dados do cabeçalho. 
- * @param tamanho_arvore    Um longo que representa o tamanho da árvore de Huffman nos dados do cabeçalho.
- * @return                  A nossa árvore de Huffman usada para a descompactação.
+ * @param tabela    A tabela de decodificação, com a tabela principal montada.
  */
-Arvore_D* montar_arvore_huffman_D(Arvore_D *raiz, uint8_t *dados, int *i, long tamanho_arvore)
+void montar_tabela_multipla(TabelaDecodificacao *tabela)
 {
-    if(*i == tamanho_arvore)
+    for(uint32_t k = 0; k < (1 << TABELA_BITS); k++)
     {
-        return NULL;
+        EntradaMultipla *multipla = &tabela->multipla[k];
+        int bits = 0, quantidade = 0;
+        while(quantidade < SIMBOLOS_POR_ENTRADA)
+        {
+            //os bits depois do indice viram zeros no deslocamento, entao so vale um codigo que termina dentro dele
+            EntradaTabela entrada = tabela->primaria[(k << bits) & ((1 << TABELA_BITS) - 1)];
+            if(entrada.tipo != ENTRADA_FOLHA || entrada.tamanho == 0 || bits + entrada.tamanho > TABELA_BITS)
+            {
+                break;
+            }
+            multipla->simbolos[quantidade++] = (uint8_t)entrada.valor;
+            bits += entrada.tamanho;
+        }
+        multipla->quantidade = (uint8_t)quantidade;
+        multipla->bits = (uint8_t)bits;
     }
-    else
+}
+
+/**
+ * @brief   Monta a tabela de decodificação a partir dos códigos dos símbolos. Códigos de até TABELA_BITS bits ficam 
+ *          na tabela principal; cada prefixo de TABELA_BITS bits com códigos maiores ganha uma subtabela do tamanho 
+ *          necessário, até SUBTABELA_BITS, e o que passa também da subtabela fica marcado para o caminho lento pela 
+ *          árvore. O que não é preenchido (códigos malformados) também cai no caminho lento, que detecta o erro. No fim 
+ *          a tabela de vários símbolos é montada da principal.
+ * 
+ * @param tabela        A tabela que será montada, já iniciada. A árvore dela não é alterada.
+ * @param codigos       Os códigos dos símbolos.
+ * @param quantidade    A quantidade de códigos.
+ * @return              false se não houve memória para as subtabelas.
+ */
+bool montar_tabela_de_codigos(TabelaDecodificacao *tabela, CodigoSimbolo *codigos, int quantidade)
+{
+    uint8_t maior[1 << TABELA_BITS];
+    size_t total = 0;
+    int maior_codigo = 0;
+
+    tabela->quantidade_subtabelas = 0;
+    tabela->simbolos = quantidade;
+    memset(maior, 0, sizeof(maior));
+    for(int k = 0; k < (1 << TABELA_BITS); k++)
     {
-        if(dados[*i] == '\\')
+        tabela->primaria[k].valor = 0;
+        tabela->primaria[k].tamanho = 0;
+        tabela->primaria[k].tipo = ENTRADA_LENTA;
+    }
+
+    //o maior codigo de cada prefixo define o tamanho da subtabela dele
+    for(int k = 0; k < quantidade; k++)
+    {
+        if(codigos[k].tamanho > maior_codigo)
+        {
+            maior_codigo = codigos[k].tamanho;
+        }
+        if(codigos[k].tamanho > TABELA_BITS)
         {
-            (*i)++;
-            raiz = novo_no_arvore_D(&dados[*i]);
-            (*i)++;
-            return raiz;
+            int bits_inicio = codigos[k].tamanho < TABELA_BITS + SUBTABELA_BITS ? codigos[k].tamanho : 
+                              TABELA_BITS + SUBTABELA_BITS;
+            uint32_t prefixo = codigos[k].inicio >> (bits_inicio - TABELA_BITS);
+            if(codigos[k].tamanho > maior[prefixo])
+            {
+                maior[prefixo] = codigos[k].tamanho;
+            }
         }
-        else if(dados[*i] == '*')
+    }
+    for(uint32_t prefixo = 0; prefixo < (1 << TABELA_BITS); prefixo++)
+    {
+        if(maior[prefixo] != 0 && tabela->quantidade_subtabelas < Max_table)
         {
-            raiz = novo_no_arvore_D(&dados[*i]);
-            (*i)++;
-            raiz->esquerda = montar_arvore_huffman_D(raiz->esquerda, dados, i, tamanho_arvore);
-            raiz->direita = montar_arvore_huffman_D(raiz->direita, dados, i, tamanho_arvore);
+            int bits_sub = maior[prefixo] - TABELA_BITS;
+            if(bits_sub > SUBTABELA_BITS)
+            {
+                bits_sub = SUBTABELA_BITS;
+            }
+            int n = tabela->quantidade_subtabelas++;
+            tabela->inicio_subtabela[n] = total;
+            tabela->primaria[prefixo].valor = n;
+            tabela->primaria[prefixo].tamanho = bits_sub;
+            tabela->primaria[prefixo].tipo = ENTRADA_SUBTABELA;
+            total += (size_t)1 << bits_sub;
         }
-        else
+    }
+    if(total > tabela->capacidade_secundaria)
+    {
+        free(tabela->secundaria);
+        tabela->secundaria = (EntradaTabela*)malloc(sizeof(EntradaTabela) * total);
+        tabela->capacidade_secundaria = tabela->secundaria != NULL ? total : 0;
+        if(tabela->secundaria == NULL)
         {
-            raiz = novo_no_arvore_D(&dados[*i]);
-            (*i)++;
-            return raiz;
+            return false;
         }
+        ESTATISTICA_SOMAR(tabela->estatisticas, alocacoes, 1);
+    }
+    registrar_maior_codigo(tabela->estatisticas, maior_codigo);
+    for(size_t k = 0; k < total; k++)
+    {
+        tabela->secundaria[k].valor = 0;
+        tabela->secundaria[k].tamanho = 0;
+        tabela->secundaria[k].tipo = ENTRADA_LENTA;
     }
 
-    return raiz;
+    for(int k = 0; k < quantidade; k++)
+    {
+        CodigoSimbolo *codigo = &codigos[k];
+        if(codigo->tamanho <= TABELA_BITS)
+        {
+            preencher_faixa(tabela->primaria, TABELA_BITS, codigo->inicio, codigo->tamanho, codigo->simbolo);
+            continue;
+        }
+        int resto = codigo->tamanho - TABELA_BITS;
+        int bits_inicio = resto < SUBTABELA_BITS ? codigo->tamanho : TABELA_BITS + SUBTABELA_BITS;
+        EntradaTabela entrada = tabela->primaria[codigo->inicio >> (bits_inicio - TABELA_BITS)];
+        if(entrada.tipo == ENTRADA_SUBTABELA && resto <= entrada.tamanho)
+        {
+            preencher_faixa(tabela->secundaria + tabela->inicio_subtabela[entrada.valor], entrada.tamanho,
+                            codigo->inicio & (((uint32_t)1 << resto) - 1), resto, codigo->simbolo);
+        }
+    }
+    montar_tabela_multipla(tabela);
+    return true;
 }
 
 /**
- * @brief   Esta função é responsável por descompactar os dados compactados usando a árvore de Huffman e escrever os 
- *          dados descompactados no arquivo de saída.
+ * @brief   Percorre a árvore de Huffman reconstruída do cabeçalho juntando o código de cada folha, com uma pilha no 
+ *          lugar da recursão. A árvore já foi validada, então tem no máximo Max_table folhas.
  * 
- * @param arquivo_descomprimido     Um ponteiro para o arquivo de saída onde os dados descompactados serão escritos.
- * @param dados                     Um ponteiro para um array de bytes que contém os dados compactados a serem 
- *                                  descompactados.
- * @param tamanho_arquivo           O tamanho total do arquivo compactado em bytes.
- * @param i                         Um índice que representa a posição atual nos dados compactados.
- * @param arvore                    A raiz da árvore de Huffman que foi previamente montada a partir do cabeçalho do 
- *                                  arquivo compactado.
- * @param lixo                      O número de bits de lixo no final do arquivo compactado.
+ * @param arvore        A árvore de Huffman.
+ * @param codigos       Recebe os códigos das folhas.
+ * @return              Quantos códigos foram juntados.
  */
-void escrever_arquivo(FILE* arquivo_descomprimido, uint8_t* dados, long tamanho_arquivo, long i, Arvore_D* arvore, int lixo)
+int coletar_codigos_arvore(Arvore_D *arvore, CodigoSimbolo *codigos)
 {
-    Arvore_D* aux = arvore;
-
-    while(i < tamanho_arquivo)
+    //cada no pendente com os primeiros bits do caminho ate ele e a profundidade dele
+    struct
     {
-        uint8_t byte = dados[i];
+        uint16_t no;
+        uint16_t profundidade;
+        uint32_t inicio;
+    } pilha[Max_nos_arvore];
+    int topo = 0, quantidade = 0;
 
-        for(int j = 7; j >= 0; j--)
+    if(arvore->quantidade == 0)
+    {
+        return 0;
+    }
+    pilha[topo].no = 0;
+    pilha[topo].profundidade = 0;
+    pilha[topo].inicio = 0;
+    topo++;
+    while(topo > 0)
+    {
+        topo--;
+        NoDescomprimido *no = &arvore->nos[pilha[topo].no];
+        int profundidade = pilha[topo].profundidade;
+        uint32_t inicio = pilha[topo].inicio;
+        if(no->esquerda == 0)
         {
-            if(i == tamanho_arquivo - 1 && j < lixo) return;
-
-            if (esta_setado(byte, j))
+            if(quantidade < Max_table)
             {
-                aux = aux->direita;
+                codigos[quantidade].inicio = inicio;
+                codigos[quantidade].tamanho = profundidade < 255 ? profundidade : 255;
+                codigos[quantidade].simbolo = no->byte;
+                quantidade++;
             }
-            else
+            continue;
+        }
+        //depois dos bits que a tabela olha, o inicio do codigo para de crescer
+        bool crescer = profundidade < TABELA_BITS + SUBTABELA_BITS;
+        pilha[topo].no = no->direita;
+        pilha[topo].profundidade = profundidade + 1;
+        pilha[topo].inicio = crescer ? (inicio << 1) | 1 : inicio;
+        topo++;
+        pilha[topo].no = no->esquerda;
+        pilha[topo].profundidade = profundidade + 1;
+        pilha[topo].inicio = crescer ? inicio << 1 : inicio;
+        topo++;
+    }
+    return quantidade;
+}
+
+/**
+ * @brief   Monta a árvore de Huffman do cabeçalho dentro da tabela e a tabela de decodificação a partir dela.
+ * 
+ * @param tabela            A tabela que será montada.
+ * @param dados             Os dados do cabeçalho.
+ * @param inicio            A posição do primeiro byte da árvore nos dados.
+ * @param tamanho_arvore    Quantos bytes a árvore ocupa.
+ * @return                  false se o cabeçalho não formar uma árvore válida ou faltar memória.
+ */
+bool montar_tabela_decodificacao(TabelaDecodificacao *tabela, const uint8_t *dados, long inicio, long tamanho_arvore)
+{
+    CodigoSimbolo codigos[Max_table];
+    if(!montar_arvore_huffman_D(&tabela->arvore, dados, inicio, tamanho_arvore))
+    {
+        return false;
+    }
+    int quantidade = coletar_codigos_arvore(&tabela->arvore, codigos);
+    return montar_tabela_de_codigos(tabela, codigos, quantidade);
+}
+
+/**
+ * @brief   Monta a tabela de decodificação direto do tamanho dos códigos canônicos, sem árvore. A árvore só é 
+ *          construída se algum código passar do que as subtabelas resolvem.
+ * 
+ * @param tabela    A tabela que será montada, já iniciada.
+ * @param tamanhos  O tamanho do código de cada byte, 0 para os que não aparecem.
+ * @return          false se faltar memória para as subtabelas.
+ */
+bool montar_tabela_canonica(TabelaDecodificacao *tabela, const uint8_t *tamanhos)
+{
+    CodigoSimbolo codigos[Max_table];
+    uint64_t bits[Max_table];
+    int quantidade = 0, maior = 0;
+    codigos_canonicos(tamanhos, bits);
+    for(int i = 0; i < Max_table; i++)
+    {
+        if(tamanhos[i] == 0)
+        {
+            continue;
+        }
+        int bits_inicio = tamanhos[i] < TABELA_BITS + SUBTABELA_BITS ? tamanhos[i] : TABELA_BITS + SUBTABELA_BITS;
+        codigos[quantidade].inicio = (uint32_t)(bits[i] >> (tamanhos[i] - bits_inicio));
+        codigos[quantidade].tamanho = tamanhos[i];
+        codigos[quantidade].simbolo = (uint8_t)i;
+        quantidade++;
+        if(tamanhos[i] > maior)
+        {
+            maior = tamanhos[i];
+        }
+    }
+    tabela->arvore.quantidade = 0;
+    if(!montar_tabela_de_codigos(tabela, codigos, quantidade))
+    {
+        return false;
+    }
+    if(maior <= TABELA_BITS + SUBTABELA_BITS)
+    {
+        return true;
+    }
+    //os tamanhos ja passaram pela verificacao de Kraft, entao os codigos formam uma arvore completa que cabe no vetor
+    Arvore_D *arvore = &tabela->arvore;
+    novo_no_arvore_D(arvore, '*');
+    for(int i = 0; i < Max_table; i++)
+    {
+        int no = 0;
+        for(int bit = tamanhos[i] - 1; bit >= 0; bit--)
+        {
+            uint16_t *filho = (bits[i] >> bit) & 1 ? &arvore->nos[no].direita : &arvore->nos[no].esquerda;
+            if(*filho == 0)
             {
-                aux = aux->esquerda;
+                int novo = novo_no_arvore_D(arvore, bit == 0 ? (uint8_t)i : '*');
+                if(novo < 0)
+                {
+                    return false;
+                }
+                *filho = novo;
             }
+            no = *filho;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief   Prepara uma tabela de decodificação para ser montada. A mesma tabela pode ser montada várias vezes, e o 
+ *          espaço das subtabelas só é alocado de novo quando precisa crescer.
+ * 
+ * @param tabela    A tabela de decodificação.
+ */
+void iniciar_tabela_decodificacao(TabelaDecodificacao *tabela)
+{
+    tabela->secundaria = NULL;
+    tabela->capacidade_secundaria = 0;
+    tabela->quantidade_subtabelas = 0;
+    tabela->simbolos = 0;
+    tabela->arvore.quantidade = 0;
+    tabela->estatisticas = NULL;
+}
+
+/**
+ * @brief   Libera as subtabelas alocadas por montar_tabela_decodificacao.
+ * 
+ * @param tabela    A tabela de decodificação.
+ */
+void free_tabela_decodificacao(TabelaDecodificacao *tabela)
+{
+    free(tabela->secundaria);
+    tabela->secundaria = NULL;
+    tabela->capacidade_secundaria = 0;
+}
+
+/**
+ * @brief   Prepara o leitor de bits para ler um array de bytes do início.
+ * 
+ * @param leitor    O leitor de bits.
+ * @param dados     Os bytes que serão lidos.
+ * @param tamanho   A quantidade de bytes.
+ */
+void iniciar_leitor_bits(LeitorBits *leitor, const uint8_t *dados, size_t tamanho)
+{
+    leitor->dados = dados;
+    leitor->tamanho = tamanho;
+    leitor->posicao = 0;
+    leitor->buffer = 0;
+    leitor->quantidade = 0;
+}
+
+/**
+ * @brief   Completa o acumulador do leitor para ter pelo menos 56 bits válidos, enquanto houver dados. Longe do fim 
+ *          os 8 bytes são carregados de uma vez; bits além dos válidos podem ficar no acumulador, mas são os mesmos 
+ *          que seriam carregados depois.
+ * 
+ * @param leitor    O leitor de bits.
+ */
+static inline void leitor_recarregar(LeitorBits *leitor)
+{
+    if(leitor->quantidade > 56)
+    {
+        return;
+    }
+    if(leitor->posicao + 8 <= leitor->tamanho)
+    {
+        const uint8_t *p = leitor->dados + leitor->posicao;
+        uint64_t palavra = ((uint64_t)p[0] << 56) | ((uint64_t)p[1] << 48) | ((uint64_t)p[2] << 40) |
+                           ((uint64_t)p[3] << 32) | ((uint64_t)p[4] << 24) | ((uint64_t)p[5] << 16) |
+                           ((uint64_t)p[6] << 8) | (uint64_t)p[7];
+        leitor->buffer |= palavra >> leitor->quantidade;
+        leitor->posicao += (63 - leitor->quantidade) >> 3;
+        leitor->quantidade |= 56;
+    }
+    else
+    {
+        while(leitor->quantidade <= 56 && leitor->posicao < leitor->tamanho)
+        {
+            leitor->buffer |= (uint64_t)leitor->dados[leitor->posicao++] << (56 - leitor->quantidade);
+            leitor->quantidade += 8;
+        }
+    }
+}
+
+/**
+ * @brief   Descarta os n bits mais significativos do acumulador.
+ * 
+ * @param leitor    O leitor de bits.
+ * @param n         A quantidade de bits consumidos.
+ */
+static inline void leitor_consumir(LeitorBits *leitor, int n)
+{
+    leitor->buffer <<= n;
+    leitor->quantidade -= n;
+}
 
-            if(aux->direita == NULL && aux->esquerda == NULL)
+/**
+ * @brief   Decodifica um símbolo cujo código não cabe na tabela principal: primeiro tenta a subtabela e, se o 
+ *          código for maior ainda, percorre a árvore bit a bit.
+ * 
+ * @param tabela        A tabela de decodificação.
+ * @param leitor        O leitor de bits posicionado no início do código.
+ * @param restantes     Quantos bits válidos ainda faltam, atualizado com os bits consumidos.
+ * @return              O símbolo decodificado, ou -1 se os bits acabaram antes de chegar numa folha. Nesse caso o 
+ *                      leitor volta para o início do código, para continuar quando chegarem mais bits.
+ */
+int decodificar_simbolo_longo(TabelaDecodificacao *tabela, LeitorBits *leitor, uint64_t *restantes)
+{
+    EntradaTabela entrada = tabela->primaria[leitor->buffer >> (64 - TABELA_BITS)];
+    if(entrada.tipo == ENTRADA_SUBTABELA)
+    {
+        if(leitor->quantidade < TABELA_BITS + entrada.tamanho)
+        {
+            leitor_recarregar(leitor);
+        }
+        uint32_t indice = (uint32_t)((leitor->buffer << TABELA_BITS) >> (64 - entrada.tamanho));
+        EntradaTabela sub = tabela->secundaria[tabela->inicio_subtabela[entrada.valor] + indice];
+        if(sub.tipo == ENTRADA_FOLHA)
+        {
+            int total = TABELA_BITS + sub.tamanho;
+            if((uint64_t)total > *restantes)
             {
-                fwrite(&(*(uint8_t *)aux->byte), sizeof(uint8_t), 1, arquivo_descomprimido);
-                aux = arvore;
+                return -1;
             }
+            leitor_consumir(leitor, total);
+            *restantes -= total;
+            return sub.valor;
+        }
+    }
+
+    LeitorBits salvo = *leitor;
+    uint64_t restantes_salvos = *restantes;
+    const NoDescomprimido *nos = tabela->arvore.nos;
+    int aux = 0;
+    //sem arvore nenhum codigo passa das subtabelas, entao o codigo e invalido
+    if(tabela->arvore.quantidade == 0)
+    {
+        return -1;
+    }
+    while(nos[aux].esquerda != 0)
+    {
+        if(*restantes == 0)
+        {
+            *leitor = salvo;
+            *restantes = restantes_salvos;
+            return -1;
+        }
+        if(leitor->quantidade == 0)
+        {
+            leitor_recarregar(leitor);
+        }
+        int bit = (int)(leitor->buffer >> 63);
+        leitor_consumir(leitor, 1);
+        (*restantes)--;
+        aux = bit ? nos[aux].direita : nos[aux].esquerda;
+        //um no interno sem o filho do bit so aparece numa arvore canonica incompleta
+        if(aux == 0)
+        {
+            return -1;
         }
-        i++;
     }
+    return nos[aux].byte;
 }
 
 /**
- * @brief   Esta função é usada para liberar a memória alocada para a árvore de Huffman após o processo de 
- *          descompactação ser concluído.
+ * @brief   Esta função é responsável por descompactar os bits usando a tabela de decodificação e escrever os dados 
+ *          descompactados na saída. Cada acesso à tabela de vários símbolos resolve todos os códigos que cabem na 
+ *          janela olhada; quando nem o primeiro cabe, ou quando os bits ou a saída estão acabando, um acesso à tabela 
+ *          principal resolve um símbolo, e os códigos mais longos passam pelas subtabelas. Só são consumidos códigos 
+ *          inteiros: o leitor para no início do primeiro código que não cabe nos bits restantes, o que permite 
+ *          continuar de onde parou em outro trecho.
  * 
- * @param raiz  Um ponteiro para a raiz da árvore de Huffman a ser liberada.
+ * @param saida         A saída onde os dados descompactados serão escritos.
+ * @param leitor_trecho O leitor de bits, que pode já trazer bits carregados de um trecho anterior.
+ * @param restantes     Quantos bits o leitor pode consumir.
+ * @param tabela        A tabela de decodificação montada a partir da árvore do cabeçalho.
  */
-void free_arvore_huffman_D(Arvore_D *raiz)
+void decodificar_bits(Saida *saida, LeitorBits *leitor_trecho, uint64_t restantes, TabelaDecodificacao *tabela)
 {
-    if(raiz == NULL)
+    //com nenhum ou um unico simbolo nao ha bits para decodificar
+    if(tabela->simbolos < 2)
     {
         return;
     }
-    free_arvore_huffman_D(raiz->esquerda);
-    free_arvore_huffman_D(raiz->direita);
-    free(raiz->byte);
-    free(raiz);
 
-    return;
+    LeitorBits leitor = *leitor_trecho;
+    bool continuar = true;
+
+    while(continuar && restantes > 0)
+    {
+        leitor_recarregar(&leitor);
+        //cada simbolo consome pelo menos um dos 64 bits do acumulador, entao 64 bytes livres bastam ate a proxima 
+        //recarga; numa saida de capacidade fixa (um bloco escrito direto no destino) o limite e o fim do destino
+        size_t parada = saida->posicao + 64;
+        if(saida->capacidade - saida->posicao < 64)
+        {
+            if(saida->arquivo == NULL && !saida->crescer)
+            {
+                if(saida->posicao == saida->capacidade)
+                {
+                    saida->erro = true;
+                    break;
+                }
+                parada = saida->capacidade;
+            }
+            else if(!saida_reservar(saida, 64))
+            {
+                break;
+            }
+        }
+        //aproveita todos os bits carregados antes de recarregar de novo
+        do
+        {
+            EntradaMultipla multipla = tabela->multipla[leitor.buffer >> (64 - TABELA_BITS)];
+            //os simbolos sao copiados juntos, entao a saida precisa ter espaco para todos os da entrada
+            if(multipla.quantidade != 0 && multipla.bits <= restantes && parada - saida->posicao >= SIMBOLOS_POR_ENTRADA)
+            {
+                memcpy(saida->buffer + saida->posicao, multipla.simbolos, SIMBOLOS_POR_ENTRADA);
+                saida->posicao += multipla.quantidade;
+                leitor_consumir(&leitor, multipla.bits);
+                restantes -= multipla.bits;
+                continue;
+            }
+            EntradaTabela entrada = tabela->primaria[leitor.buffer >> (64 - TABELA_BITS)];
+            if(entrada.tipo != ENTRADA_FOLHA)
+            {
+                //o caminho longo pode recarregar o acumulador, entao depois dele volta a reservar a saida
+                int simbolo = decodificar_simbolo_longo(tabela, &leitor, &restantes);
+                if(simbolo < 0)
+                {
+                    continuar = false;
+                }
+                else
+                {
+                    saida->buffer[saida->posicao++] = (uint8_t)simbolo;
+                }
+                break;
+            }
+            if(entrada.tamanho > restantes)
+            {
+                continuar = false;
+                break;
+            }
+            leitor_consumir(&leitor, entrada.tamanho);
+            restantes -= entrada.tamanho;
+            saida->buffer[saida->posicao++] = (uint8_t)entrada.valor;
+        } while(leitor.quantidade >= TABELA_BITS && restantes > 0 && saida->posicao < parada);
+    }
+    *leitor_trecho = leitor;
 }
 
 /**
- * @brief   Essa função descomprime um arquivo no formato Huffman, criando a árvore de Huffman a partir dos dados 
- *          e escrevendo o arquivo descompactado no diretório do nosso programa.
+ * @brief   Descompacta um bitstream inteiro que já está na memória e escreve os dados descompactados na saída.
  * 
- * @param nome_arquivo  Uma string contendo o nome do arquivo que será descomprimido.
+ * @param saida                     A saída onde os dados descompactados serão escritos.
+ * @param dados                     Um ponteiro para um array de bytes que contém os dados compactados a serem 
+ *                                  descompactados.
+ * @param tamanho_arquivo           O tamanho total do arquivo compactado em bytes.
+ * @param i                         Um índice que representa a posição atual nos dados compactados.
+ * @param tabela                    A tabela de decodificação montada a partir da árvore do cabeçalho.
+ * @param lixo                      O número de bits de lixo no final do arquivo compactado.
  */
-void descomprimir(char *nome_arquivo)
+void escrever_arquivo(Saida *saida, uint8_t* dados, size_t tamanho_arquivo, size_t i, TabelaDecodificacao *tabela, 
+                      int lixo)
 {
-    FILE *arquivo_comprimido, *arquivo_descomprimido;
-    Arvore_D *arvore_huffman_descomprimida = NULL;
-    uint8_t *dados;
-    int bits_de_lixo = 0, i; 
-    long tamanho_arvore = 0;
-    arquivo_comprimido = fopen(nome_arquivo, "rb");
-    if(arquivo_comprimido == NULL)
+    if(i >= tamanho_arquivo)
     {
-        printf("\nNão foi possível encontrar o arquivo\n");
-        exit(1);
-    }
-    //buscando o final do arquivo
-    fseek(arquivo_comprimido, 0, SEEK_END);
-    //pegando o tamanho do arquivo
-    long tamanho_arquivo = ftell(arquivo_comprimido);
-    //voltando para o inicio do arquivo
-    fseek(arquivo_comprimido, 0, SEEK_SET);
-    //alocando memoria para a variavel dados
-    dados = malloc(tamanho_arquivo);
-    if(dados == NULL)
-    {
-        printf("\nNão foi possível alocar memoria para vetor do arquivo\n");
-        exit(1);
+        return;
     }
-    //setando 0 em todas as posicos de dados
-    memset(dados, 0, tamanho_arquivo);
-    //pegando todos os bytes do arquivo
-    fread(dados, 1, tamanho_arquivo, arquivo_comprimido);
-    //fechando o arquivo
-    fclose(arquivo_comprimido);
+    LeitorBits leitor;
+    iniciar_leitor_bits(&leitor, dados + i, tamanho_arquivo - i);
+    decodificar_bits(saida, &leitor, (uint64_t)(tamanho_arquivo - i) * 8 - lixo, tabela);
+}
+
+/**
+ * @brief   Descomprime um arquivo no formato antigo lendo-o em trechos de tamanho fixo, então a memória usada não 
+ *          depende do tamanho do arquivo e a entrada pode ser um pipe ou a entrada padrão. Entre um trecho e outro 
+ *          os bits que sobraram continuam no leitor, e o último byte de cada trecho fica guardado até se saber se ele 
+ *          é o último do arquivo, que é o único com bits de lixo.
+ * 
+ * @param entrada   A entrada, com o primeiro trecho já carregado.
+ * @param tabela    A tabela de decodificação usada, já iniciada.
+ * @param saida     A saída onde os dados descompactados serão escritos.
+ * @return          false se o cabeçalho for inválido.
+ */
+bool descomprimir_legado(Entrada *entrada, TabelaDecodificacao *tabela, Saida *saida)
+{
+    int bits_de_lixo = 0;
+    long tamanho_arvore = 0;
 
+    //o primeiro trecho sempre tem o cabecalho inteiro, que tem no maximo 2 + 8191 bytes
+    uint8_t *dados = (uint8_t*)entrada_dados(entrada);
+    if(entrada_disponivel(entrada) < 2)
+    {
+        return false;
+    }
     //pegando a quantidade de bits de lixo que temos e o tamanho da arvore
     bits_de_lixo_e_tamanho_da_arvore(&bits_de_lixo, &tamanho_arvore, dados);
-    //montando a arvore de huffman
-    i = 2;
-    arvore_huffman_descomprimida = montar_arvore_huffman_D(arvore_huffman_descomprimida, dados, &i, tamanho_arvore + 2);
+    //montando a arvore de huffman e a tabela de decodificacao a partir dela
+    uint64_t marca = iniciar_fase(tabela->estatisticas);
+    if((size_t)tamanho_arvore + 2 > entrada_disponivel(entrada) || 
+       !montar_tabela_decodificacao(tabela, dados, 2, tamanho_arvore))
+    {
+        return false;
+    }
+    terminar_fase(tabela->estatisticas, FASE_TABELA, marca);
+    ESTATISTICA_SOMAR(tabela->estatisticas, bytes_cabecalho, 2 + tamanho_arvore);
+    ESTATISTICA_SOMAR(tabela->estatisticas, bits_lixo, bits_de_lixo);
 
-    //escrevendo arquivo descompactado
-    int tamanho_nome_arquivo = strlen(nome_arquivo);
-    nome_arquivo[tamanho_nome_arquivo - 5] = '\0';
-    arquivo_descomprimido = fopen(nome_arquivo, "wb");
-    if(arquivo_descomprimido == NULL)
+    LeitorBits leitor;
+    iniciar_leitor_bits(&leitor, dados, entrada_disponivel(entrada));
+    leitor.posicao = 2 + tamanho_arvore;
+    uint64_t antes = saida_tamanho(saida);
+    marca = iniciar_fase(tabela->estatisticas);
+    while(true)
     {
-        printf("\nNão foi possível criar um arquivo de saída\n");
-        exit(1);
+        uint64_t disponiveis = leitor.quantidade + (uint64_t)(leitor.tamanho - leitor.posicao) * 8;
+        //ate o fim do arquivo o ultimo byte fica guardado, porque so ele tem lixo
+        uint64_t reservados = entrada->acabou ? bits_de_lixo : 8;
+        if(disponiveis > reservados)
+        {
+            decodificar_bits(saida, &leitor, disponiveis - reservados, tabela);
+        }
+        if(entrada->acabou || saida->erro)
+        {
+            break;
+        }
+        //os bytes ainda nao carregados no leitor vao para o comeco do trecho, seguidos dos proximos bytes
+        entrada_avancar(entrada, leitor.posicao);
+        entrada_carregar(entrada, 0);
+        leitor.dados = entrada_dados(entrada);
+        leitor.tamanho = entrada_disponivel(entrada);
+        leitor.posicao = 0;
     }
-    escrever_arquivo(arquivo_descomprimido, dados, tamanho_arquivo, i, arvore_huffman_descomprimida, bits_de_lixo);
+    terminar_fase(tabela->estatisticas, FASE_DECODIFICACAO, marca);
+    ESTATISTICA_SOMAR(tabela->estatisticas, simbolos, saida_tamanho(saida) - antes);
+    return true;
+}
+
+//tamanho, em bytes comprimidos, de cada faixa que uma thread decodifica num arquivo antigo
+#define FAIXA_ESPECULATIVA (1024 * 1024)
+//quantas fronteiras de simbolo do comeco de cada faixa sao guardadas para achar o ponto de sincronia; os codigos de 
+//huffman costumam sincronizar em poucas dezenas de bits
+#define FRONTEIRAS_ESPECULATIVAS 4096
+
+//uma faixa de um arquivo antigo decodificada por uma thread a partir de um bit qualquer: o fluxo de bits inteiro, os 
+//bits do comeco e do fim da faixa, as primeiras fronteiras de simbolo do caminho dela (em bits, a primeira e o 
+//comeco), a ultima fronteira antes do fim e os bytes decodificados
+typedef struct faixa_especulativa
+{
+    const uint8_t *dados;
+    size_t tamanho;
+    TabelaDecodificacao *tabela;
+    uint64_t inicio, fim;
+    uint64_t fronteiras[FRONTEIRAS_ESPECULATIVAS];
+    int quantidade_fronteiras;
+    uint64_t parada;
+    Saida saida;
+} FaixaEspeculativa;
 
-    //liberando o espaço
-    free(dados);
-    free_arvore_huffman_D(arvore_huffman_descomprimida);
-    arvore_huffman_descomprimida = NULL;
-    dados = NULL;
+/**
+ * @brief   Posiciona o leitor num bit qualquer de um fluxo de bits.
+ * 
+ * @param leitor    O leitor de bits.
+ * @param dados     O fluxo de bits inteiro.
+ * @param tamanho   O tamanho do fluxo em bytes.
+ * @param bit       A posição, em bits desde o começo do fluxo.
+ */
+void posicionar_leitor(LeitorBits *leitor, const uint8_t *dados, size_t tamanho, uint64_t bit)
+{
+    iniciar_leitor_bits(leitor, dados, tamanho);
+    leitor->posicao = (size_t)(bit / 8);
+    if(bit % 8 != 0)
+    {
+        leitor_recarregar(leitor);
+        leitor_consumir(leitor, (int)(bit % 8));
+    }
+}
+
+/**
+ * @brief   A posição do próximo bit que o leitor vai consumir, em bits desde o começo dos dados dele.
+ * 
+ * @param leitor    O leitor de bits.
+ * @return          A posição.
+ */
+static inline uint64_t posicao_leitor(const LeitorBits *leitor)
+{
+    return (uint64_t)leitor->posicao * 8 - leitor->quantidade;
+}
+
+/**
+ * @brief   Decodifica um único símbolo.
+ * 
+ * @param tabela        A tabela de decodificação.
+ * @param leitor        O leitor de bits.
+ * @param restantes     Quantos bits ainda podem ser consumidos, atualizado com os bits do código.
+ * @return              O símbolo, ou -1 se o código não cabe nos bits restantes.
+ */
+int decodificar_simbolo(TabelaDecodificacao *tabela, LeitorBits *leitor, uint64_t *restantes)
+{
+    leitor_recarregar(leitor);
+    EntradaTabela entrada = tabela->primaria[leitor->buffer >> (64 - TABELA_BITS)];
+    if(entrada.tipo != ENTRADA_FOLHA)
+    {
+        return decodificar_simbolo_longo(tabela, leitor, restantes);
+    }
+    if(entrada.tamanho > *restantes)
+    {
+        return -1;
+    }
+    leitor_consumir(leitor, entrada.tamanho);
+    *restantes -= entrada.tamanho;
+    return entrada.valor;
+}
+
+/**
+ * @brief   Tarefa do pool de threads que decodifica a faixa de índice i a partir do começo dela, sem saber se ele é 
+ *          uma fronteira de símbolo de verdade. As fronteiras dos primeiros símbolos são guardadas uma a uma e o 
+ *          resto da faixa passa pelo decodificador normal, até o último código que termina antes do fim da faixa.
+ * 
+ * @param argumento     O array de faixas.
+ * @param indice        O índice da faixa.
+ */
+void decodificar_faixa_tarefa(void *argumento, size_t indice)
+{
+    FaixaEspeculativa *faixa = (FaixaEspeculativa*)argumento + indice;
+    LeitorBits leitor;
+    uint64_t restantes = faixa->fim - faixa->inicio;
+    posicionar_leitor(&leitor, faixa->dados, faixa->tamanho, faixa->inicio);
+    faixa->saida.posicao = 0;
+    faixa->saida.erro = false;
+    faixa->fronteiras[0] = faixa->inicio;
+    faixa->quantidade_fronteiras = 1;
+    while(faixa->quantidade_fronteiras < FRONTEIRAS_ESPECULATIVAS)
+    {
+        int simbolo = decodificar_simbolo(faixa->tabela, &leitor, &restantes);
+        if(simbolo < 0)
+        {
+            break;
+        }
+        saida_byte(&faixa->saida, (uint8_t)simbolo);
+        faixa->fronteiras[faixa->quantidade_fronteiras++] = posicao_leitor(&leitor);
+    }
+    if(faixa->quantidade_fronteiras == FRONTEIRAS_ESPECULATIVAS)
+    {
+        decodificar_bits(&faixa->saida, &leitor, restantes, faixa->tabela);
+    }
+    faixa->parada = posicao_leitor(&leitor);
+}
+
+/**
+ * @brief   Grava uma faixa decodificada especulativamente a partir da última fronteira verdadeira antes dela. O 
+ *          caminho verdadeiro é seguido símbolo a símbolo até cair numa das fronteiras guardadas pela faixa; dali em 
+ *          diante os dois caminhos são o mesmo, e o resto da faixa é copiado. Se isso não acontece nas fronteiras 
+ *          guardadas, a faixa é decodificada de novo em sequência.
+ * 
+ * @param faixa         A faixa, já decodificada.
+ * @param verdadeiro    A última fronteira verdadeira antes do começo da faixa.
+ * @param saida         A saída onde os dados descompactados são escritos.
+ * @param sem_sincronia Somado de 1 se a faixa teve que ser decodificada de novo.
+ * @return              A última fronteira verdadeira antes do fim da faixa.
+ */
+uint64_t juntar_faixa(FaixaEspeculativa *faixa, uint64_t verdadeiro, Saida *saida, uint64_t *sem_sincronia)
+{
+    LeitorBits leitor;
+    uint64_t restantes = faixa->fim - verdadeiro;
+    posicionar_leitor(&leitor, faixa->dados, faixa->tamanho, verdadeiro);
+    int j = 0;
+    while(true)
+    {
+        while(j < faixa->quantidade_fronteiras && faixa->fronteiras[j] < verdadeiro)
+        {
+            j++;
+        }
+        if(j == faixa->quantidade_fronteiras)
+        {
+            break;
+        }
+        //o simbolo j da faixa comeca na fronteira j, entao a saida dela a partir dele ja e a verdadeira
+        if(faixa->fronteiras[j] == verdadeiro)
+        {
+            saida_escrever(saida, faixa->saida.buffer + j, faixa->saida.posicao - j);
+            return faixa->parada;
+        }
+        int simbolo = decodificar_simbolo(faixa->tabela, &leitor, &restantes);
+        if(simbolo < 0)
+        {
+            return verdadeiro;
+        }
+        saida_byte(saida, (uint8_t)simbolo);
+        verdadeiro = posicao_leitor(&leitor);
+    }
+    (*sem_sincronia)++;
+    decodificar_bits(saida, &leitor, restantes, faixa->tabela);
+    return posicao_leitor(&leitor);
+}
+
+/**
+ * @brief   Descomprime um arquivo no formato antigo que está inteiro na memória em várias threads. O fluxo de bits é 
+ *          dividido em faixas de FAIXA_ESPECULATIVA bytes, processadas em lotes de duas por thread. A primeira 
+ *          faixa de cada lote começa numa fronteira conhecida; as outras começam num bit qualquer e contam com a 
+ *          sincronização dos códigos de Huffman, que depois de alguns símbolos voltam ao caminho verdadeiro. As 
+ *          faixas são juntadas na ordem por juntar_faixa, então a saída é sempre igual à da descompressão serial.
+ * 
+ * @param dados     O arquivo comprimido inteiro.
+ * @param tamanho   O tamanho do arquivo.
+ * @param tabela    A tabela de decodificação usada, já iniciada; as threads só leem dela.
+ * @param saida     A saída onde os dados descompactados serão escritos.
+ * @param threads   O número de threads.
+ * @return          NULL se deu certo, senão a mensagem do erro.
+ */
+const char* descomprimir_legado_paralelo(const uint8_t *dados, size_t tamanho, TabelaDecodificacao *tabela,
+                                         Saida *saida, int threads)
+{
+    int bits_de_lixo = 0;
+    long tamanho_arvore = 0;
+    if(tamanho < 2)
+    {
+        return "Arquivo comprimido inválido";
+    }
+    bits_de_lixo_e_tamanho_da_arvore(&bits_de_lixo, &tamanho_arvore, (uint8_t*)dados);
+    uint64_t marca = iniciar_fase(tabela->estatisticas);
+    if((size_t)tamanho_arvore + 2 > tamanho || !montar_tabela_decodificacao(tabela, dados, 2, tamanho_arvore))
+    {
+        return "Arquivo comprimido inválido";
+    }
+    terminar_fase(tabela->estatisticas, FASE_TABELA, marca);
+    ESTATISTICA_SOMAR(tabela->estatisticas, bytes_cabecalho, 2 + tamanho_arvore);
+    ESTATISTICA_SOMAR(tabela->estatisticas, bits_lixo, bits_de_lixo);
+    //com nenhum ou um unico simbolo nao ha bits para decodificar
+    const uint8_t *bits = dados + 2 + tamanho_arvore;
+    size_t bytes = tamanho - 2 - tamanho_arvore;
+    if(tabela->simbolos < 2 || (uint64_t)bytes * 8 <= (uint64_t)bits_de_lixo)
+    {
+        return NULL;
+    }
+    uint64_t total = (uint64_t)bytes * 8 - bits_de_lixo;
+
+    size_t lote = (size_t)threads * 2;
+    FaixaEspeculativa *faixas = (FaixaEspeculativa*)calloc(lote, sizeof(FaixaEspeculativa));
+    if(faixas == NULL)
+    {
+        return "Não foi possível alocar memória para as faixas";
+    }
+    PoolThreads pool;
+    bool ok = pool_criar(&pool, threads);
+    for(size_t k = 0; k < lote; k++)
+    {
+        ok = ok && saida_memoria_crescente(&faixas[k].saida, 2 * FAIXA_ESPECULATIVA);
+        faixas[k].saida.estatisticas = tabela->estatisticas;
+        faixas[k].dados = bits;
+        faixas[k].tamanho = bytes;
+        faixas[k].tabela = tabela;
+    }
+    ESTATISTICA_SOMAR(tabela->estatisticas, alocacoes, lote + 1);
+
+    uint64_t antes = saida_tamanho(saida), verdadeiro = 0, sem_sincronia = 0;
+    marca = iniciar_fase(tabela->estatisticas);
+    while(ok && verdadeiro < total && !saida->erro)
+    {
+        size_t quantidade = 0;
+        uint64_t inicio_lote = verdadeiro;
+        while(quantidade < lote && inicio_lote + quantidade * FAIXA_ESPECULATIVA * 8 < total)
+        {
+            uint64_t fim = inicio_lote + (quantidade + 1) * FAIXA_ESPECULATIVA * 8;
+            faixas[quantidade].inicio = inicio_lote + quantidade * FAIXA_ESPECULATIVA * 8;
+            faixas[quantidade].fim = fim < total ? fim : total;
+            quantidade++;
+        }
+        pool_executar(&pool, decodificar_faixa_tarefa, faixas, quantidade);
+        for(size_t k = 0; k < quantidade; k++)
+        {
+            ok = ok && !faixas[k].saida.erro;
+        }
+        if(!ok)
+        {
+            break;
+        }
+        //a primeira faixa do lote comeca numa fronteira verdadeira, entao ja esta certa
+        saida_escrever(saida, faixas[0].saida.buffer, faixas[0].saida.posicao);
+        verdadeiro = faixas[0].parada;
+        for(size_t k = 1; k < quantidade; k++)
+        {
+            verdadeiro = juntar_faixa(&faixas[k], verdadeiro, saida, &sem_sincronia);
+        }
+        //no fim do fluxo sobram so bits que nao formam um codigo inteiro
+        if(faixas[quantidade - 1].fim == total || verdadeiro == inicio_lote)
+        {
+            break;
+        }
+    }
+    terminar_fase(tabela->estatisticas, FASE_DECODIFICACAO, marca);
+    ESTATISTICA_SOMAR(tabela->estatisticas, simbolos, saida_tamanho(saida) - antes);
+    pool_destruir(&pool);
+    for(size_t k = 0; k < lote; k++)
+    {
+        free(faixas[k].saida.buffer);
+    }
+    free(faixas);
+    return ok ? NULL : "Não foi possível alocar memória para as faixas";
+}
+
+/**
+ * @brief   Descomprime o conteúdo de um bloco com árvore, que tem o mesmo formato de um arquivo antigo 
+ *          inteiro. Como o tamanho original do bloco é conhecido, uma árvore de um único nó também é aceita: o 
+ *          símbolo dela se repete o bloco inteiro.
+ * 
+ * @param dados             O conteúdo do bloco.
+ * @param tamanho           O tamanho do conteúdo em bytes.
+ * @param tamanho_original  Quantos bytes o bloco tem descomprimido.
+ * @param tabela            A tabela de decodificação usada, já iniciada.
+ * @param saida             A saída onde os dados descompactados serão escritos.
+ * @return                  false se o bloco estiver malformado ou não gerar exatamente tamanho_original bytes.
+ */
+bool descomprimir_bloco_arvore(const uint8_t *dados, size_t tamanho, uint32_t tamanho_original, 
+                               TabelaDecodificacao *tabela, Saida *saida)
+{
+    int bits_de_lixo = 0;
+    long tamanho_arvore = 0;
+    if(tamanho < 2)
+    {
+        return false;
+    }
+    bits_de_lixo_e_tamanho_da_arvore(&bits_de_lixo, &tamanho_arvore, (uint8_t*)dados);
+    if((size_t)tamanho_arvore + 2 > tamanho)
+    {
+        return false;
+    }
+    uint64_t marca = iniciar_fase(tabela->estatisticas);
+    if(!montar_tabela_decodificacao(tabela, dados, 2, tamanho_arvore))
+    {
+        return false;
+    }
+    terminar_fase(tabela->estatisticas, FASE_TABELA, marca);
+    uint64_t antes = saida_tamanho(saida);
+
+    marca = iniciar_fase(tabela->estatisticas);
+    if(tabela->arvore.quantidade == 1)
+    {
+        for(uint32_t k = 0; k < tamanho_original; k++)
+        {
+            saida_byte(saida, tabela->arvore.nos[0].byte);
+        }
+    }
+    else
+    {
+        escrever_arquivo(saida, (uint8_t*)dados, tamanho, 2 + tamanho_arvore, tabela, bits_de_lixo);
+    }
+    terminar_fase(tabela->estatisticas, FASE_DECODIFICACAO, marca);
+    ESTATISTICA_SOMAR(tabela->estatisticas, bytes_cabecalho, 2 + tamanho_arvore);
+    ESTATISTICA_SOMAR(tabela->estatisticas, bits_lixo, bits_de_lixo);
+    ESTATISTICA_SOMAR(tabela->estatisticas, simbolos, tamanho_original);
+    return !saida->erro && saida_tamanho(saida) - antes == tamanho_original;
+}
+
+/**
+ * @brief   Descomprime o conteúdo de um bloco canônico: o lixo nos 3 bits mais altos do primeiro byte, o tamanho do 
+ *          código de cada byte e os bits. A tabela é montada direto dos tamanhos. Um único byte com código se 
+ *          repete o bloco inteiro, sem bits.
+ * 
+ * @param dados             O conteúdo do bloco.
+ * @param tamanho           O tamanho do conteúdo em bytes.
+ * @param tamanho_original  Quantos bytes o bloco tem descomprimido.
+ * @param tabela            A tabela de decodificação usada, já iniciada.
+ * @param saida             A saída onde os dados descompactados serão escritos.
+ * @return                  false se o bloco estiver malformado ou não gerar exatamente tamanho_original bytes.
+ */
+bool descomprimir_bloco_canonico(const uint8_t *dados, size_t tamanho, uint32_t tamanho_original, 
+                                 TabelaDecodificacao *tabela, Saida *saida)
+{
+    uint8_t tamanhos[Max_table];
+    if(tamanho < 1)
+    {
+        return false;
+    }
+    int bits_de_lixo = dados[0] >> 5;
+    long lidos = ler_tamanhos_canonicos(dados + 1, tamanho - 1, tamanhos);
+    if(lidos < 0)
+    {
+        return false;
+    }
+    uint64_t marca = iniciar_fase(tabela->estatisticas);
+    if(!montar_tabela_canonica(tabela, tamanhos))
+    {
+        return false;
+    }
+    terminar_fase(tabela->estatisticas, FASE_TABELA, marca);
+    uint64_t antes = saida_tamanho(saida);
+
+    marca = iniciar_fase(tabela->estatisticas);
+    if(tabela->simbolos == 1)
+    {
+        uint8_t simbolo = tabela->primaria[0].valor;
+        for(uint32_t k = 0; k < tamanho_original; k++)
+        {
+            saida_byte(saida, simbolo);
+        }
+    }
+    else
+    {
+        escrever_arquivo(saida, (uint8_t*)dados, tamanho, 1 + lidos, tabela, bits_de_lixo);
+    }
+    terminar_fase(tabela->estatisticas, FASE_DECODIFICACAO, marca);
+    ESTATISTICA_SOMAR(tabela->estatisticas, bytes_cabecalho, 1 + lidos);
+    ESTATISTICA_SOMAR(tabela->estatisticas, bits_lixo, bits_de_lixo);
+    ESTATISTICA_SOMAR(tabela->estatisticas, simbolos, tamanho_original);
+    return !saida->erro && saida_tamanho(saida) - antes == tamanho_original;
+}
+
+//bytes decodificados de cada vez num bloco intercalado, que cabem em qualquer buffer de saida
+#define TRECHO_INTERCALADO (64 * 1024)
+//simbolos que cada fluxo decodifica depois de uma recarga: 5 codigos de TAMANHO_CODIGO_INTERCALADO bits cabem nos 56 
+//bits garantidos
+#define SIMBOLOS_POR_RECARGA 5
+
+#if TAMANHO_CODIGO_INTERCALADO > TABELA_BITS
+#error "os codigos dos blocos intercalados precisam caber na tabela principal"
+#endif
+
+/**
+ * @brief   Decodifica um trecho de um bloco intercalado. Enquanto todos os fluxos estão longe do fim, cada volta 
+ *          recarrega os leitores uma vez e tira SIMBOLOS_POR_RECARGA símbolos de cada um, alternando entre eles: os 
+ *          fluxos não dependem um do outro, então o processador adianta os acessos à tabela de todos ao mesmo tempo. 
+ *          Perto do fim, cada símbolo confere se o fluxo ainda tem bits.
+ * 
+ * @param leitores  Um leitor para cada fluxo.
+ * @param fluxos    A quantidade de fluxos.
+ * @param primaria  A tabela principal, que resolve qualquer código do bloco.
+ * @param destino   Onde os bytes são escritos.
+ * @param tamanho   Quantos bytes decodificar; o primeiro é do fluxo 0.
+ * @return          false se algum fluxo acabar antes.
+ */
+static bool decodificar_intercalado(LeitorBits *leitores, int fluxos, const EntradaTabela *primaria, uint8_t *destino, 
+                                    size_t tamanho)
+{
+    size_t feitos = 0;
+    while(true)
+    {
+        bool longe_do_fim = tamanho - feitos >= (size_t)SIMBOLOS_POR_RECARGA * fluxos;
+        for(int k = 0; k < fluxos && longe_do_fim; k++)
+        {
+            longe_do_fim = leitores[k].posicao + 8 <= leitores[k].tamanho;
+        }
+        if(!longe_do_fim)
+        {
+            break;
+        }
+        for(int k = 0; k < fluxos; k++)
+        {
+            leitor_recarregar(&leitores[k]);
+        }
+        for(int r = 0; r < SIMBOLOS_POR_RECARGA; r++)
+        {
+            for(int k = 0; k < fluxos; k++)
+            {
+                EntradaTabela entrada = primaria[leitores[k].buffer >> (64 - TABELA_BITS)];
+                leitor_consumir(&leitores[k], entrada.tamanho);
+                destino[feitos++] = (uint8_t)entrada.valor;
+            }
+        }
+    }
+    for(; feitos < tamanho; feitos++)
+    {
+        LeitorBits *leitor = &leitores[feitos % fluxos];
+        leitor_recarregar(leitor);
+        EntradaTabela entrada = primaria[leitor->buffer >> (64 - TABELA_BITS)];
+        if(entrada.tamanho > leitor->quantidade)
+        {
+            return false;
+        }
+        leitor_consumir(leitor, entrada.tamanho);
+        destino[feitos] = (uint8_t)entrada.valor;
+    }
+    return true;
+}
+
+/**
+ * @brief   Descomprime o conteúdo de um bloco intercalado. A tabela é montada dos tamanhos como num bloco canônico, 
+ *          mas como nenhum código passa da tabela principal cada símbolo sai de um único acesso. A saída é escrita em 
+ *          trechos de TRECHO_INTERCALADO bytes, então serve qualquer buffer de saída.
+ * 
+ * @param dados             O conteúdo do bloco.
+ * @param tamanho           O tamanho do conteúdo em bytes.
+ * @param tamanho_original  Quantos bytes o bloco tem descomprimido.
+ * @param tabela            A tabela de decodificação usada, já iniciada.
+ * @param saida             A saída onde os dados descompactados serão escritos.
+ * @return                  false se o bloco estiver malformado ou algum fluxo não tiver exatamente os bits dos seus 
+ *                          símbolos.
+ */
+bool descomprimir_bloco_intercalado(const uint8_t *dados, size_t tamanho, uint32_t tamanho_original, 
+                                    TabelaDecodificacao *tabela, Saida *saida)
+{
+    uint8_t tamanhos[Max_table];
+    LeitorBits leitores[FLUXOS_MAXIMO];
+    if(tamanho < 1)
+    {
+        return false;
+    }
+    int bits_de_lixo = dados[0] >> 5, fluxos = dados[0] & 0x1F;
+    long lidos = ler_tamanhos_canonicos(dados + 1, tamanho - 1, tamanhos);
+    if(fluxos < 2 || fluxos > FLUXOS_MAXIMO || lidos < 0)
+    {
+        return false;
+    }
+    int simbolos = 0;
+    for(int i = 0; i < Max_table; i++)
+    {
+        if(tamanhos[i] > TAMANHO_CODIGO_INTERCALADO)
+        {
+            return false;
+        }
+        simbolos += tamanhos[i] != 0;
+    }
+    size_t inicio = 1 + (size_t)lidos + 4 * (size_t)(fluxos - 1);
+    if(simbolos < 2 || inicio > tamanho)
+    {
+        return false;
+    }
+    for(int k = 0; k < fluxos; k++)
+    {
+        size_t tamanho_fluxo = k < fluxos - 1 ? ler_u32(dados + 1 + lidos + 4 * k) : tamanho - inicio;
+        if(tamanho_fluxo > tamanho - inicio)
+        {
+            return false;
+        }
+        iniciar_leitor_bits(&leitores[k], dados + inicio, tamanho_fluxo);
+        inicio += tamanho_fluxo;
+    }
+    uint64_t marca = iniciar_fase(tabela->estatisticas);
+    if(!montar_tabela_canonica(tabela, tamanhos))
+    {
+        return false;
+    }
+    terminar_fase(tabela->estatisticas, FASE_TABELA, marca);
+
+    marca = iniciar_fase(tabela->estatisticas);
+    //cada trecho tem um multiplo de fluxos bytes, entao todos comecam no fluxo 0
+    for(uint32_t feitos = 0; feitos < tamanho_original; )
+    {
+        size_t trecho = tamanho_original - feitos < TRECHO_INTERCALADO ? tamanho_original - feitos : TRECHO_INTERCALADO;
+        trecho -= tamanho_original - feitos > trecho ? trecho % fluxos : 0;
+        if(!saida_reservar(saida, trecho) ||
+           !decodificar_intercalado(leitores, fluxos, tabela->primaria, saida->buffer + saida->posicao, trecho))
+        {
+            return false;
+        }
+        saida->posicao += trecho;
+        feitos += (uint32_t)trecho;
+    }
+    terminar_fase(tabela->estatisticas, FASE_DECODIFICACAO, marca);
+    //cada fluxo precisa acabar no ultimo byte dele, e o ultimo com exatamente os bits de lixo do cabecalho
+    for(int k = 0; k < fluxos; k++)
+    {
+        uint64_t usados = (uint64_t)leitores[k].posicao * 8 - leitores[k].quantidade;
+        uint64_t sobra = (uint64_t)leitores[k].tamanho * 8 - usados;
+        if(sobra > 7 || (k == fluxos - 1 && sobra != (uint64_t)bits_de_lixo))
+        {
+            return false;
+        }
+    }
+    ESTATISTICA_SOMAR(tabela->estatisticas, bytes_cabecalho, 1 + lidos + 4 * (fluxos - 1));
+    ESTATISTICA_SOMAR(tabela->estatisticas, bits_lixo, bits_de_lixo);
+    ESTATISTICA_SOMAR(tabela->estatisticas, simbolos, tamanho_original);
+    return !saida->erro;
+}
+
+/**
+ * @brief   "Descomprime" um bloco sem compressão: o conteúdo é copiado como está.
+ * 
+ * @param dados             O conteúdo do bloco.
+ * @param tamanho           O tamanho do conteúdo em bytes.
+ * @param tamanho_original  Quantos bytes o bloco tem descomprimido, que precisa ser igual a tamanho.
+ * @param tabela            Só as estatísticas dela são usadas; existe para o bloco ter a mesma forma dos outros.
+ * @param saida             A saída onde os dados serão escritos.
+ * @return                  false se os tamanhos não baterem ou a saída falhar.
+ */
+bool descomprimir_bloco_bruto(const uint8_t *dados, size_t tamanho, uint32_t tamanho_original, 
+                              TabelaDecodificacao *tabela, Saida *saida)
+{
+    uint64_t marca = iniciar_fase(tabela->estatisticas);
+    bool ok = tamanho == tamanho_original && saida_escrever(saida, dados, tamanho);
+    terminar_fase(tabela->estatisticas, FASE_DECODIFICACAO, marca);
+    return ok;
+}
+
+/**
+ * @brief   Descomprime o conteúdo de um bloco de acordo com o tipo dele.
+ * 
+ * @param tipo              O tipo do bloco.
+ * @param dados             O conteúdo do bloco.
+ * @param tamanho           O tamanho do conteúdo em bytes.
+ * @param tamanho_original  Quantos bytes o bloco tem descomprimido.
+ * @param tabela            A tabela de decodificação usada, já iniciada; pode ser a mesma para vários blocos.
+ * @param saida             A saída onde os dados descompactados serão escritos.
+ * @return                  false se o tipo for desconhecido ou o bloco estiver malformado.
+ */
+bool descomprimir_bloco(uint8_t tipo, const uint8_t *dados, size_t tamanho, uint32_t tamanho_original, 
+                        TabelaDecodificacao *tabela, Saida *saida)
+{
+    registrar_bloco(tabela->estatisticas, numero_thread_pool);
+    switch(tipo)
+    {
+    case BLOCO_HUFFMAN:
+        return descomprimir_bloco_arvore(dados, tamanho, tamanho_original, tabela, saida);
+    case BLOCO_CANONICO:
+        return descomprimir_bloco_canonico(dados, tamanho, tamanho_original, tabela, saida);
+    case BLOCO_INTERCALADO:
+        return descomprimir_bloco_intercalado(dados, tamanho, tamanho_original, tabela, saida);
+    case BLOCO_BRUTO:
+        return descomprimir_bloco_bruto(dados, tamanho, tamanho_original, tabela, saida);
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief   Verifica se os primeiros bytes de um arquivo são o cabeçalho do formato em blocos. Um arquivo antigo nunca 
+ *          começa assim, porque o tamanho da árvore seria maior que qualquer árvore possível.
+ * 
+ * @param dados     Os primeiros bytes do arquivo.
+ * @param tamanho   Quantos bytes estão disponíveis.
+ * @return          true se for o formato em blocos.
+ */
+bool formato_blocos(const uint8_t *dados, size_t tamanho)
+{
+    return tamanho >= TAMANHO_CABECALHO_BLOCOS_SEM_TAMANHO && memcmp(dados, MAGICO_BLOCOS, 3) == 0;
+}
+
+/**
+ * @brief   O tamanho do cabeçalho de um arquivo em blocos, que depende da versão.
+ * 
+ * @param cabecalho     O cabeçalho, com pelo menos TAMANHO_CABECALHO_BLOCOS_SEM_TAMANHO bytes.
+ * @return              O tamanho do cabeçalho, ou 0 se a versão não for suportada.
+ */
+size_t tamanho_cabecalho_blocos(const uint8_t *cabecalho)
+{
+    if(cabecalho[3] == VERSAO_BLOCOS)
+    {
+        return TAMANHO_CABECALHO_BLOCOS;
+    }
+    return cabecalho[3] == VERSAO_BLOCOS_SEM_TAMANHO ? TAMANHO_CABECALHO_BLOCOS_SEM_TAMANHO : 0;
+}
+
+/**
+ * @brief   O tamanho original total gravado no cabeçalho de um arquivo em blocos.
+ * 
+ * @param cabecalho     O cabeçalho inteiro, de uma versão suportada.
+ * @return              O tamanho, ou TAMANHO_DESCONHECIDO se a versão não o guarda ou o compressor não o sabia.
+ */
+uint64_t tamanho_original_cabecalho(const uint8_t *cabecalho)
+{
+    return cabecalho[3] == VERSAO_BLOCOS ? ler_u64(cabecalho + 12) : TAMANHO_DESCONHECIDO;
+}
+
+/**
+ * @brief   Descomprime um arquivo no formato em blocos, um bloco de cada vez, na ordem, com a mesma tabela de 
+ *          decodificação para todos os blocos.
+ * 
+ * @param entrada   A entrada, com o primeiro trecho já carregado.
+ * @param tabela    A tabela de decodificação usada, já iniciada.
+ * @param saida     A saída onde os dados descompactados serão escritos.
+ * @return          false se a versão não for suportada ou algum bloco for inválido.
+ */
+bool descomprimir_blocos(Entrada *entrada, TabelaDecodificacao *tabela, Saida *saida)
+{
+    size_t tamanho_cabecalho = tamanho_cabecalho_blocos(entrada_dados(entrada));
+    if(tamanho_cabecalho == 0 || entrada_disponivel(entrada) < tamanho_cabecalho)
+    {
+        return false;
+    }
+    uint64_t esperado = tamanho_original_cabecalho(entrada_dados(entrada)), total = 0;
+    entrada_avancar(entrada, tamanho_cabecalho);
+    while(true)
+    {
+        if(entrada_disponivel(entrada) < TAMANHO_CABECALHO_BLOCO)
+        {
+            entrada_carregar(entrada, TAMANHO_CABECALHO_BLOCO);
+        }
+        const uint8_t *bloco = entrada_dados(entrada);
+        if(entrada_disponivel(entrada) >= 1 && bloco[0] == BLOCO_FIM)
+        {
+            entrada_avancar(entrada, 1);
+            break;
+        }
+        if(entrada_disponivel(entrada) < TAMANHO_CABECALHO_BLOCO)
+        {
+            return false;
+        }
+        uint8_t tipo = bloco[0];
+        uint32_t tamanho_original = ler_u32(bloco + 1), tamanho_comprimido = ler_u32(bloco + 5);
+        entrada_avancar(entrada, TAMANHO_CABECALHO_BLOCO);
+        if(entrada_disponivel(entrada) < tamanho_comprimido)
+        {
+            entrada_carregar(entrada, tamanho_comprimido);
+        }
+        if(entrada_disponivel(entrada) < tamanho_comprimido ||
+           !descomprimir_bloco(tipo, entrada_dados(entrada), tamanho_comprimido, tamanho_original, tabela, saida))
+        {
+            return false;
+        }
+        entrada_avancar(entrada, tamanho_comprimido);
+        total += tamanho_original;
+    }
+    return esperado == TAMANHO_DESCONHECIDO || total == esperado;
+}
+
+/**
+ * @brief   Verifica se os primeiros bytes de um arquivo são o cabeçalho de um fluxo adaptativo.
+ * 
+ * @param dados     Os primeiros bytes do arquivo.
+ * @param tamanho   Quantos bytes estão disponíveis.
+ * @return          true se for o fluxo adaptativo.
+ */
+bool fluxo_adaptativo(const uint8_t *dados, size_t tamanho)
+{
+    return formato_blocos(dados, tamanho) && (dados[4] & FLAG_ADAPTATIVO);
+}
+
+/**
+ * @brief   Descomprime um trecho do fluxo adaptativo com a tabela montada a partir do modelo.
+ * 
+ * @param dados             O conteúdo do trecho.
+ * @param tamanho           O tamanho do conteúdo em bytes.
+ * @param tamanho_original  Quantos bytes o trecho tem descomprimido.
+ * @param tabela            A tabela de decodificação do modelo atual.
+ * @param saida             A saída em memória, com capacidade de exatamente tamanho_original bytes.
+ * @return                  false se o trecho não gerar exatamente tamanho_original bytes.
+ */
+bool descomprimir_trecho_adaptativo(const uint8_t *dados, size_t tamanho, uint32_t tamanho_original, 
+                                    TabelaDecodificacao *tabela, Saida *saida)
+{
+    if(tamanho < 1)
+    {
+        return false;
+    }
+    int bits_de_lixo = dados[0] >> 5;
+    uint64_t marca = iniciar_fase(tabela->estatisticas);
+    escrever_arquivo(saida, (uint8_t*)dados, tamanho, 1, tabela, bits_de_lixo);
+    terminar_fase(tabela->estatisticas, FASE_DECODIFICACAO, marca);
+    ESTATISTICA_SOMAR(tabela->estatisticas, bytes_cabecalho, 1);
+    ESTATISTICA_SOMAR(tabela->estatisticas, bits_lixo, bits_de_lixo);
+    ESTATISTICA_SOMAR(tabela->estatisticas, simbolos, tamanho_original);
+    return !saida->erro && saida->posicao == tamanho_original;
+}
+
+/**
+ * @brief   Descomprime um fluxo adaptativo, trecho a trecho. Cada trecho é decodificado num buffer, somado ao modelo 
+ *          como o compressor fez, e a tabela é montada de novo sempre que o modelo muda. Lendo de um arquivo, só são 
+ *          lidos os bytes de cada trecho e a saída é descarregada depois dele, então num pipe os dados saem conforme 
+ *          chegam.
+ * 
+ * @param entrada   A entrada, com pelo menos o cabeçalho carregado.
+ * @param tabela    A tabela de decodificação usada, já iniciada.
+ * @param saida     A saída onde os dados descompactados serão escritos.
+ * @return          false se o cabeçalho ou algum trecho for inválido.
+ */
+bool descomprimir_adaptativo(Entrada *entrada, TabelaDecodificacao *tabela, Saida *saida)
+{
+    const uint8_t *cabecalho = entrada_dados(entrada);
+    size_t tamanho_cabecalho = 0;
+    if(!fluxo_adaptativo(cabecalho, entrada_disponivel(entrada)) || 
+       (tamanho_cabecalho = tamanho_cabecalho_blocos(cabecalho)) == 0 || 
+       entrada_garantir(entrada, tamanho_cabecalho) < tamanho_cabecalho)
+    {
+        return false;
+    }
+    cabecalho = entrada_dados(entrada);
+    int limite = cabecalho[5];
+    size_t intervalo = ler_u32(cabecalho + 8);
+    uint64_t esperado = tamanho_original_cabecalho(cabecalho), total = 0;
+    if(intervalo < INTERVALO_ADAPTATIVO_MINIMO || intervalo > INTERVALO_ADAPTATIVO_MAXIMO || 
+       limite < LIMITE_ADAPTATIVO_MINIMO)
+    {
+        return false;
+    }
+    entrada_avancar(entrada, tamanho_cabecalho);
+
+    ModeloAdaptativo modelo;
+    iniciar_modelo_adaptativo(&modelo, intervalo, limite);
+    uint8_t *trecho = (uint8_t*)malloc(intervalo);
+    ESTATISTICA_SOMAR(tabela->estatisticas, alocacoes, 1);
+    bool valido = trecho != NULL && montar_tabela_canonica(tabela, modelo.tamanhos);
+    while(valido)
+    {
+        if(entrada_garantir(entrada, 1) < 1)
+        {
+            valido = false;
+            break;
+        }
+        if(entrada_dados(entrada)[0] == BLOCO_FIM)
+        {
+            entrada_avancar(entrada, 1);
+            break;
+        }
+        if(entrada_garantir(entrada, TAMANHO_CABECALHO_BLOCO) < TAMANHO_CABECALHO_BLOCO)
+        {
+            valido = false;
+            break;
+        }
+        const uint8_t *bloco = entrada_dados(entrada);
+        uint8_t tipo = bloco[0];
+        uint32_t tamanho_original = ler_u32(bloco + 1), tamanho_comprimido = ler_u32(bloco + 5);
+        if((tipo != BLOCO_ADAPTATIVO && tipo != BLOCO_BRUTO) || tamanho_original == 0 || tamanho_original > intervalo)
+        {
+            valido = false;
+            break;
+        }
+        entrada_avancar(entrada, TAMANHO_CABECALHO_BLOCO);
+        if(entrada_garantir(entrada, tamanho_comprimido) < tamanho_comprimido)
+        {
+            valido = false;
+            break;
+        }
+        registrar_bloco(tabela->estatisticas, numero_thread_pool);
+        Saida destino;
+        saida_memoria(&destino, trecho, tamanho_original);
+        valido = tipo == BLOCO_BRUTO ?
+                 descomprimir_bloco_bruto(entrada_dados(entrada), tamanho_comprimido, tamanho_original, tabela, 
+                                          &destino) :
+                 descomprimir_trecho_adaptativo(entrada_dados(entrada), tamanho_comprimido, tamanho_original, tabela, 
+                                                &destino);
+        entrada_avancar(entrada, tamanho_comprimido);
+        if(!valido || !saida_escrever(saida, trecho, tamanho_original))
+        {
+            valido = false;
+            break;
+        }
+        total += tamanho_original;
+
+        long frequencia[Max_table];
+        uint64_t marca = iniciar_fase(tabela->estatisticas);
+        memset(frequencia, 0, sizeof(frequencia));
+        histograma_bytes(trecho, tamanho_original, frequencia);
+        terminar_fase(tabela->estatisticas, FASE_HISTOGRAMA, marca);
+        marca = iniciar_fase(tabela->estatisticas);
+        if(atualizar_modelo_adaptativo(&modelo, frequencia, tamanho_original))
+        {
+            valido = montar_tabela_canonica(tabela, modelo.tamanhos);
+        }
+        terminar_fase(tabela->estatisticas, FASE_TABELA, marca);
+        if(entrada->arquivo != NULL)
+        {
+            saida_descarregar(saida);
+        }
+    }
+    free(trecho);
+    return valido && !saida->erro && (esperado == TAMANHO_DESCONHECIDO || total == esperado);
+}
+
+/**
+ * @brief   Verifica se os primeiros bytes de um arquivo são o cabeçalho de um arquivo comprimido com dicionário.
+ * 
+ * @param dados     Os primeiros bytes do arquivo.
+ * @param tamanho   Quantos bytes estão disponíveis.
+ * @return          true se o arquivo foi comprimido com dicionário.
+ */
+bool fluxo_dicionario(const uint8_t *dados, size_t tamanho)
+{
+    return formato_blocos(dados, tamanho) && (dados[4] & FLAG_DICIONARIO);
+}
+
+/**
+ * @brief   A identificação do dicionário com que um arquivo foi comprimido.
+ * 
+ * @param cabecalho     O cabeçalho, de um arquivo em que fluxo_dicionario é true.
+ * @return              A identificação.
+ */
+uint32_t id_dicionario_cabecalho(const uint8_t *cabecalho)
+{
+    return ler_u32(cabecalho + 8);
+}
+
+/**
+ * @brief   Descomprime um bloco com os códigos do dicionário: o lixo nos 3 bits mais altos do primeiro byte e os 
+ *          bits, decodificados com a tabela já montada do dicionário.
+ * 
+ * @param dados             O conteúdo do bloco.
+ * @param tamanho           O tamanho do conteúdo em bytes.
+ * @param tamanho_original  Quantos bytes o bloco tem descomprimido.
+ * @param tabela            A tabela de decodificação do dicionário.
+ * @param saida             A saída onde os dados descompactados serão escritos.
+ * @return                  false se o bloco não gerar exatamente tamanho_original bytes.
+ */
+bool descomprimir_bloco_dicionario(const uint8_t *dados, size_t tamanho, uint32_t tamanho_original, 
+                                   TabelaDecodificacao *tabela, Saida *saida)
+{
+    if(tamanho < 1)
+    {
+        return false;
+    }
+    int bits_de_lixo = dados[0] >> 5;
+    uint64_t antes = saida_tamanho(saida);
+    uint64_t marca = iniciar_fase(tabela->estatisticas);
+    escrever_arquivo(saida, (uint8_t*)dados, tamanho, 1, tabela, bits_de_lixo);
+    terminar_fase(tabela->estatisticas, FASE_DECODIFICACAO, marca);
+    ESTATISTICA_SOMAR(tabela->estatisticas, bytes_cabecalho, 1);
+    ESTATISTICA_SOMAR(tabela->estatisticas, bits_lixo, bits_de_lixo);
+    ESTATISTICA_SOMAR(tabela->estatisticas, simbolos, tamanho_original);
+    return !saida->erro && saida_tamanho(saida) - antes == tamanho_original;
+}
+
+/**
+ * @brief   Descomprime um arquivo comprimido com dicionário, bloco a bloco. A tabela do dicionário é montada uma vez 
+ *          por quem chama e reaproveitada por todos os blocos e todos os arquivos.
+ * 
+ * @param entrada   A entrada, com pelo menos o cabeçalho carregado.
+ * @param tabela    A tabela de decodificação montada do dicionário do arquivo.
+ * @param saida     A saída onde os dados descompactados serão escritos.
+ * @return          false se o cabeçalho ou algum bloco for inválido.
+ */
+bool descomprimir_dicionario(Entrada *entrada, TabelaDecodificacao *tabela, Saida *saida)
+{
+    const uint8_t *cabecalho = entrada_dados(entrada);
+    size_t tamanho_cabecalho = 0;
+    if(!fluxo_dicionario(cabecalho, entrada_disponivel(entrada)) || 
+       (tamanho_cabecalho = tamanho_cabecalho_blocos(cabecalho)) == 0 || 
+       entrada_garantir(entrada, tamanho_cabecalho) < tamanho_cabecalho)
+    {
+        return false;
+    }
+    uint64_t esperado = tamanho_original_cabecalho(entrada_dados(entrada)), total = 0;
+    entrada_avancar(entrada, tamanho_cabecalho);
+    while(true)
+    {
+        if(entrada_garantir(entrada, 1) < 1)
+        {
+            return false;
+        }
+        if(entrada_dados(entrada)[0] == BLOCO_FIM)
+        {
+            entrada_avancar(entrada, 1);
+            break;
+        }
+        if(entrada_garantir(entrada, TAMANHO_CABECALHO_BLOCO) < TAMANHO_CABECALHO_BLOCO)
+        {
+            return false;
+        }
+        const uint8_t *bloco = entrada_dados(entrada);
+        uint8_t tipo = bloco[0];
+        uint32_t tamanho_original = ler_u32(bloco + 1), tamanho_comprimido = ler_u32(bloco + 5);
+        //um bloco que nao diminui e gravado sem compressao, entao nenhum passa do tamanho original
+        if((tipo != BLOCO_DICIONARIO && tipo != BLOCO_BRUTO) || tamanho_original == 0 || 
+           tamanho_original > TAMANHO_BLOCO_MAXIMO || tamanho_comprimido > tamanho_original)
+        {
+            return false;
+        }
+        entrada_avancar(entrada, TAMANHO_CABECALHO_BLOCO);
+        if(entrada_garantir(entrada, tamanho_comprimido) < tamanho_comprimido)
+        {
+            return false;
+        }
+        registrar_bloco(tabela->estatisticas, numero_thread_pool);
+        bool valido = tipo == BLOCO_BRUTO ?
+                      descomprimir_bloco_bruto(entrada_dados(entrada), tamanho_comprimido, tamanho_original, tabela, 
+                                               saida) :
+                      descomprimir_bloco_dicionario(entrada_dados(entrada), tamanho_comprimido, tamanho_original, 
+                                                    tabela, saida);
+        if(!valido)
+        {
+            return false;
+        }
+        entrada_avancar(entrada, tamanho_comprimido);
+        total += tamanho_original;
+    }
+    return !saida->erro && (esperado == TAMANHO_DESCONHECIDO || total == esperado);
+}
+
+/**
+ * @brief   Lê o índice gravado no fim de um arquivo em blocos e confere se ele é coerente com o arquivo: os blocos 
+ *          estão em ordem, não se sobrepõem e os tamanhos somam o total do rodapé e, se houver, o do cabeçalho.
+ * 
+ * @param arquivo       O arquivo comprimido, que precisa permitir posicionamento.
+ * @param inicio        A posição do arquivo onde o formato em blocos começa.
+ * @param cabecalho     O cabeçalho do arquivo, de uma versão suportada.
+ * @param quantidade    Recebe a quantidade de blocos.
+ * @param tamanho_total Recebe o tamanho original total.
+ * @return              O índice, alocado com malloc, ou NULL se o rodapé ou o índice forem inválidos.
+ */
+IndiceBloco* ler_indice_blocos(FILE *arquivo, off_t inicio, const uint8_t *cabecalho, uint64_t *quantidade, 
+                               uint64_t *tamanho_total)
+{
+    uint8_t rodape[TAMANHO_RODAPE_BLOCOS];
+    size_t tamanho_cabecalho = tamanho_cabecalho_blocos(cabecalho);
+    if(fseeko(arquivo, 0, SEEK_END) != 0)
+    {
+        return NULL;
+    }
+    off_t fim = ftello(arquivo);
+    if(fim < inicio + (off_t)tamanho_cabecalho + 1 + TAMANHO_RODAPE_BLOCOS ||
+       fseeko(arquivo, fim - TAMANHO_RODAPE_BLOCOS, SEEK_SET) != 0 ||
+       fread(rodape, 1, TAMANHO_RODAPE_BLOCOS, arquivo) != TAMANHO_RODAPE_BLOCOS ||
+       memcmp(rodape + 24, MAGICO_BLOCOS, 3) != 0 || rodape[27] != cabecalho[3])
+    {
+        return NULL;
+    }
+    uint64_t tamanho_arquivo = (uint64_t)(fim - inicio);
+    uint64_t n = ler_u64(rodape), deslocamento_indice = ler_u64(rodape + 8), total_rodape = ler_u64(rodape + 16);
+    //o indice vai do deslocamento dele ate o rodape, sem sobrar nem faltar bytes
+    if(deslocamento_indice < tamanho_cabecalho + 1 || 
+       deslocamento_indice > tamanho_arquivo - TAMANHO_RODAPE_BLOCOS ||
+       (tamanho_arquivo - TAMANHO_RODAPE_BLOCOS - deslocamento_indice) / TAMANHO_ENTRADA_INDICE != n ||
+       (tamanho_arquivo - TAMANHO_RODAPE_BLOCOS - deslocamento_indice) % TAMANHO_ENTRADA_INDICE != 0)
+    {
+        return NULL;
+    }
+
+    uint8_t *bytes = (uint8_t*)malloc(n * TAMANHO_ENTRADA_INDICE + 1);
+    IndiceBloco *indice = (IndiceBloco*)malloc(sizeof(IndiceBloco) * n + 1);
+    if(bytes == NULL || indice == NULL || fseeko(arquivo, inicio + (off_t)deslocamento_indice, SEEK_SET) != 0 ||
+       fread(bytes, 1, n * TAMANHO_ENTRADA_INDICE, arquivo) != n * TAMANHO_ENTRADA_INDICE)
+    {
+        free(bytes);
+        free(indice);
+        return NULL;
+    }
+
+    //o bloco seguinte (ou o BLOCO_FIM, no caso do ultimo) nao pode comecar antes do fim do anterior
+    uint64_t minimo = tamanho_cabecalho, soma = 0;
+    bool valido = true;
+    for(uint64_t k = 0; k < n && valido; k++)
+    {
+        indice[k].deslocamento = ler_u64(bytes + k * TAMANHO_ENTRADA_INDICE);
+        indice[k].bits = ler_u64(bytes + k * TAMANHO_ENTRADA_INDICE + 8);
+        indice[k].tamanho_original = ler_u32(bytes + k * TAMANHO_ENTRADA_INDICE + 16);
+        uint64_t tamanho_comprimido = (indice[k].bits + 7) / 8;
+        valido = indice[k].deslocamento >= minimo && indice[k].deslocamento < deslocamento_indice &&
+                 tamanho_comprimido >= 1 && tamanho_comprimido <= deslocamento_indice &&
+                 indice[k].tamanho_original <= TAMANHO_BLOCO_MAXIMO;
+        minimo = indice[k].deslocamento + TAMANHO_CABECALHO_BLOCO + tamanho_comprimido;
+        soma += indice[k].tamanho_original;
+    }
+    free(bytes);
+    uint64_t total_cabecalho = tamanho_original_cabecalho(cabecalho);
+    if(!valido || minimo >= deslocamento_indice || soma != total_rodape || 
+       (total_cabecalho != TAMANHO_DESCONHECIDO && soma != total_cabecalho))
+    {
+        free(indice);
+        return NULL;
+    }
+    *quantidade = n;
+    *tamanho_total = soma;
+    return indice;
+}
+
+/**
+ * @brief   Confere se o cabeçalho de um bloco e o lixo do seu conteúdo batem com a entrada do índice. Num bloco
+ *          intercalado o lixo do primeiro byte é só o do último fluxo, o mesmo que o compressor descontou.
+ * 
+ * @param cabecalho     O cabeçalho do bloco, seguido do conteúdo.
+ * @param bloco         A entrada do índice.
+ * @return              true se batem.
+ */
+bool bloco_confere_indice(const uint8_t *cabecalho, IndiceBloco *bloco)
+{
+    uint32_t tamanho = (uint32_t)((bloco->bits + 7) / 8);
+    if(ler_u32(cabecalho + 1) != bloco->tamanho_original || ler_u32(cabecalho + 5) != tamanho)
+    {
+        return false;
+    }
+    switch(cabecalho[0])
+    {
+    case BLOCO_HUFFMAN:
+    case BLOCO_CANONICO:
+    case BLOCO_INTERCALADO:
+        return (uint64_t)tamanho * 8 - (cabecalho[TAMANHO_CABECALHO_BLOCO] >> 5) == bloco->bits;
+    case BLOCO_BRUTO:
+        return (uint64_t)tamanho * 8 == bloco->bits;
+    default:
+        return false;
+    }
+}
+
+//bloco descomprimido por uma thread do pool direto na sua posicao final dentro do lote
+typedef struct tarefa_descompressao
+{
+    uint8_t tipo;
+    const uint8_t *dados;
+    size_t tamanho;
+    uint32_t tamanho_original;
+    uint8_t *destino;
+    TabelaDecodificacao *tabela;
+    bool ok;
+} TarefaDescompressao;
+
+/**
+ * @brief   Tarefa do pool: descomprime o bloco de índice i de um lote no destino reservado para ele.
+ * 
+ * @param argumento     O vetor de tarefas do lote.
+ * @param i             O índice do bloco dentro do lote.
+ */
+void descomprimir_tarefa_bloco(void *argumento, size_t i)
+{
+    TarefaDescompressao *tarefa = (TarefaDescompressao*)argumento + i;
+    Saida saida;
+    saida_memoria(&saida, tarefa->destino, tarefa->tamanho_original);
+    tarefa->ok = descomprimir_bloco(tarefa->tipo, tarefa->dados, tarefa->tamanho, tarefa->tamanho_original, 
+                                    tarefa->tabela, &saida);
+}
+
+/**
+ * @brief   Descomprime um arquivo em blocos usando o índice do fim do arquivo. Os blocos são tratados em lotes; como 
+ *          o índice diz onde cada bloco começa e quantos bytes ele gera, cada bloco de um lote é descomprimido em 
+ *          paralelo direto na sua posição final. Os blocos vêm do mapeamento da entrada, se houver, ou são lidos do 
+ *          arquivo; o destino é o mapeamento da saída, se houver, ou um buffer do lote gravado de uma vez.
+ * 
+ * @param arquivo       O arquivo comprimido, que precisa permitir posicionamento.
+ * @param inicio        A posição do arquivo onde o formato em blocos começa.
+ * @param mapa_entrada  O formato em blocos mapeado em memória, ou NULL.
+ * @param indice        O índice dos blocos.
+ * @param quantidade    A quantidade de blocos.
+ * @param saida         A saída onde os dados descompactados serão escritos, se não houver mapa_saida.
+ * @param mapa_saida    O destino mapeado em memória, com o tamanho original total, ou NULL.
+ * @param threads       O número de threads.
+ * @return              NULL se deu certo, senão a mensagem do erro.
+ */
+const char* descomprimir_blocos_paralelo(FILE *arquivo, off_t inicio, const uint8_t *mapa_entrada, 
+                                         IndiceBloco *indice, uint64_t quantidade, Saida *saida, uint8_t *mapa_saida, 
+                                         int threads)
+{
+    const char *erro = NULL;
+    PoolThreads pool;
+    if(!pool_criar(&pool, threads))
+    {
+        erro = "Não foi possível criar as threads";
+    }
+    size_t lote_maximo = (size_t)threads * 2;
+    TarefaDescompressao *tarefas = (TarefaDescompressao*)malloc(sizeof(TarefaDescompressao) * lote_maximo);
+    //cada posicao do lote tem a sua tabela, reaproveitada pelos blocos que caem nela
+    TabelaDecodificacao *tabelas = (TabelaDecodificacao*)malloc(sizeof(TabelaDecodificacao) * lote_maximo);
+    uint8_t *comprimidos = NULL, *descomprimidos = NULL;
+    size_t capacidade_comprimidos = 0, capacidade_descomprimidos = 0;
+    uint64_t produzidos = 0;
+    if(erro == NULL && (tarefas == NULL || tabelas == NULL))
+    {
+        erro = "Não foi possível alocar memória para os blocos";
+    }
+    ESTATISTICA_SOMAR(saida->estatisticas, alocacoes, 2);
+    for(size_t k = 0; tabelas != NULL && k < lote_maximo; k++)
+    {
+        iniciar_tabela_decodificacao(&tabelas[k]);
+        tabelas[k].estatisticas = saida->estatisticas;
+    }
+
+    for(uint64_t primeiro = 0; erro == NULL && primeiro < quantidade; primeiro += lote_maximo)
+    {
+        size_t lote = quantidade - primeiro < lote_maximo ? (size_t)(quantidade - primeiro) : lote_maximo;
+        IndiceBloco *ultimo = &indice[primeiro + lote - 1];
+        uint64_t comeco = indice[primeiro].deslocamento;
+        size_t tamanho_comprimido = (size_t)(ultimo->deslocamento + TAMANHO_CABECALHO_BLOCO + (ultimo->bits + 7) / 8 - 
+                                             comeco);
+        size_t tamanho_descomprimido = 0;
+        for(size_t k = 0; k < lote; k++)
+        {
+            tamanho_descomprimido += indice[primeiro + k].tamanho_original;
+        }
+
+        //sem mapeamentos, os buffers do lote so crescem e sao reaproveitados entre lotes
+        const uint8_t *origem;
+        uint8_t *destino;
+        if(mapa_entrada != NULL)
+        {
+            origem = mapa_entrada + comeco;
+        }
+        else
+        {
+            if(tamanho_comprimido > capacidade_comprimidos)
+            {
+                free(comprimidos);
+                capacidade_comprimidos = tamanho_comprimido;
+                comprimidos = (uint8_t*)malloc(capacidade_comprimidos);
+                if(comprimidos == NULL)
+                {
+                    erro = "Não foi possível alocar memória para os blocos";
+                    break;
+                }
+                ESTATISTICA_SOMAR(saida->estatisticas, alocacoes, 1);
+            }
+            uint64_t marca = iniciar_entrada_saida(saida->estatisticas);
+            bool lido = fseeko(arquivo, inicio + (off_t)comeco, SEEK_SET) == 0 &&
+                        fread(comprimidos, 1, tamanho_comprimido, arquivo) == tamanho_comprimido;
+            terminar_entrada_saida(saida->estatisticas, FASE_LEITURA, marca);
+            if(!lido)
+            {
+                erro = "Erro ao ler o arquivo comprimido";
+                break;
+            }
+            ESTATISTICA_SOMAR(saida->estatisticas, bytes_entrada, tamanho_comprimido);
+            origem = comprimidos;
+        }
+        if(mapa_saida != NULL)
+        {
+            destino = mapa_saida + produzidos;
+        }
+        else
+        {
+            if(tamanho_descomprimido > capacidade_descomprimidos)
+            {
+                free(descomprimidos);
+                capacidade_descomprimidos = tamanho_descomprimido;
+                descomprimidos = (uint8_t*)malloc(capacidade_descomprimidos);
+                if(descomprimidos == NULL)
+                {
+                    erro = "Não foi possível alocar memória para os blocos";
+                    break;
+                }
+                ESTATISTICA_SOMAR(saida->estatisticas, alocacoes, 1);
+            }
+            destino = descomprimidos;
+        }
+
+        size_t posicao = 0;
+        for(size_t k = 0; k < lote && erro == NULL; k++)
+        {
+            IndiceBloco *bloco = &indice[primeiro + k];
+            const uint8_t *cabecalho = origem + (bloco->deslocamento - comeco);
+            if(!bloco_confere_indice(cabecalho, bloco))
+            {
+                erro = "Arquivo comprimido inválido";
+                break;
+            }
+            tarefas[k].tipo = cabecalho[0];
+            tarefas[k].dados = cabecalho + TAMANHO_CABECALHO_BLOCO;
+            tarefas[k].tamanho = (size_t)((bloco->bits + 7) / 8);
+            tarefas[k].tamanho_original = bloco->tamanho_original;
+            tarefas[k].destino = destino + posicao;
+            tarefas[k].tabela = &tabelas[k];
+            tarefas[k].ok = false;
+            posicao += bloco->tamanho_original;
+        }
+        if(erro != NULL)
+        {
+            break;
+        }
+
+        pool_executar(&pool, descomprimir_tarefa_bloco, tarefas, lote);
+        for(size_t k = 0; k < lote; k++)
+        {
+            if(!tarefas[k].ok)
+            {
+                erro = "Arquivo comprimido inválido";
+            }
+        }
+        if(erro != NULL)
+        {
+            break;
+        }
+        if(mapa_saida == NULL)
+        {
+            saida_escrever(saida, descomprimidos, tamanho_descomprimido);
+        }
+        produzidos += tamanho_descomprimido;
+    }
+
+    pool_destruir(&pool);
+    for(size_t k = 0; tabelas != NULL && k < lote_maximo; k++)
+    {
+        free_tabela_decodificacao(&tabelas[k]);
+    }
+    free(tabelas);
+    free(tarefas);
+    free(comprimidos);
+    free(descomprimidos);
+    return erro;
+}
+
+/**
+ * @brief   Tenta descomprimir um arquivo em blocos pelo índice, em paralelo. Só é possível quando o arquivo tem índice 
+ *          e está mapeado ou permite posicionamento; numa entrada como um pipe a posição de leitura não é alterada. 
+ *          Se a saída for um arquivo comum, ela é aumentada para o tamanho original e mapeada, e os blocos são 
+ *          escritos direto nela.
+ * 
+ * @param arquivo               O arquivo comprimido.
+ * @param entrada               A entrada, com o primeiro trecho do arquivo já carregado ou sobre o mapeamento.
+ * @param mapa                  O mapeamento do arquivo comprimido, ou NULL.
+ * @param saida                 A saída onde os dados descompactados serão escritos.
+ * @param arquivo_descomprimido O arquivo por trás da saída.
+ * @param threads               O número de threads.
+ * @param erro                  Recebe NULL, ou a mensagem do erro se o arquivo foi descomprimido pelo índice e 
+ *                              falhou.
+ * @return                      false se o arquivo deve ser descomprimido em sequência.
+ */
+bool descomprimir_blocos_indexado(FILE *arquivo, Entrada *entrada, Mapeamento *mapa, Saida *saida, 
+                                  FILE *arquivo_descomprimido, int threads, const char **erro)
+{
+    *erro = NULL;
+    const uint8_t *cabecalho = entrada_dados(entrada);
+    if(tamanho_cabecalho_blocos(cabecalho) == 0 || !(cabecalho[4] & FLAG_INDICE_BLOCOS))
+    {
+        return false;
+    }
+    off_t lido = ftello(arquivo);
+    if(lido < 0)
+    {
+        return false;
+    }
+    //o formato em blocos comeca no inicio do mapeamento ou do primeiro trecho lido
+    off_t inicio = mapa != NULL ? (off_t)(mapa->dados - mapa->base) : lido - (off_t)entrada->fim;
+    uint64_t quantidade = 0, tamanho_total = 0;
+    IndiceBloco *indice = ler_indice_blocos(arquivo, inicio, cabecalho, &quantidade, &tamanho_total);
+    if(indice == NULL)
+    {
+        fseeko(arquivo, lido, SEEK_SET);
+        return false;
+    }
+
+    Mapeamento mapa_saida;
+    bool saida_mapeada = saida_tamanho(saida) == 0 && mapear_escrita(&mapa_saida, arquivo_descomprimido, tamanho_total);
+    *erro = descomprimir_blocos_paralelo(arquivo, inicio, mapa != NULL ? mapa->dados : NULL, indice, quantidade, 
+                                         saida, saida_mapeada ? mapa_saida.dados : NULL, threads);
+    if(saida_mapeada)
+    {
+        //os blocos foram escritos direto no mapeamento, sem passar pela saida
+        if(*erro == NULL)
+        {
+            ESTATISTICA_SOMAR(saida->estatisticas, bytes_saida, tamanho_total);
+            desmapear(&mapa_saida);
+        }
+        else
+        {
+            //os blocos podem ter terminado em qualquer ordem, entao nada do que foi escrito e garantido
+            desmapear_escrita_parcial(&mapa_saida, arquivo_descomprimido, 0);
+        }
+        fseeko(arquivo_descomprimido, 0, SEEK_END);
+    }
+    free(indice);
+    return true;
+}
+
+/**
+ * @brief   Descomprime um arquivo em blocos na ordem, sem o índice. Se o cabeçalho tem o tamanho original e a saída é 
+ *          um arquivo comum ainda vazio, ela é aumentada para esse tamanho e mapeada antes do primeiro bloco, e os 
+ *          blocos são escritos direto nela, como na descompressão pelo índice.
+ * 
+ * @param entrada               A entrada, com o primeiro trecho do arquivo já carregado.
+ * @param tabela                A tabela de decodificação usada, já iniciada.
+ * @param saida                 A saída onde os dados descompactados serão escritos.
+ * @param arquivo_descomprimido O arquivo por trás da saída.
+ * @return                      false se algum bloco for inválido ou o total não bater com o cabeçalho.
+ */
+bool descomprimir_blocos_sequencial(Entrada *entrada, TabelaDecodificacao *tabela, Saida *saida, 
+                                    FILE *arquivo_descomprimido)
+{
+    uint64_t tamanho_original = tamanho_original_cabecalho(entrada_dados(entrada));
+    Mapeamento mapa_saida;
+    if(tamanho_original == TAMANHO_DESCONHECIDO || saida_tamanho(saida) != 0 || 
+       !mapear_escrita(&mapa_saida, arquivo_descomprimido, tamanho_original))
+    {
+        return descomprimir_blocos(entrada, tabela, saida);
+    }
+    Saida destino;
+    saida_memoria(&destino, mapa_saida.dados, mapa_saida.tamanho);
+    destino.estatisticas = saida->estatisticas;
+    bool valido = descomprimir_blocos(entrada, tabela, &destino) && !destino.erro;
+    //os blocos foram escritos direto no mapeamento, sem passar pela saida
+    ESTATISTICA_SOMAR(saida->estatisticas, bytes_saida, destino.posicao);
+    if(valido)
+    {
+        desmapear(&mapa_saida);
+    }
+    else
+    {
+        //um cabecalho com o tamanho errado nao deixa a saida com o tamanho que ele dizia
+        desmapear_escrita_parcial(&mapa_saida, arquivo_descomprimido, destino.posicao);
+    }
+    fseeko(arquivo_descomprimido, 0, SEEK_END);
+    return valido;
+}
+
+/**
+ * @brief   Descomprime só os bytes [deslocamento, deslocamento + tamanho) do arquivo original. O índice diz quais 
+ *          blocos cobrem o intervalo, e só esses são lidos e descomprimidos, então o tempo depende do tamanho dos 
+ *          blocos e não do tamanho do arquivo. Precisa de um arquivo em blocos com índice.
+ * 
+ * @param arquivo_comprimido    O arquivo comprimido, posicionado no início, que precisa permitir posicionamento.
+ * @param deslocamento          A posição do primeiro byte desejado no arquivo original.
+ * @param tamanho               Quantos bytes são desejados.
+ * @param saida                 A saída onde os bytes do intervalo serão escritos.
+ * @return                      Quantos bytes foram escritos, menos que tamanho se o intervalo passar do fim do 
+ *                              arquivo original.
+ */
+uint64_t descomprimir_intervalo(FILE *arquivo_comprimido, uint64_t deslocamento, uint64_t tamanho, Saida *saida)
+{
+    uint8_t cabecalho[TAMANHO_CABECALHO_BLOCOS];
+    off_t inicio = ftello(arquivo_comprimido);
+    if(inicio < 0 || fread(cabecalho, 1, TAMANHO_CABECALHO_BLOCOS, arquivo_comprimido) != TAMANHO_CABECALHO_BLOCOS ||
+       !formato_blocos(cabecalho, TAMANHO_CABECALHO_BLOCOS) || tamanho_cabecalho_blocos(cabecalho) == 0 || 
+       !(cabecalho[4] & FLAG_INDICE_BLOCOS))
+    {
+        printf("\nSó é possível descomprimir um intervalo de um arquivo em blocos com índice\n");
+        exit(1);
+    }
+    uint64_t quantidade = 0, tamanho_total = 0;
+    IndiceBloco *indice = ler_indice_blocos(arquivo_comprimido, inicio, cabecalho, &quantidade, &tamanho_total);
+    if(indice == NULL)
+    {
+        printf("\nArquivo comprimido inválido\n");
+        exit(1);
+    }
+
+    uint8_t *comprimido = (uint8_t*)malloc(TAMANHO_CABECALHO_BLOCO + TAMANHO_BLOCO_MAXIMO + 1);
+    uint8_t *descomprimido = (uint8_t*)malloc(TAMANHO_BLOCO_MAXIMO);
+    if(comprimido == NULL || descomprimido == NULL)
+    {
+        printf("\nNão foi possível alocar memória para os blocos\n");
+        exit(1);
+    }
+
+    TabelaDecodificacao tabela;
+    iniciar_tabela_decodificacao(&tabela);
+    uint64_t comeco_bloco = 0, escritos = 0;
+    for(uint64_t k = 0; k < quantidade && escritos < tamanho; k++)
+    {
+        IndiceBloco *bloco = &indice[k];
+        uint64_t fim_bloco = comeco_bloco + bloco->tamanho_original;
+        //o bloco so interessa se o proximo byte desejado estiver nele
+        if(deslocamento + escritos >= comeco_bloco && deslocamento + escritos < fim_bloco)
+        {
+            size_t tamanho_bloco = TAMANHO_CABECALHO_BLOCO + (size_t)((bloco->bits + 7) / 8);
+            Saida destino;
+            saida_memoria(&destino, descomprimido, bloco->tamanho_original);
+            if(tamanho_bloco > TAMANHO_CABECALHO_BLOCO + TAMANHO_BLOCO_MAXIMO + 1 ||
+               fseeko(arquivo_comprimido, inicio + (off_t)bloco->deslocamento, SEEK_SET) != 0 ||
+               fread(comprimido, 1, tamanho_bloco, arquivo_comprimido) != tamanho_bloco ||
+               !bloco_confere_indice(comprimido, bloco) ||
+               !descomprimir_bloco(comprimido[0], comprimido + TAMANHO_CABECALHO_BLOCO, 
+                                   tamanho_bloco - TAMANHO_CABECALHO_BLOCO, bloco->tamanho_original, &tabela, 
+                                   &destino))
+            {
+                printf("\nArquivo comprimido inválido\n");
+                exit(1);
+            }
+            uint64_t de = deslocamento + escritos - comeco_bloco;
+            uint64_t n = bloco->tamanho_original - de;
+            if(n > tamanho - escritos)
+            {
+                n = tamanho - escritos;
+            }
+            saida_escrever(saida, descomprimido + de, (size_t)n);
+            escritos += n;
+        }
+        comeco_bloco = fim_bloco;
+    }
+
+    free_tabela_decodificacao(&tabela);
+    free(indice);
+    free(comprimido);
+    free(descomprimido);
+    return escritos;
+}
+
+/**
+ * @brief   Descomprime um arquivo já aberto, no formato antigo, no formato em blocos, no fluxo adaptativo ou 
+ *          comprimido com dicionário. Um arquivo comum é mapeado em memória; pipes são lidos em trechos de tamanho 
+ *          fixo. Arquivos em blocos com índice são descomprimidos em paralelo quando a entrada permite 
+ *          posicionamento, e arquivos grandes no formato antigo que foram mapeados, por faixas especulativas.
+ * 
+ * @param arquivo_comprimido        O arquivo comprimido, aberto para leitura.
+ * @param arquivo_descomprimido     O arquivo onde os dados descompactados serão escritos; aberto com "w+b", ele 
+ *                                  pode ser mapeado e receber os blocos direto.
+ * @param threads                   O número de threads usadas nos arquivos em blocos e nos antigos mapeados.
+ * @param estatisticas              Onde as medidas são somadas, ou NULL.
+ * @param dicionario                O dicionário dos arquivos comprimidos com dicionário, ou NULL.
+ * @return                          NULL se deu certo, senão a mensagem do erro.
+ */
+const char* descomprimir_arquivo(FILE *arquivo_comprimido, FILE *arquivo_descomprimido, int threads, 
+                                 Estatisticas *estatisticas, const Dicionario *dicionario)
+{
+    Entrada entrada;
+    Saida saida;
+    //um arquivo comum e mapeado e lido direto do cache de paginas
+    Mapeamento mapa;
+    bool mapeado = mapear_leitura(&mapa, arquivo_comprimido);
+    if(mapeado)
+    {
+        entrada_memoria(&entrada, mapa.dados, mapa.tamanho);
+    }
+    if(!mapeado && !entrada_arquivo(&entrada, arquivo_comprimido, TAMANHO_TRECHO_LEITURA))
+    {
+        return "Não foi possível alocar os buffers de leitura e escrita";
+    }
+    if(!saida_arquivo(&saida, arquivo_descomprimido, TAMANHO_BUFFER_SAIDA_PADRAO))
+    {
+        entrada_finalizar(&entrada);
+        desmapear(&mapa);
+        return "Não foi possível alocar os buffers de leitura e escrita";
+    }
+    entrada.estatisticas = estatisticas;
+    saida.estatisticas = estatisticas;
+    ESTATISTICA_SOMAR(estatisticas, alocacoes, mapeado ? 1 : 2);
+    ESTATISTICA_SOMAR(estatisticas, bytes_entrada, mapeado ? mapa.tamanho : 0);
+    //so o cabecalho e lido antes de saber o formato, para um fluxo adaptativo num pipe nao esperar o buffer encher
+    entrada_garantir(&entrada, TAMANHO_CABECALHO_BLOCOS);
+
+    TabelaDecodificacao tabela;
+    iniciar_tabela_decodificacao(&tabela);
+    tabela.estatisticas = estatisticas;
+    const char *erro = NULL;
+    bool valido = true;
+    //o fluxo adaptativo continua lendo trecho a trecho; os outros formatos comecam com o primeiro trecho inteiro
+    bool adaptativo = fluxo_adaptativo(entrada_dados(&entrada), entrada_disponivel(&entrada));
+    if(!adaptativo)
+    {
+        entrada_carregar(&entrada, 0);
+    }
+    if(adaptativo)
+    {
+        valido = descomprimir_adaptativo(&entrada, &tabela, &saida);
+    }
+    else if(fluxo_dicionario(entrada_dados(&entrada), entrada_disponivel(&entrada)))
+    {
+        if(dicionario == NULL || id_dicionario_cabecalho(entrada_dados(&entrada)) != dicionario->id)
+        {
+            erro = "O arquivo foi comprimido com um dicionário que não foi informado";
+        }
+        else
+        {
+            valido = montar_tabela_canonica(&tabela, dicionario->tamanhos) && 
+                     descomprimir_dicionario(&entrada, &tabela, &saida);
+        }
+    }
+    else if(formato_blocos(entrada_dados(&entrada), entrada_disponivel(&entrada)))
+    {
+        if(tamanho_cabecalho_blocos(entrada_dados(&entrada)) == 0)
+        {
+            erro = "Versão do formato em blocos não suportada";
+        }
+        else if(!descomprimir_blocos_indexado(arquivo_comprimido, &entrada, mapeado ? &mapa : NULL, &saida, 
+                                              arquivo_descomprimido, threads, &erro))
+        {
+            valido = descomprimir_blocos_sequencial(&entrada, &tabela, &saida, arquivo_descomprimido);
+        }
+    }
+    else if(mapeado && threads > 1 && mapa.tamanho > 2 * FAIXA_ESPECULATIVA)
+    {
+        erro = descomprimir_legado_paralelo(mapa.dados, mapa.tamanho, &tabela, &saida, threads);
+    }
+    else
+    {
+        valido = descomprimir_legado(&entrada, &tabela, &saida);
+    }
+    free_tabela_decodificacao(&tabela);
+    //um erro de escrita aparece logo abaixo, ao finalizar a saida
+    if(erro == NULL && !valido && !saida.erro)
+    {
+        erro = "Arquivo comprimido inválido";
+    }
+    if(erro == NULL && entrada.erro)
+    {
+        erro = "Erro ao ler o arquivo comprimido";
+    }
+    ESTATISTICA_SOMAR(estatisticas, bytes_saida, saida_tamanho(&saida));
+    if(!saida_finalizar(&saida) && erro == NULL)
+    {
+        erro = "Erro ao gravar o arquivo descomprimido";
+    }
+    entrada_finalizar(&entrada);
+    desmapear(&mapa);
+    return erro;
+}
+
+/**
+ * @brief   Essa função descomprime um arquivo no formato Huffman, criando a árvore de Huffman a partir dos dados 
+ *          e escrevendo o arquivo descompactado no diretório do nosso programa.
+ * 
+ * @param nome_arquivo  Uma string contendo o nome do arquivo que será descomprimido.
+ * @param estatisticas  Onde as medidas são somadas, ou NULL.
+ */
+void descomprimir_com_estatisticas(char *nome_arquivo, Estatisticas *estatisticas)
+{
+    FILE *arquivo_comprimido, *arquivo_descomprimido;
+    arquivo_comprimido = fopen(nome_arquivo, "rb");
+    if(arquivo_comprimido == NULL)
+    {
+        printf("\nNão foi possível encontrar o arquivo\n");
+        exit(1);
+    }
+
+    //escrevendo arquivo descompactado
+    int tamanho_nome_arquivo = strlen(nome_arquivo);
+    nome_arquivo[tamanho_nome_arquivo - 5] = '\0';
+    //com leitura e escrita a saida pode ser mapeada
+    arquivo_descomprimido = fopen(nome_arquivo, "w+b");
+    if(arquivo_descomprimido == NULL)
+    {
+        printf("\nNão foi possível criar um arquivo de saída\n");
+        exit(1);
+    }
+    const char *erro = descomprimir_arquivo(arquivo_comprimido, arquivo_descomprimido, processadores_disponiveis(), 
+                                            estatisticas, NULL);
+
+    fclose(arquivo_comprimido);
+    fclose(arquivo_descomprimido);
+    if(erro != NULL)
+    {
+        printf("\n%s\n", erro);
+        exit(1);
+    }
+}
+
+/**
+ * @brief   Descomprime um arquivo pelo nome, sem medir nada.
+ * 
+ * @param nome_arquivo  Uma string contendo o nome do arquivo que será descomprimido.
+ */
+void descomprimir(char *nome_arquivo)
+{
+    descomprimir_com_estatisticas(nome_arquivo, NULL);
+}
+
+/**
+ * @brief   Descomprime só um intervalo do arquivo original, a partir de um arquivo em blocos com índice. O resultado 
+ *          vai para um arquivo com o nome original terminado em ".trecho".
+ * 
+ * @param nome_arquivo  Uma string contendo o nome do arquivo comprimido.
+ * @param deslocamento  A posição do primeiro byte desejado no arquivo original.
+ * @param tamanho       Quantos bytes são desejados.
+ */
+void descomprimir_trecho(const char *nome_arquivo, uint64_t deslocamento, uint64_t tamanho)
+{
+    FILE *arquivo_comprimido, *arquivo_trecho;
+    //o nome do trecho e montado a parte; o nome recebido nao e alterado
+    size_t tamanho_nome_arquivo = strlen(nome_arquivo);
+    char nome_trecho[FILENAME_MAX];
+    if(tamanho_nome_arquivo <= 5 || strcmp(nome_arquivo + tamanho_nome_arquivo - 5, ".huff") != 0 ||
+       snprintf(nome_trecho, sizeof(nome_trecho), "%.*s.trecho", (int)(tamanho_nome_arquivo - 5),
+                nome_arquivo) >= (int)sizeof(nome_trecho))
+    {
+        printf("\nO nome do arquivo precisa terminar com .huff\n");
+        exit(1);
+    }
+    arquivo_comprimido = fopen(nome_arquivo, "rb");
+    if(arquivo_comprimido == NULL)
+    {
+        printf("\nNão foi possível encontrar o arquivo\n");
+        exit(1);
+    }
+
+    arquivo_trecho = fopen(nome_trecho, "wb");
+    if(arquivo_trecho == NULL)
+    {
+        printf("\nNão foi possível criar um arquivo de saída\n");
+        exit(1);
+    }
+
+    Saida saida;
+    if(!saida_arquivo(&saida, arquivo_trecho, TAMANHO_BUFFER_SAIDA_MINIMO))
+    {
+        printf("\nNão foi possível alocar o buffer de escrita\n");
+        exit(1);
+    }
+    uint64_t escritos = descomprimir_intervalo(arquivo_comprimido, deslocamento, tamanho, &saida);
+    if(!saida_finalizar(&saida))
+    {
+        printf("\nErro ao gravar o trecho descomprimido\n");
+        exit(1);
+    }
+    printf("\n%llu bytes gravados em %s\n", (unsigned long long)escritos, nome_trecho);
+
+    fclose(arquivo_comprimido);
+    fclose(arquivo_trecho);
 }
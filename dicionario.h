@@ -0,0 +1,134 @@
+#ifndef DICIONARIO_H
+#define DICIONARIO_H
+
+#include "structs_huffman.h"
+#include "canonico.h"
+#include "buffer_saida.h"
+#include "buffer_entrada.h"
+
+/**
+ * Dicionário: códigos canônicos treinados uma vez num conjunto de arquivos parecidos e guardados num arquivo à parte.
+ * Um arquivo comprimido com ele leva só a identificação do dicionário no lugar da árvore ou dos tamanhos dos códigos,
+ * então arquivos de poucas centenas de bytes não pagam um cabeçalho maior que eles, e nem o compressor nem o
+ * descompressor montam códigos ou tabelas por arquivo. Todo byte tem código, mesmo os que não aparecem no
+ * treinamento, para qualquer arquivo poder ser comprimido. A identificação é calculada dos tamanhos dos códigos, então
+ * dois dicionários com a mesma identificação têm os mesmos códigos.
+ */
+
+//arquivo de dicionario: "HUD", versao, a identificacao (32 bits) e o tamanho do codigo de cada byte, compactado como
+//nos blocos canonicos
+#define MAGICO_DICIONARIO "HUD"
+#define VERSAO_DICIONARIO 1
+#define TAMANHO_CABECALHO_DICIONARIO 8
+//os tamanhos compactados nunca passam de um byte por simbolo
+#define TAMANHO_MAXIMO_DICIONARIO (TAMANHO_CABECALHO_DICIONARIO + Max_table)
+//limite do tamanho dos codigos quando nenhum e pedido; todos os bytes tem codigo, entao o minimo e 8
+#define LIMITE_DICIONARIO_PADRAO 15
+#define LIMITE_DICIONARIO_MINIMO 8
+
+struct dicionario
+{
+    uint32_t id;
+    uint8_t tamanhos[Max_table];
+    Codigo codigos[Max_table];
+};
+
+/**
+ * @brief   Calcula os códigos canônicos e a identificação do dicionário a partir do tamanho dos códigos. A
+ *          identificação é o FNV-1a de 32 bits dos tamanhos.
+ *
+ * @param dicionario    O dicionário, com os tamanhos preenchidos.
+ */
+void preparar_dicionario(Dicionario *dicionario)
+{
+    uint64_t bits[Max_table];
+    uint32_t id = 2166136261u;
+    codigos_canonicos(dicionario->tamanhos, bits);
+    for(int i = 0; i < Max_table; i++)
+    {
+        dicionario->codigos[i].bits = bits[i];
+        dicionario->codigos[i].tamanho = dicionario->tamanhos[i];
+        id = (id ^ dicionario->tamanhos[i]) * 16777619u;
+    }
+    dicionario->id = id;
+}
+
+/**
+ * @brief   Treina um dicionário com as frequências somadas das amostras. Cada byte ganha 1 de frequência, para os que
+ *          não apareceram também terem código.
+ *
+ * @param frequencia    A frequência de cada byte em todas as amostras.
+ * @param limite        O maior tamanho de código, 0 para LIMITE_DICIONARIO_PADRAO.
+ * @param dicionario    Recebe o dicionário.
+ */
+void treinar_dicionario(const long *frequencia, int limite, Dicionario *dicionario)
+{
+    long suavizada[Max_table];
+    for(int i = 0; i < Max_table; i++)
+    {
+        suavizada[i] = frequencia[i] + 1;
+    }
+    if(limite <= 0)
+    {
+        limite = LIMITE_DICIONARIO_PADRAO;
+    }
+    if(limite < LIMITE_DICIONARIO_MINIMO)
+    {
+        limite = LIMITE_DICIONARIO_MINIMO;
+    }
+    if(limite > TAMANHO_CANONICO_MAXIMO)
+    {
+        limite = TAMANHO_CANONICO_MAXIMO;
+    }
+    tamanhos_limitados(suavizada, limite, dicionario->tamanhos);
+    preparar_dicionario(dicionario);
+}
+
+/**
+ * @brief   Escreve o dicionário no formato do arquivo de dicionário.
+ *
+ * @param saida         A saída.
+ * @param dicionario    O dicionário.
+ */
+void escrever_dicionario(Saida *saida, const Dicionario *dicionario)
+{
+    saida_escrever(saida, MAGICO_DICIONARIO, 3);
+    saida_byte(saida, VERSAO_DICIONARIO);
+    saida_u32(saida, dicionario->id);
+    escrever_tamanhos_canonicos(saida, dicionario->tamanhos);
+}
+
+/**
+ * @brief   Lê um dicionário gravado por escrever_dicionario e confere se todo byte tem código e se a identificação
+ *          bate com os tamanhos.
+ *
+ * @param dados         O conteúdo do arquivo de dicionário.
+ * @param tamanho       O tamanho do conteúdo.
+ * @param dicionario    Recebe o dicionário.
+ * @return              false se o conteúdo não for um dicionário válido.
+ */
+bool ler_dicionario(const uint8_t *dados, size_t tamanho, Dicionario *dicionario)
+{
+    if(tamanho < TAMANHO_CABECALHO_DICIONARIO || memcmp(dados, MAGICO_DICIONARIO, 3) != 0 ||
+       dados[3] != VERSAO_DICIONARIO)
+    {
+        return false;
+    }
+    long lidos = ler_tamanhos_canonicos(dados + TAMANHO_CABECALHO_DICIONARIO, tamanho - TAMANHO_CABECALHO_DICIONARIO,
+                                        dicionario->tamanhos);
+    if(lidos < 0 || (size_t)lidos != tamanho - TAMANHO_CABECALHO_DICIONARIO)
+    {
+        return false;
+    }
+    for(int i = 0; i < Max_table; i++)
+    {
+        if(dicionario->tamanhos[i] == 0)
+        {
+            return false;
+        }
+    }
+    preparar_dicionario(dicionario);
+    return dicionario->id == ler_u32(dados + 4);
+}
+
+#endif
@@ -0,0 +1,265 @@
+#ifndef ESTATISTICAS_H
+#define ESTATISTICAS_H
+
+#include "structs_huffman.h"
+#include <time.h>
+
+/**
+ * Medidas de uma compressão ou descompressão: o tempo de cada fase, em um relógio monotônico, e contadores. Quem quer
+ * medir passa um ponteiro para uma estrutura Estatisticas; com NULL cada ponto de medida é só um teste de ponteiro,
+ * sem leitura de relógio. As threads de um pool somam na mesma estrutura com operações atômicas, então o tempo de uma
+ * fase paralela é a soma do tempo de todas as threads nela.
+ */
+
+//fases medidas; leitura e escrita sao descontadas das fases dentro das quais acontecem
+typedef enum fase
+{
+    FASE_LEITURA,
+    FASE_HISTOGRAMA,
+    FASE_ARVORE,
+    FASE_CODIGOS,
+    FASE_CODIFICACAO,
+    FASE_TABELA,
+    FASE_DECODIFICACAO,
+    FASE_ESCRITA,
+    QUANTIDADE_FASES
+} Fase;
+
+//threads acompanhadas na contagem de blocos por thread; as que passam disso caem na ultima posicao
+#define MAXIMO_THREADS_ESTATISTICAS 64
+
+struct estatisticas
+{
+    uint64_t nanossegundos[QUANTIDADE_FASES];
+    uint64_t bytes_entrada;
+    uint64_t bytes_saida;
+    //simbolos codificados ou decodificados com huffman, sem contar os blocos gravados sem compressao
+    uint64_t simbolos;
+    uint64_t maior_codigo;
+    uint64_t bytes_cabecalho;
+    uint64_t bits_lixo;
+    uint64_t alocacoes;
+    uint64_t blocos;
+    uint64_t blocos_por_thread[MAXIMO_THREADS_ESTATISTICAS];
+};
+
+static const char *nomes_fases[QUANTIDADE_FASES] = {
+    "leitura", "histograma", "arvore", "codigos", "codificacao", "tabela", "decodificacao", "escrita"
+};
+
+//soma valor a um contador, se houver estatisticas
+#define ESTATISTICA_SOMAR(estatisticas, campo, valor) \
+    do \
+    { \
+        if((estatisticas) != NULL) \
+        { \
+            __atomic_fetch_add(&(estatisticas)->campo, (uint64_t)(valor), __ATOMIC_RELAXED); \
+        } \
+    } while(0)
+
+//tempo de leitura e escrita desta thread, descontado das fases que estao em volta delas
+static __thread uint64_t nanossegundos_entrada_saida_thread = 0;
+
+/**
+ * @brief   Zera todas as medidas.
+ *
+ * @param estatisticas  As estatísticas.
+ */
+void zerar_estatisticas(Estatisticas *estatisticas)
+{
+    memset(estatisticas, 0, sizeof(Estatisticas));
+}
+
+/**
+ * @brief   O relógio monotônico em nanossegundos.
+ *
+ * @return  Os nanossegundos desde um instante fixo qualquer.
+ */
+static inline uint64_t relogio_nanossegundos()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ULL + (uint64_t)t.tv_nsec;
+}
+
+/**
+ * @brief   Marca o começo de uma fase. A marca não conta o tempo que esta thread passou lendo ou escrevendo, então
+ *          uma fase que lê ou escreve no meio dela não conta esse tempo duas vezes.
+ *
+ * @param estatisticas  As estatísticas, ou NULL.
+ * @return              A marca, 0 sem estatísticas.
+ */
+static inline uint64_t iniciar_fase(Estatisticas *estatisticas)
+{
+    return estatisticas != NULL ? relogio_nanossegundos() - nanossegundos_entrada_saida_thread : 0;
+}
+
+/**
+ * @brief   Soma à fase o tempo desde a marca.
+ *
+ * @param estatisticas  As estatísticas, ou NULL.
+ * @param fase          A fase.
+ * @param marca         A marca devolvida por iniciar_fase.
+ */
+static inline void terminar_fase(Estatisticas *estatisticas, Fase fase, uint64_t marca)
+{
+    if(estatisticas != NULL)
+    {
+        uint64_t fim = relogio_nanossegundos() - nanossegundos_entrada_saida_thread;
+        __atomic_fetch_add(&estatisticas->nanossegundos[fase], fim - marca, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief   Marca o começo de uma leitura ou escrita.
+ *
+ * @param estatisticas  As estatísticas, ou NULL.
+ * @return              O relógio, 0 sem estatísticas.
+ */
+static inline uint64_t iniciar_entrada_saida(Estatisticas *estatisticas)
+{
+    return estatisticas != NULL ? relogio_nanossegundos() : 0;
+}
+
+/**
+ * @brief   Soma à fase de leitura ou de escrita o tempo desde a marca, e desconta esse tempo das outras fases desta
+ *          thread.
+ *
+ * @param estatisticas  As estatísticas, ou NULL.
+ * @param fase          FASE_LEITURA ou FASE_ESCRITA.
+ * @param marca         A marca devolvida por iniciar_entrada_saida.
+ */
+static inline void terminar_entrada_saida(Estatisticas *estatisticas, Fase fase, uint64_t marca)
+{
+    if(estatisticas != NULL)
+    {
+        uint64_t tempo = relogio_nanossegundos() - marca;
+        nanossegundos_entrada_saida_thread += tempo;
+        __atomic_fetch_add(&estatisticas->nanossegundos[fase], tempo, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief   Registra o tamanho do maior código de um bloco, se for o maior até agora.
+ *
+ * @param estatisticas  As estatísticas, ou NULL.
+ * @param tamanho       O tamanho do maior código do bloco, em bits.
+ */
+static inline void registrar_maior_codigo(Estatisticas *estatisticas, uint64_t tamanho)
+{
+    if(estatisticas == NULL)
+    {
+        return;
+    }
+    uint64_t atual = __atomic_load_n(&estatisticas->maior_codigo, __ATOMIC_RELAXED);
+    while(tamanho > atual && !__atomic_compare_exchange_n(&estatisticas->maior_codigo, &atual, tamanho, true,
+                                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+}
+
+/**
+ * @brief   Registra um bloco processado pela thread de número thread.
+ *
+ * @param estatisticas  As estatísticas, ou NULL.
+ * @param thread        O número da thread no pool, 0 para a que chamou.
+ */
+static inline void registrar_bloco(Estatisticas *estatisticas, int thread)
+{
+    if(estatisticas != NULL)
+    {
+        if(thread >= MAXIMO_THREADS_ESTATISTICAS)
+        {
+            thread = MAXIMO_THREADS_ESTATISTICAS - 1;
+        }
+        __atomic_fetch_add(&estatisticas->blocos, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&estatisticas->blocos_por_thread[thread], 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief   Quantas threads processaram algum bloco.
+ *
+ * @param estatisticas  As estatísticas.
+ * @return              O número da última thread com blocos, mais um.
+ */
+int threads_com_blocos(const Estatisticas *estatisticas)
+{
+    int threads = 0;
+    for(int i = 0; i < MAXIMO_THREADS_ESTATISTICAS; i++)
+    {
+        if(estatisticas->blocos_por_thread[i] != 0)
+        {
+            threads = i + 1;
+        }
+    }
+    return threads;
+}
+
+/**
+ * @brief   Escreve as medidas como um relatório para pessoas.
+ *
+ * @param estatisticas  As estatísticas.
+ * @param arquivo       Onde o relatório é escrito.
+ */
+void relatar_estatisticas(const Estatisticas *estatisticas, FILE *arquivo)
+{
+    uint64_t total = 0;
+    for(int i = 0; i < QUANTIDADE_FASES; i++)
+    {
+        total += estatisticas->nanossegundos[i];
+    }
+    fprintf(arquivo, "\n%-16s %12s %8s\n", "fase", "ms", "%");
+    for(int i = 0; i < QUANTIDADE_FASES; i++)
+    {
+        if(estatisticas->nanossegundos[i] != 0)
+        {
+            fprintf(arquivo, "%-16s %12.3f %7.1f%%\n", nomes_fases[i], estatisticas->nanossegundos[i] / 1e6,
+                    100.0 * estatisticas->nanossegundos[i] / total);
+        }
+    }
+    fprintf(arquivo, "\nbytes de entrada:   %llu\n", (unsigned long long)estatisticas->bytes_entrada);
+    fprintf(arquivo, "bytes de saída:     %llu\n", (unsigned long long)estatisticas->bytes_saida);
+    fprintf(arquivo, "símbolos:           %llu\n", (unsigned long long)estatisticas->simbolos);
+    fprintf(arquivo, "maior código:       %llu bits\n", (unsigned long long)estatisticas->maior_codigo);
+    fprintf(arquivo, "bytes de cabeçalho: %llu\n", (unsigned long long)estatisticas->bytes_cabecalho);
+    fprintf(arquivo, "bits de lixo:       %llu\n", (unsigned long long)estatisticas->bits_lixo);
+    fprintf(arquivo, "alocações:          %llu\n", (unsigned long long)estatisticas->alocacoes);
+    fprintf(arquivo, "blocos:             %llu\n", (unsigned long long)estatisticas->blocos);
+    int threads = threads_com_blocos(estatisticas);
+    for(int i = 0; i < threads; i++)
+    {
+        fprintf(arquivo, "  thread %-3d        %llu\n", i, (unsigned long long)estatisticas->blocos_por_thread[i]);
+    }
+}
+
+/**
+ * @brief   Escreve as medidas como um objeto JSON, com os tempos em nanossegundos.
+ *
+ * @param estatisticas  As estatísticas.
+ * @param arquivo       Onde o JSON é escrito.
+ */
+void estatisticas_json(const Estatisticas *estatisticas, FILE *arquivo)
+{
+    fprintf(arquivo, "{\"fases_ns\": {");
+    for(int i = 0; i < QUANTIDADE_FASES; i++)
+    {
+        fprintf(arquivo, "%s\"%s\": %llu", i ? ", " : "", nomes_fases[i],
+                (unsigned long long)estatisticas->nanossegundos[i]);
+    }
+    fprintf(arquivo, "}, \"bytes_entrada\": %llu, \"bytes_saida\": %llu, \"simbolos\": %llu, \"maior_codigo\": %llu, "
+            "\"bytes_cabecalho\": %llu, \"bits_lixo\": %llu, \"alocacoes\": %llu, \"blocos\": %llu, "
+            "\"blocos_por_thread\": [", (unsigned long long)estatisticas->bytes_entrada,
+            (unsigned long long)estatisticas->bytes_saida, (unsigned long long)estatisticas->simbolos,
+            (unsigned long long)estatisticas->maior_codigo, (unsigned long long)estatisticas->bytes_cabecalho,
+            (unsigned long long)estatisticas->bits_lixo, (unsigned long long)estatisticas->alocacoes,
+            (unsigned long long)estatisticas->blocos);
+    int threads = threads_com_blocos(estatisticas);
+    for(int i = 0; i < threads; i++)
+    {
+        fprintf(arquivo, "%s%llu", i ? ", " : "", (unsigned long long)estatisticas->blocos_por_thread[i]);
+    }
+    fprintf(arquivo, "]}\n");
+}
+
+#endif
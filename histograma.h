@@ -0,0 +1,87 @@
+#ifndef HISTOGRAMA_H
+#define HISTOGRAMA_H
+
+#include "structs_huffman.h"
+
+//quantidade de tabelas de contagem intercaladas: bytes vizinhos iguais caem em contadores diferentes, entao um
+//incremento nao espera o anterior terminar de ser gravado
+#define HISTOGRAMA_TABELAS 4
+//bytes contados antes de somar as tabelas de 32 bits na de frequencias, para nenhum contador estourar
+#define HISTOGRAMA_TRECHO ((size_t)1 << 30)
+
+typedef uint32_t TabelasHistograma[HISTOGRAMA_TABELAS][Max_table];
+
+/**
+ * @brief   Conta os 8 bytes de uma palavra, alternando entre as tabelas.
+ *
+ * @param tabelas   As tabelas de contagem.
+ * @param palavra   Os 8 bytes, em qualquer ordem.
+ */
+static inline void histograma_palavra(TabelasHistograma tabelas, uint64_t palavra)
+{
+    tabelas[0][palavra & 0xFF]++;
+    tabelas[1][(palavra >> 8) & 0xFF]++;
+    tabelas[2][(palavra >> 16) & 0xFF]++;
+    tabelas[3][(palavra >> 24) & 0xFF]++;
+    tabelas[0][(palavra >> 32) & 0xFF]++;
+    tabelas[1][(palavra >> 40) & 0xFF]++;
+    tabelas[2][(palavra >> 48) & 0xFF]++;
+    tabelas[3][palavra >> 56]++;
+}
+
+/**
+ * @brief   Conta os bytes de 16 em 16, lidos como palavras de 64 bits. 16 bytes iguais, o caso comum em 
+ *          preenchimentos com zeros, viram uma única soma.
+ *
+ * @param dados     Os bytes.
+ * @param tamanho   A quantidade de bytes, no máximo HISTOGRAMA_TRECHO.
+ * @param tabelas   As tabelas de contagem.
+ */
+static void histograma_trecho(const uint8_t *dados, size_t tamanho, TabelasHistograma tabelas)
+{
+    size_t i = 0;
+    for(; i + 16 <= tamanho; i += 16)
+    {
+        uint64_t palavras[2];
+        memcpy(palavras, dados + i, 16);
+        if(palavras[0] == palavras[1] && palavras[0] == (palavras[0] & 0xFF) * 0x0101010101010101ULL)
+        {
+            tabelas[0][dados[i]] += 16;
+            continue;
+        }
+        histograma_palavra(tabelas, palavras[0]);
+        histograma_palavra(tabelas, palavras[1]);
+    }
+    for(; i < tamanho; i++)
+    {
+        tabelas[i % HISTOGRAMA_TABELAS][dados[i]]++;
+    }
+}
+
+/**
+ * @brief   Soma a frequência de cada byte de um array à tabela de frequências. Os bytes são contados em tabelas
+ *          intercaladas de 32 bits, somadas na tabela de frequências a cada HISTOGRAMA_TRECHO bytes. Não usa nada
+ *          global, então pode ser chamada por várias threads ao mesmo tempo.
+ *
+ * @param dados         Os bytes.
+ * @param tamanho       A quantidade de bytes.
+ * @param frequencia    A tabela de frequências, que recebe as contagens somadas ao que já tinha.
+ */
+void histograma_bytes(const uint8_t *dados, size_t tamanho, long *frequencia)
+{
+    TabelasHistograma tabelas;
+    while(tamanho > 0)
+    {
+        size_t trecho = tamanho < HISTOGRAMA_TRECHO ? tamanho : HISTOGRAMA_TRECHO;
+        memset(tabelas, 0, sizeof(tabelas));
+        histograma_trecho(dados, trecho, tabelas);
+        for(int i = 0; i < Max_table; i++)
+        {
+            frequencia[i] += (long)tabelas[0][i] + tabelas[1][i] + tabelas[2][i] + tabelas[3][i];
+        }
+        dados += trecho;
+        tamanho -= trecho;
+    }
+}
+
+#endif
@@ -8,32 +8,98 @@
 */
 
 
-#include "comprimir.h"
-#include "descomprimir.h"
+#include "linha_comando.h"
 
 
-void main()
+int main(int argc, char **argv)
 {
+    //com um subcomando o programa roda sem perguntas, no modo de linha de comando
+    if(argc > 1 && (strcmp(argv[1], "comprimir") == 0 || strcmp(argv[1], "c") == 0 ||
+                    strcmp(argv[1], "descomprimir") == 0 || strcmp(argv[1], "d") == 0 ||
+                    strcmp(argv[1], "treinar") == 0 || strcmp(argv[1], "t") == 0))
+    {
+        return executar_linha_comando(argc, argv);
+    }
+    if(argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0))
+    {
+        mostrar_uso(stdout);
+        return 0;
+    }
     int opcao = -1;
+    //--stats mostra as medidas de cada compressao ou descompressao, --stats=json mostra as mesmas medidas em JSON
+    Estatisticas medidas;
+    Estatisticas *estatisticas = NULL;
+    bool json = false;
+    for(int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--stats") == 0 || strcmp(argv[i], "--stats=json") == 0)
+        {
+            estatisticas = &medidas;
+            json = strcmp(argv[i], "--stats=json") == 0;
+        }
+        else
+        {
+            printf("\nOpção desconhecida: %s\n", argv[i]);
+            exit(1);
+        }
+    }
 
     do
     {
-        printf("\n\n\t < ESCOLHA UMA AÇÃO A SER REALIZADA >\n\n[1] COMPRIMIR ARQUIVO\n[2] DESCOMPRIMIR ARQUIVO\n[0] ENCERRAR PROGRAMA\n");
+        printf("\n\n\t < ESCOLHA UMA AÇÃO A SER REALIZADA >\n\n[1] COMPRIMIR ARQUIVO\n[2] DESCOMPRIMIR ARQUIVO\n[3] COMPRIMIR ARQUIVO EM BLOCOS (VÁRIAS THREADS)\n[4] DESCOMPRIMIR UM TRECHO DE UM ARQUIVO EM BLOCOS\n[5] COMPRIMIR ARQUIVO EM BLOCOS COM CÓDIGOS DE TAMANHO LIMITADO\n[6] COMPRIMIR ARQUIVO NO MODO ADAPTATIVO (UMA PASSADA)\n[0] ENCERRAR PROGRAMA\n");
         scanf("%d", &opcao);
         char nome_arquivo[106];
+        OpcoesCompressao opcoes = opcoes_padrao();
+        opcoes.estatisticas = estatisticas;
+        if(estatisticas != NULL)
+        {
+            zerar_estatisticas(estatisticas);
+        }
         switch (opcao)
         {
         case 1:
             printf("\nEscreva o nome do arquivo (incluindo a extensão dele): \n");
             scanf("%s", nome_arquivo);
             printf("\nIniciando compressão do arquivo...\n");
-            comprimir(nome_arquivo);
+            comprimir_com_opcoes(nome_arquivo, &opcoes);
             break;
         case 2:
             printf("\nEscreva o nome do arquivo (incluindo a extensão dele): \n");
             scanf("%s", nome_arquivo);
             printf("\nIniciando descompressão do arquivo...\n");
-            descomprimir(nome_arquivo);
+            descomprimir_com_estatisticas(nome_arquivo, estatisticas);
+            break;
+        case 3:
+            printf("\nEscreva o nome do arquivo (incluindo a extensão dele): \n");
+            scanf("%s", nome_arquivo);
+            printf("\nIniciando compressão do arquivo em blocos...\n");
+            opcoes.formato = FORMATO_BLOCOS;
+            comprimir_com_opcoes(nome_arquivo, &opcoes);
+            break;
+        case 4:
+            printf("\nEscreva o nome do arquivo (incluindo a extensão dele): \n");
+            scanf("%s", nome_arquivo);
+            unsigned long long deslocamento, tamanho;
+            printf("\nEscreva a posição do primeiro byte e a quantidade de bytes: \n");
+            scanf("%llu %llu", &deslocamento, &tamanho);
+            printf("\nIniciando descompressão do trecho...\n");
+            descomprimir_trecho(nome_arquivo, deslocamento, tamanho);
+            break;
+        case 5:
+            printf("\nEscreva o nome do arquivo (incluindo a extensão dele): \n");
+            scanf("%s", nome_arquivo);
+            opcoes.formato = FORMATO_BLOCOS;
+            printf("\nEscreva o maior tamanho de código permitido, em bits: \n");
+            scanf("%d", &opcoes.limite_codigo);
+            printf("\nIniciando compressão do arquivo em blocos...\n");
+            comprimir_com_opcoes(nome_arquivo, &opcoes);
+            break;
+        case 6:
+            printf("\nEscreva o nome do arquivo (incluindo a extensão dele): \n");
+            scanf("%s", nome_arquivo);
+            opcoes.formato = FORMATO_ADAPTATIVO;
+            printf("\nIniciando compressão adaptativa do arquivo...\n");
+            comprimir_com_opcoes(nome_arquivo, &opcoes);
             break;
         case 0:
             printf("\nEncerrando programa...\n");
@@ -42,5 +108,17 @@ void main()
             printf("\nOpção inválida, escolha novamente!\n");
             break;
         }
+        if(estatisticas != NULL && (opcao == 1 || opcao == 2 || opcao == 3 || opcao == 5 || opcao == 6))
+        {
+            if(json)
+            {
+                estatisticas_json(estatisticas, stdout);
+            }
+            else
+            {
+                relatar_estatisticas(estatisticas, stdout);
+            }
+        }
     } while(opcao != 0);
+    return 0;
 }
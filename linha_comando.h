@@ -0,0 +1,950 @@
+#ifndef LINHA_COMANDO_H
+#define LINHA_COMANDO_H
+
+#include "biblioteca.h"
+#include <sys/stat.h>
+
+/**
+ * Modo de linha de comando, sem perguntas: "huffman comprimir|descomprimir [opções] arquivos...". Os arquivos são
+ * independentes e são processados ao mesmo tempo por um pool de threads; cada thread tem os seus contextos da
+ * biblioteca e o seu buffer de resultado, reaproveitados de um arquivo para o outro, então processar milhares de
+ * arquivos pequenos não aloca nada por arquivo. Arquivos grandes, a entrada padrão e a compressão no formato antigo
+ * ou no fluxo adaptativo passam pelos caminhos de arquivo. Um erro só faz o arquivo dele falhar. Como o resultado
+ * pode ir para a saída padrão, as mensagens vão para a saída de erro. "huffman treinar -o DICIONÁRIO amostras..."
+ * treina um dicionário, que é carregado uma única vez com --dicionario e compartilhado por todos os arquivos e todas
+ * as threads.
+ */
+
+//arquivos ate esse tamanho sao processados inteiros na memoria pelos contextos de cada thread
+#define TAMANHO_MAXIMO_MEMORIA ((size_t)64 * 1024 * 1024)
+//com codigos de pelo menos 1 bit cada byte comprimido vira no maximo 8; um tamanho original maior que isso (blocos de
+//um byte so repetido, ou um cabecalho corrompido) nao e reservado de uma vez, o buffer cresce conforme o resultado
+#define EXPANSAO_MAXIMA_RESERVADA 8
+#define EXTENSAO_HUFF ".huff"
+
+//o que foi pedido na linha de comando
+typedef struct configuracao_linha_comando
+{
+    bool descomprimir;
+    //treinar: as amostras viram um dicionario gravado em -o
+    bool treinar;
+    //--trecho: so os bytes [deslocamento, deslocamento + tamanho) do original sao descomprimidos
+    bool trecho;
+    uint64_t deslocamento_trecho, tamanho_trecho;
+    //-c: o resultado vai para a saida padrao
+    bool saida_padrao;
+    //-o: o arquivo de saida, ou o diretorio onde os resultados sao gravados
+    const char *saida;
+    bool saida_diretorio;
+    //-j: quantos arquivos sao processados ao mesmo tempo
+    int threads;
+    bool json;
+    OpcoesCompressao opcoes;
+} ConfiguracaoLinhaComando;
+
+//o que cada thread do pool reaproveita de um arquivo para o outro
+typedef struct trabalhador
+{
+    ContextoCompressao *compressao;
+    ContextoDescompressao *descompressao;
+    uint8_t *buffer;
+    size_t capacidade;
+} Trabalhador;
+
+//uma rodada do pool: os arquivos, um trabalhador por thread e quantos arquivos falharam
+typedef struct lote_arquivos
+{
+    ConfiguracaoLinhaComando *config;
+    char **nomes;
+    size_t quantidade;
+    Trabalhador *trabalhadores;
+    int threads_por_arquivo;
+    int falhas;
+} LoteArquivos;
+
+/**
+ * @brief   Mostra como usar o modo de linha de comando.
+ *
+ * @param destino   Onde o texto é escrito: a saída padrão com -h, a saída de erro num uso errado.
+ */
+void mostrar_uso(FILE *destino)
+{
+    fprintf(destino, "\nUso: huffman comprimir|descomprimir [opções] [arquivos...]\n"
+            "     huffman treinar -o DICIONÁRIO [--limite BITS] amostras...\n"
+            "  -o SAIDA           arquivo de saída, ou diretório com vários arquivos; - é a saída padrão\n"
+            "  -c                 grava o resultado na saída padrão; sem arquivos, lê da entrada padrão\n"
+            "  -j N               quantos arquivos são processados ao mesmo tempo (padrão: um por processador)\n"
+            "  -T LISTA           lê os nomes dos arquivos de LISTA, um por linha; - é a entrada padrão\n"
+            "  --legado           comprime no formato antigo em vez do formato em blocos\n"
+            "  --adaptativo       comprime numa única passada, gravando a saída conforme a entrada chega\n"
+            "  --intervalo KIB    no modo adaptativo, de quanto em quanto os códigos são refeitos (padrão %d)\n"
+            "  --limite BITS      limita o tamanho dos códigos\n"
+            "  --bloco KIB        tamanho dos blocos (padrão %d)\n"
+            "  --fluxos N         divide cada bloco em N fluxos de bits intercalados, até %d (padrão 1)\n"
+            "  --dicionario ARQ   comprime ou descomprime com um dicionário criado por huffman treinar\n"
+            "  --trecho P:N       descomprime só N bytes do original a partir do byte P, de um arquivo em blocos\n"
+            "  --stats            mostra as medidas somadas de todos os arquivos\n"
+            "  --stats=json       mostra as mesmas medidas em JSON\n"
+            "  -h, --help         mostra esta ajuda\n"
+            "Sem -o e sem -c, arquivo vira arquivo.huff e arquivo.huff volta a ser arquivo. Um arquivo chamado - é a "
+            "entrada padrão.\n", INTERVALO_ADAPTATIVO_PADRAO / 1024, TAMANHO_BLOCO_PADRAO / 1024,
+            FLUXOS_MAXIMO);
+}
+
+/**
+ * @brief   Mostra como usar o modo de linha de comando na saída de erro e encerra.
+ */
+void uso_linha_comando()
+{
+    mostrar_uso(stderr);
+    exit(1);
+}
+
+/**
+ * @brief   Mostra o erro de um arquivo, sem encerrar o programa.
+ *
+ * @param nome      O nome do arquivo.
+ * @param mensagem  O erro.
+ */
+void erro_arquivo(const char *nome, const char *mensagem)
+{
+    fprintf(stderr, "huffman: %s: %s\n", nome, mensagem);
+}
+
+/**
+ * @brief   Acrescenta um nome à lista de arquivos, fazendo a lista crescer quando precisa.
+ *
+ * @param nomes         A lista.
+ * @param quantidade    Quantos nomes a lista tem.
+ * @param capacidade    Quantos nomes cabem na lista.
+ * @param nome          O nome, que é copiado.
+ */
+void acrescentar_nome(char ***nomes, size_t *quantidade, size_t *capacidade, const char *nome)
+{
+    if(*quantidade == *capacidade)
+    {
+        *capacidade = *capacidade ? *capacidade * 2 : 64;
+        *nomes = (char**)realloc(*nomes, sizeof(char*) * *capacidade);
+    }
+    if(*nomes == NULL || ((*nomes)[*quantidade] = strdup(nome)) == NULL)
+    {
+        fprintf(stderr, "\nNão foi possível alocar a lista de arquivos\n");
+        exit(1);
+    }
+    (*quantidade)++;
+}
+
+/**
+ * @brief   Lê uma lista de arquivos, um nome por linha. Linhas vazias são ignoradas.
+ *
+ * @param lista         O nome da lista, - para a entrada padrão.
+ * @param nomes         A lista de arquivos, que recebe os nomes.
+ * @param quantidade    Quantos nomes a lista de arquivos tem.
+ * @param capacidade    Quantos nomes cabem na lista de arquivos.
+ */
+void ler_lista_arquivos(const char *lista, char ***nomes, size_t *quantidade, size_t *capacidade)
+{
+    FILE *arquivo = strcmp(lista, "-") == 0 ? stdin : fopen(lista, "r");
+    if(arquivo == NULL)
+    {
+        fprintf(stderr, "\nNão foi possível abrir a lista de arquivos %s\n", lista);
+        exit(1);
+    }
+    char *linha = NULL;
+    size_t tamanho_linha = 0;
+    ssize_t lidos;
+    while((lidos = getline(&linha, &tamanho_linha, arquivo)) >= 0)
+    {
+        while(lidos > 0 && (linha[lidos - 1] == '\n' || linha[lidos - 1] == '\r'))
+        {
+            linha[--lidos] = '\0';
+        }
+        if(lidos > 0)
+        {
+            acrescentar_nome(nomes, quantidade, capacidade, linha);
+        }
+    }
+    free(linha);
+    if(arquivo != stdin)
+    {
+        fclose(arquivo);
+    }
+}
+
+/**
+ * @brief   Decide para onde vai o resultado de um arquivo: a saída padrão, o arquivo de -o, ou o nome do arquivo com
+ *          ".huff" acrescentado ou retirado, dentro do diretório de -o se houver um.
+ *
+ * @param config    A configuração.
+ * @param nome      O nome do arquivo de entrada.
+ * @return          O nome de saída alocado com malloc, "-" para a saída padrão, ou NULL se não houver como formar o
+ *                  nome (o erro já foi mostrado).
+ */
+char* nome_saida(const ConfiguracaoLinhaComando *config, const char *nome)
+{
+    if(config->saida_padrao || (config->saida == NULL && strcmp(nome, "-") == 0))
+    {
+        return strdup("-");
+    }
+    if(config->saida != NULL && !config->saida_diretorio)
+    {
+        return strdup(config->saida);
+    }
+    const char *base = nome;
+    size_t tamanho_diretorio = 0;
+    if(config->saida_diretorio)
+    {
+        const char *barra = strrchr(nome, '/');
+        base = barra != NULL ? barra + 1 : nome;
+        tamanho_diretorio = strlen(config->saida) + 1;
+    }
+    size_t tamanho_base = strlen(base), tamanho_extensao = strlen(EXTENSAO_HUFF);
+    if(config->descomprimir)
+    {
+        if(tamanho_base <= tamanho_extensao || strcmp(base + tamanho_base - tamanho_extensao, EXTENSAO_HUFF) != 0)
+        {
+            erro_arquivo(nome, "o nome não termina com " EXTENSAO_HUFF);
+            return NULL;
+        }
+        tamanho_base -= tamanho_extensao;
+    }
+    char *resultado = (char*)malloc(tamanho_diretorio + tamanho_base + tamanho_extensao + 1);
+    if(resultado == NULL)
+    {
+        erro_arquivo(nome, "memória insuficiente");
+        return NULL;
+    }
+    char *fim = resultado;
+    if(config->saida_diretorio)
+    {
+        fim += sprintf(fim, "%s/", config->saida);
+    }
+    memcpy(fim, base, tamanho_base);
+    strcpy(fim + tamanho_base, config->descomprimir ? "" : EXTENSAO_HUFF);
+    return resultado;
+}
+
+/**
+ * @brief   Garante que o buffer de resultado do trabalhador tenha pelo menos tamanho bytes. O buffer só cresce, e fica
+ *          para os próximos arquivos.
+ *
+ * @param trabalhador   O trabalhador.
+ * @param tamanho       Quantos bytes são necessários.
+ * @return              false se faltar memória.
+ */
+bool reservar_resultado(Trabalhador *trabalhador, size_t tamanho)
+{
+    if(trabalhador->capacidade >= tamanho)
+    {
+        return true;
+    }
+    uint8_t *novo = (uint8_t*)realloc(trabalhador->buffer, tamanho);
+    if(novo == NULL)
+    {
+        return false;
+    }
+    trabalhador->buffer = novo;
+    trabalhador->capacidade = tamanho;
+    return true;
+}
+
+/**
+ * @brief   Grava de uma vez o resultado que está no buffer do trabalhador.
+ *
+ * @param lote          O lote, com a configuração.
+ * @param trabalhador   O trabalhador, com o resultado no buffer.
+ * @param nome          O nome do arquivo, para as mensagens.
+ * @param tamanho       O tamanho do resultado.
+ * @param destino       Onde o resultado é gravado.
+ * @return              false se a escrita falhou (a mensagem já foi mostrada).
+ */
+bool gravar_resultado(LoteArquivos *lote, Trabalhador *trabalhador, const char *nome, size_t tamanho, FILE *destino)
+{
+    Estatisticas *estatisticas = lote->config->opcoes.estatisticas;
+    uint64_t marca = iniciar_entrada_saida(estatisticas);
+    bool ok = fwrite(trabalhador->buffer, 1, tamanho, destino) == tamanho;
+    terminar_entrada_saida(estatisticas, FASE_ESCRITA, marca);
+    if(!ok)
+    {
+        erro_arquivo(nome, "erro ao gravar o resultado");
+    }
+    return ok;
+}
+
+/**
+ * @brief   Descomprime na memória, com as tabelas do contexto do trabalhador, um arquivo que não guarda o tamanho 
+ *          original (formato antigo, fluxo adaptativo ou dicionário vindo de um pipe) ou em que ele não é reservado 
+ *          de uma vez. O buffer do trabalhador cresce conforme o resultado.
+ *
+ * @param lote          O lote, com a configuração.
+ * @param trabalhador   Os contextos e o buffer da thread.
+ * @param nome          O nome do arquivo, para as mensagens.
+ * @param dados         O conteúdo do arquivo.
+ * @param tamanho       O tamanho do conteúdo.
+ * @param destino       Onde o resultado é gravado.
+ * @return              false se houve erro (a mensagem já foi mostrada).
+ */
+bool descomprimir_sem_tamanho_em_memoria(LoteArquivos *lote, Trabalhador *trabalhador, const char *nome,
+                                         const uint8_t *dados, size_t tamanho, FILE *destino)
+{
+    Estatisticas *estatisticas = lote->config->opcoes.estatisticas;
+    if(!reservar_resultado(trabalhador, TAMANHO_BUFFER_SAIDA_MINIMO))
+    {
+        erro_arquivo(nome, huff_mensagem_erro(HUFF_ERRO_MEMORIA));
+        return false;
+    }
+    Entrada entrada;
+    Saida saida;
+    entrada_memoria(&entrada, dados, tamanho);
+    saida_memoria(&saida, trabalhador->buffer, trabalhador->capacidade);
+    saida.crescer = true;
+    saida.estatisticas = estatisticas;
+    ContextoDescompressao *contexto = trabalhador->descompressao;
+    bool valido;
+    if(fluxo_dicionario(dados, tamanho))
+    {
+        if(!dicionario_confere(contexto, dados))
+        {
+            erro_arquivo(nome, huff_mensagem_erro(HUFF_ERRO_DICIONARIO));
+            return false;
+        }
+        valido = descomprimir_dicionario(&entrada, &contexto->tabela_dicionario, &saida);
+    }
+    else if(fluxo_adaptativo(dados, tamanho))
+    {
+        valido = descomprimir_adaptativo(&entrada, &contexto->tabela, &saida);
+    }
+    else
+    {
+        valido = formato_blocos(dados, tamanho) ? descomprimir_blocos(&entrada, &contexto->tabela, &saida) :
+                 descomprimir_legado(&entrada, &contexto->tabela, &saida);
+    }
+    //o buffer pode ter sido realocado pela saida
+    trabalhador->buffer = saida.buffer;
+    trabalhador->capacidade = saida.capacidade;
+    if(saida.erro || !valido)
+    {
+        erro_arquivo(nome, huff_mensagem_erro(saida.erro ? HUFF_ERRO_MEMORIA : HUFF_ERRO_DADOS_INVALIDOS));
+        return false;
+    }
+    ESTATISTICA_SOMAR(estatisticas, bytes_entrada, tamanho);
+    ESTATISTICA_SOMAR(estatisticas, bytes_saida, saida.posicao);
+    return gravar_resultado(lote, trabalhador, nome, saida.posicao, destino);
+}
+
+/**
+ * @brief   Descomprime só o intervalo pedido com --trecho de um arquivo em blocos mapeado na memória. Só os blocos
+ *          que cobrem o intervalo são lidos, então o arquivo pode ter qualquer tamanho.
+ *
+ * @param lote          O lote, com a configuração.
+ * @param trabalhador   Os contextos e o buffer da thread.
+ * @param nome          O nome do arquivo, para as mensagens.
+ * @param dados         O conteúdo do arquivo.
+ * @param tamanho       O tamanho do conteúdo.
+ * @param destino       Onde o intervalo é gravado.
+ * @return              false se houve erro (a mensagem já foi mostrada).
+ */
+bool processar_trecho(LoteArquivos *lote, Trabalhador *trabalhador, const char *nome, const uint8_t *dados,
+                         size_t tamanho, FILE *destino)
+{
+    ConfiguracaoLinhaComando *config = lote->config;
+    uint64_t tamanho_original;
+    int codigo = huff_tamanho_original(dados, tamanho, &tamanho_original);
+    if(codigo != HUFF_OK)
+    {
+        //sem o tamanho original nao ha indice
+        codigo = codigo == HUFF_ERRO_TAMANHO_DESCONHECIDO ? HUFF_ERRO_SEM_INDICE : codigo;
+        erro_arquivo(nome, huff_mensagem_erro(codigo));
+        return false;
+    }
+    //o buffer so precisa da parte do intervalo que existe no original
+    uint64_t disponivel = config->deslocamento_trecho < tamanho_original ?
+                          tamanho_original - config->deslocamento_trecho : 0;
+    uint64_t quantidade = config->tamanho_trecho < disponivel ? config->tamanho_trecho : disponivel;
+    if(quantidade > SIZE_MAX || !reservar_resultado(trabalhador, quantidade > 0 ? (size_t)quantidade : 1))
+    {
+        erro_arquivo(nome, huff_mensagem_erro(HUFF_ERRO_MEMORIA));
+        return false;
+    }
+    size_t escritos;
+    codigo = huff_descomprimir_intervalo(trabalhador->descompressao, dados, tamanho, config->deslocamento_trecho,
+                                         (size_t)quantidade, trabalhador->buffer, &escritos);
+    if(codigo != HUFF_OK)
+    {
+        erro_arquivo(nome, huff_mensagem_erro(codigo));
+        return false;
+    }
+    return gravar_resultado(lote, trabalhador, nome, escritos, destino);
+}
+
+/**
+ * @brief   Comprime ou descomprime um arquivo já mapeado inteiro na memória com os contextos do trabalhador e grava o
+ *          resultado com uma única escrita.
+ *
+ * @param lote          O lote, com a configuração.
+ * @param trabalhador   Os contextos e o buffer da thread.
+ * @param nome          O nome do arquivo, para as mensagens.
+ * @param dados         O conteúdo do arquivo.
+ * @param tamanho       O tamanho do conteúdo.
+ * @param destino       Onde o resultado é gravado.
+ * @return              false se houve erro (a mensagem já foi mostrada).
+ */
+bool processar_em_memoria(LoteArquivos *lote, Trabalhador *trabalhador, const char *nome, const uint8_t *dados,
+                          size_t tamanho, FILE *destino)
+{
+    size_t capacidade, tamanho_resultado;
+    if(lote->config->descomprimir)
+    {
+        uint64_t tamanho_original;
+        int codigo = huff_tamanho_original(dados, tamanho, &tamanho_original);
+        if(codigo == HUFF_ERRO_TAMANHO_DESCONHECIDO ||
+           (codigo == HUFF_OK && tamanho_original / EXPANSAO_MAXIMA_RESERVADA > tamanho))
+        {
+            return descomprimir_sem_tamanho_em_memoria(lote, trabalhador, nome, dados, tamanho, destino);
+        }
+        if(codigo != HUFF_OK)
+        {
+            erro_arquivo(nome, huff_mensagem_erro(codigo));
+            return false;
+        }
+        capacidade = (size_t)tamanho_original;
+    }
+    else
+    {
+        capacidade = huff_limite_compressao(trabalhador->compressao, tamanho);
+    }
+    if(!reservar_resultado(trabalhador, capacidade > 0 ? capacidade : 1))
+    {
+        erro_arquivo(nome, huff_mensagem_erro(HUFF_ERRO_MEMORIA));
+        return false;
+    }
+    int codigo = lote->config->descomprimir ?
+                 huff_descomprimir(trabalhador->descompressao, dados, tamanho, trabalhador->buffer, capacidade,
+                                   &tamanho_resultado) :
+                 huff_comprimir(trabalhador->compressao, dados, tamanho, trabalhador->buffer, capacidade,
+                                &tamanho_resultado);
+    if(codigo != HUFF_OK)
+    {
+        erro_arquivo(nome, huff_mensagem_erro(codigo));
+        return false;
+    }
+    //os caminhos de arquivo relatam o custo do limite dentro da compressao; este relata a partir do contexto
+    if(!lote->config->descomprimir && lote->config->opcoes.limite_codigo > 0 &&
+       lote->config->opcoes.dicionario == NULL)
+    {
+        long bits_extras, bits_codificados;
+        huff_custo_limite(trabalhador->compressao, &bits_extras, &bits_codificados);
+        relatar_limite(lote->config->opcoes.limite_codigo, bits_extras, bits_codificados);
+    }
+    return gravar_resultado(lote, trabalhador, nome, tamanho_resultado, destino);
+}
+
+/**
+ * @brief   Comprime ou descomprime um arquivo. Um arquivo comum que cabe em TAMANHO_MAXIMO_MEMORIA vai pelos
+ *          contextos do trabalhador, que devolvem os erros; se o arquivo tiver todas as threads para ele, só vai
+ *          pelos contextos quando não houver nada a dividir entre elas. O resto vai pelos caminhos de arquivo, que
+ *          usam threads_por_arquivo threads e devolvem a mensagem do erro.
+ *
+ * @param lote          O lote, com a configuração.
+ * @param trabalhador   Os contextos e o buffer da thread.
+ * @param nome          O nome do arquivo, - para a entrada padrão.
+ * @return              false se houve erro (a mensagem já foi mostrada).
+ */
+bool processar_arquivo(LoteArquivos *lote, Trabalhador *trabalhador, const char *nome)
+{
+    ConfiguracaoLinhaComando *config = lote->config;
+    bool entrada_padrao = strcmp(nome, "-") == 0;
+    FILE *origem = entrada_padrao ? stdin : fopen(nome, "rb");
+    if(origem == NULL)
+    {
+        erro_arquivo(nome, "não foi possível abrir o arquivo");
+        return false;
+    }
+    char *nome_destino = nome_saida(config, nome);
+    if(nome_destino == NULL)
+    {
+        if(!entrada_padrao)
+        {
+            fclose(origem);
+        }
+        return false;
+    }
+    bool saida_padrao = strcmp(nome_destino, "-") == 0;
+    //com leitura e escrita a saida da descompressao pode ser mapeada
+    FILE *destino = saida_padrao ? stdout : fopen(nome_destino, config->descomprimir ? "w+b" : "wb");
+    if(destino == NULL)
+    {
+        erro_arquivo(nome_destino, "não foi possível criar o arquivo de saída");
+        free(nome_destino);
+        if(!entrada_padrao)
+        {
+            fclose(origem);
+        }
+        return false;
+    }
+
+    OpcoesCompressao opcoes = config->opcoes;
+    opcoes.threads = lote->threads_por_arquivo;
+    Mapeamento mapa;
+    bool ok = true;
+    //um unico bloco nao tem o que dividir entre threads; o tamanho dos blocos de um arquivo a descomprimir so e
+    //conhecido pelo indice, entao ali vale o tamanho padrao
+    size_t sem_divisao = config->descomprimir ? TAMANHO_BLOCO_PADRAO : opcoes.tamanho_bloco;
+    bool em_memoria = config->descomprimir || opcoes.formato == FORMATO_BLOCOS || opcoes.formato == FORMATO_DICIONARIO;
+    if(config->trecho)
+    {
+        //o intervalo e lido direto do mapeamento, entao precisa de um arquivo comum
+        ok = mapear_leitura(&mapa, origem);
+        if(ok)
+        {
+            ok = processar_trecho(lote, trabalhador, nome, mapa.dados, mapa.tamanho, destino);
+        }
+        else
+        {
+            erro_arquivo(nome, "um intervalo só pode ser lido de um arquivo comum");
+        }
+        desmapear(&mapa);
+    }
+    else if(em_memoria && mapear_leitura(&mapa, origem) && mapa.tamanho <= TAMANHO_MAXIMO_MEMORIA &&
+       (opcoes.threads == 1 || mapa.tamanho <= sem_divisao))
+    {
+        ok = processar_em_memoria(lote, trabalhador, nome, mapa.dados, mapa.tamanho, destino);
+        desmapear(&mapa);
+    }
+    else
+    {
+        desmapear(&mapa);
+        const char *erro;
+        if(config->descomprimir)
+        {
+            erro = descomprimir_arquivo(origem, destino, opcoes.threads, opcoes.estatisticas, opcoes.dicionario);
+        }
+        else if(opcoes.formato == FORMATO_BLOCOS)
+        {
+            erro = comprimir_blocos(origem, destino, &opcoes);
+        }
+        else if(opcoes.formato == FORMATO_ADAPTATIVO)
+        {
+            erro = comprimir_adaptativo(origem, destino, &opcoes);
+        }
+        else if(opcoes.formato == FORMATO_DICIONARIO)
+        {
+            erro = comprimir_dicionario(origem, destino, &opcoes);
+        }
+        else
+        {
+            erro = comprimir_arquivo(origem, destino, &opcoes);
+        }
+        if(erro != NULL)
+        {
+            erro_arquivo(nome, erro);
+            ok = false;
+        }
+    }
+
+    if(!entrada_padrao)
+    {
+        fclose(origem);
+    }
+    if((saida_padrao ? fflush(destino) : fclose(destino)) != 0 && ok)
+    {
+        erro_arquivo(nome_destino, "erro ao gravar o resultado");
+        ok = false;
+    }
+    //um resultado pela metade nao fica para tras
+    if(!ok && !saida_padrao)
+    {
+        remove(nome_destino);
+    }
+    free(nome_destino);
+    return ok;
+}
+
+/**
+ * @brief   Tarefa do pool: processa o arquivo de número indice com o trabalhador da thread atual.
+ *
+ * @param argumento     O lote.
+ * @param indice        O número do arquivo.
+ */
+void processar_tarefa_arquivo(void *argumento, size_t indice)
+{
+    LoteArquivos *lote = (LoteArquivos*)argumento;
+    if(!processar_arquivo(lote, &lote->trabalhadores[numero_thread_pool], lote->nomes[indice]))
+    {
+        __atomic_fetch_add(&lote->falhas, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief   Lê o valor inteiro de uma opção, encerrando se ele não existir ou não for um número positivo.
+ *
+ * @param argc  A quantidade de argumentos.
+ * @param argv  Os argumentos.
+ * @param i     A posição da opção, que passa a ser a do valor.
+ * @return      O valor.
+ */
+int valor_opcao(int argc, char **argv, int *i)
+{
+    if(*i + 1 >= argc)
+    {
+        uso_linha_comando();
+    }
+    char *fim;
+    long valor = strtol(argv[++*i], &fim, 10);
+    if(*fim != '\0' || valor < 1 || valor > 1 << 20)
+    {
+        uso_linha_comando();
+    }
+    return (int)valor;
+}
+
+/**
+ * @brief   Carrega um arquivo de dicionário, encerrando se ele não existir ou for inválido.
+ *
+ * @param nome          O nome do arquivo.
+ * @param dicionario    Recebe o dicionário.
+ */
+void carregar_dicionario(const char *nome, Dicionario *dicionario)
+{
+    uint8_t dados[TAMANHO_MAXIMO_DICIONARIO + 1];
+    FILE *arquivo = fopen(nome, "rb");
+    if(arquivo == NULL)
+    {
+        fprintf(stderr, "\nNão foi possível abrir o dicionário %s\n", nome);
+        exit(1);
+    }
+    size_t lidos = fread(dados, 1, sizeof(dados), arquivo);
+    fclose(arquivo);
+    if(huff_ler_dicionario(dados, lidos, dicionario) != HUFF_OK)
+    {
+        fprintf(stderr, "\nO arquivo %s não é um dicionário válido\n", nome);
+        exit(1);
+    }
+}
+
+/**
+ * @brief   Treina um dicionário com as frequências somadas de todos os arquivos e grava o dicionário em -o ou na 
+ *          saída padrão.
+ *
+ * @param config        A configuração, com o limite do tamanho dos códigos.
+ * @param nomes         Os arquivos de amostra; - é a entrada padrão.
+ * @param quantidade    A quantidade de arquivos.
+ * @return              0 se deu certo, 1 se algum arquivo não pôde ser lido ou o dicionário não pôde ser gravado.
+ */
+int treinar_linha_comando(ConfiguracaoLinhaComando *config, char **nomes, size_t quantidade)
+{
+    if(!config->saida_padrao && (config->saida == NULL || config->saida_diretorio))
+    {
+        fprintf(stderr, "\nO treinamento precisa de -o com o nome do dicionário\n");
+        exit(1);
+    }
+    long frequencia[Max_table];
+    memset(frequencia, 0, sizeof(frequencia));
+    uint8_t *trecho = (uint8_t*)malloc(TAMANHO_TRECHO_LEITURA);
+    if(trecho == NULL)
+    {
+        fprintf(stderr, "\nNão foi possível alocar o buffer de leitura\n");
+        exit(1);
+    }
+    for(size_t i = 0; i < quantidade; i++)
+    {
+        bool entrada_padrao = strcmp(nomes[i], "-") == 0;
+        FILE *arquivo = entrada_padrao ? stdin : fopen(nomes[i], "rb");
+        if(arquivo == NULL)
+        {
+            erro_arquivo(nomes[i], "não foi possível abrir o arquivo");
+            free(trecho);
+            return 1;
+        }
+        uint64_t lidos;
+        const char *erro = contar_frequencias(arquivo, NULL, trecho, frequencia, config->opcoes.estatisticas, &lidos);
+        if(!entrada_padrao)
+        {
+            fclose(arquivo);
+        }
+        if(erro != NULL)
+        {
+            erro_arquivo(nomes[i], erro);
+            free(trecho);
+            return 1;
+        }
+    }
+    free(trecho);
+
+    Dicionario dicionario;
+    treinar_dicionario(frequencia, config->opcoes.limite_codigo, &dicionario);
+    bool saida_padrao = config->saida_padrao || strcmp(config->saida, "-") == 0;
+    FILE *destino = saida_padrao ? stdout : fopen(config->saida, "wb");
+    Saida saida;
+    if(destino == NULL || !saida_arquivo(&saida, destino, TAMANHO_BUFFER_SAIDA_MINIMO))
+    {
+        fprintf(stderr, "\nNão foi possível criar o dicionário %s\n", saida_padrao ? "-" : config->saida);
+        exit(1);
+    }
+    escrever_dicionario(&saida, &dicionario);
+    bool ok = saida_finalizar(&saida) && (saida_padrao ? fflush(destino) : fclose(destino)) == 0;
+    if(!ok)
+    {
+        erro_arquivo(saida_padrao ? "-" : config->saida, "erro ao gravar o dicionário");
+    }
+    return ok ? 0 : 1;
+}
+
+/**
+ * @brief   Executa o modo de linha de comando.
+ *
+ * @param argc  A quantidade de argumentos.
+ * @param argv  Os argumentos; argv[1] é o subcomando: comprimir, descomprimir ou treinar.
+ * @return      0 se todos os arquivos deram certo, 1 se algum falhou.
+ */
+int executar_linha_comando(int argc, char **argv)
+{
+    ConfiguracaoLinhaComando config;
+    config.descomprimir = strcmp(argv[1], "descomprimir") == 0 || strcmp(argv[1], "d") == 0;
+    config.treinar = strcmp(argv[1], "treinar") == 0 || strcmp(argv[1], "t") == 0;
+    config.trecho = false;
+    config.saida_padrao = false;
+    config.saida = NULL;
+    config.saida_diretorio = false;
+    config.threads = processadores_disponiveis();
+    config.json = false;
+    config.opcoes = opcoes_padrao();
+    config.opcoes.formato = FORMATO_BLOCOS;
+    Estatisticas medidas;
+    //o dicionario e carregado uma vez e todos os contextos apontam para ele
+    Dicionario dicionario;
+    char **nomes = NULL;
+    size_t quantidade = 0, capacidade = 0;
+    bool opcoes_terminaram = false;
+
+    for(int i = 2; i < argc; i++)
+    {
+        const char *argumento = argv[i];
+        if(opcoes_terminaram || argumento[0] != '-' || strcmp(argumento, "-") == 0)
+        {
+            acrescentar_nome(&nomes, &quantidade, &capacidade, argumento);
+        }
+        else if(strcmp(argumento, "--") == 0)
+        {
+            opcoes_terminaram = true;
+        }
+        else if(strcmp(argumento, "-h") == 0 || strcmp(argumento, "--help") == 0)
+        {
+            mostrar_uso(stdout);
+            exit(0);
+        }
+        else if(strcmp(argumento, "-o") == 0 && i + 1 < argc)
+        {
+            config.saida = argv[++i];
+        }
+        else if(strcmp(argumento, "-c") == 0)
+        {
+            config.saida_padrao = true;
+        }
+        else if(strcmp(argumento, "-j") == 0)
+        {
+            config.threads = valor_opcao(argc, argv, &i);
+        }
+        else if(strcmp(argumento, "-T") == 0 && i + 1 < argc)
+        {
+            ler_lista_arquivos(argv[++i], &nomes, &quantidade, &capacidade);
+        }
+        else if(strcmp(argumento, "--legado") == 0)
+        {
+            config.opcoes.formato = FORMATO_LEGADO;
+        }
+        else if(strcmp(argumento, "--adaptativo") == 0)
+        {
+            config.opcoes.formato = FORMATO_ADAPTATIVO;
+        }
+        else if(strcmp(argumento, "--intervalo") == 0)
+        {
+            config.opcoes.intervalo_adaptativo = (size_t)valor_opcao(argc, argv, &i) * 1024;
+        }
+        else if(strcmp(argumento, "--limite") == 0)
+        {
+            config.opcoes.limite_codigo = valor_opcao(argc, argv, &i);
+        }
+        else if(strcmp(argumento, "--bloco") == 0)
+        {
+            config.opcoes.tamanho_bloco = (size_t)valor_opcao(argc, argv, &i) * 1024;
+        }
+        else if(strcmp(argumento, "--fluxos") == 0)
+        {
+            config.opcoes.fluxos = valor_opcao(argc, argv, &i);
+        }
+        else if(strcmp(argumento, "--dicionario") == 0 && i + 1 < argc)
+        {
+            carregar_dicionario(argv[++i], &dicionario);
+            config.opcoes.dicionario = &dicionario;
+        }
+        else if(strcmp(argumento, "--trecho") == 0 && i + 1 < argc)
+        {
+            char *fim;
+            const char *valor = argv[++i];
+            config.deslocamento_trecho = strtoull(valor, &fim, 10);
+            if(fim == valor || *fim != ':' || valor[0] == '-')
+            {
+                uso_linha_comando();
+            }
+            valor = fim + 1;
+            config.tamanho_trecho = strtoull(valor, &fim, 10);
+            if(fim == valor || *fim != '\0' || valor[0] == '-')
+            {
+                uso_linha_comando();
+            }
+            config.trecho = true;
+        }
+        else if(strcmp(argumento, "--stats") == 0 || strcmp(argumento, "--stats=json") == 0)
+        {
+            config.opcoes.estatisticas = &medidas;
+            config.json = strcmp(argumento, "--stats=json") == 0;
+        }
+        else
+        {
+            uso_linha_comando();
+        }
+    }
+    //-c sem arquivos comprime ou descomprime a entrada padrao
+    if(quantidade == 0 && config.saida_padrao)
+    {
+        acrescentar_nome(&nomes, &quantidade, &capacidade, "-");
+    }
+    if(quantidade == 0)
+    {
+        uso_linha_comando();
+    }
+    if(config.opcoes.formato == FORMATO_LEGADO && config.opcoes.limite_codigo > 0)
+    {
+        fprintf(stderr, "\nO limite do tamanho dos códigos só existe no formato em blocos\n");
+        exit(1);
+    }
+    if(config.trecho && !config.descomprimir)
+    {
+        fprintf(stderr, "\n--trecho só existe na descompressão\n");
+        exit(1);
+    }
+    if(config.opcoes.dicionario != NULL)
+    {
+        if(config.treinar || config.opcoes.formato != FORMATO_BLOCOS)
+        {
+            fprintf(stderr, "\n--dicionario não pode ser usado com treinar, --legado ou --adaptativo\n");
+            exit(1);
+        }
+        config.opcoes.formato = FORMATO_DICIONARIO;
+    }
+    if(config.saida_padrao && config.saida != NULL)
+    {
+        fprintf(stderr, "\n-c e -o não podem ser usados juntos\n");
+        exit(1);
+    }
+    struct stat informacoes;
+    config.saida_diretorio = config.saida != NULL && stat(config.saida, &informacoes) == 0 &&
+                             S_ISDIR(informacoes.st_mode);
+    if(config.treinar)
+    {
+        if(config.opcoes.estatisticas != NULL)
+        {
+            zerar_estatisticas(config.opcoes.estatisticas);
+        }
+        int resultado = treinar_linha_comando(&config, nomes, quantidade);
+        for(size_t i = 0; i < quantidade; i++)
+        {
+            free(nomes[i]);
+        }
+        free(nomes);
+        return resultado;
+    }
+    if(quantidade > 1)
+    {
+        //varios resultados nao podem ir para um mesmo arquivo, nem uma mesma entrada padrao ser lida duas vezes
+        if(config.saida_padrao || (config.saida != NULL && !config.saida_diretorio))
+        {
+            fprintf(stderr, "\nCom vários arquivos, -o precisa ser um diretório e -c não pode ser usado\n");
+            exit(1);
+        }
+        for(size_t i = 0; i < quantidade; i++)
+        {
+            if(strcmp(nomes[i], "-") == 0)
+            {
+                fprintf(stderr, "\nA entrada padrão só pode ser usada sozinha\n");
+                exit(1);
+            }
+        }
+    }
+    if(config.opcoes.estatisticas != NULL)
+    {
+        zerar_estatisticas(config.opcoes.estatisticas);
+    }
+
+    //os arquivos sao divididos entre as threads; um arquivo sozinho fica com todas elas
+    LoteArquivos lote;
+    lote.config = &config;
+    lote.nomes = nomes;
+    lote.quantidade = quantidade;
+    lote.falhas = 0;
+    int threads = (size_t)config.threads < quantidade ? config.threads : (int)quantidade;
+    lote.threads_por_arquivo = quantidade == 1 ? config.threads : 1;
+    lote.trabalhadores = (Trabalhador*)calloc(threads, sizeof(Trabalhador));
+    if(lote.trabalhadores == NULL)
+    {
+        fprintf(stderr, "\nNão foi possível alocar os contextos das threads\n");
+        exit(1);
+    }
+    for(int t = 0; t < threads; t++)
+    {
+        Trabalhador *trabalhador = &lote.trabalhadores[t];
+        trabalhador->compressao = huff_criar_contexto_compressao(&config.opcoes);
+        trabalhador->descompressao = huff_criar_contexto_descompressao();
+        if(trabalhador->compressao == NULL || trabalhador->descompressao == NULL)
+        {
+            fprintf(stderr, "\nNão foi possível alocar os contextos das threads\n");
+            exit(1);
+        }
+        //todas as threads somam nas mesmas medidas, que ja sao atualizadas de forma atomica
+        trabalhador->compressao->opcoes.estatisticas = config.opcoes.estatisticas;
+        trabalhador->descompressao->tabela.estatisticas = config.opcoes.estatisticas;
+        trabalhador->descompressao->tabela_dicionario.estatisticas = config.opcoes.estatisticas;
+        if(config.opcoes.dicionario != NULL &&
+           huff_usar_dicionario_descompressao(trabalhador->descompressao, config.opcoes.dicionario) != HUFF_OK)
+        {
+            fprintf(stderr, "\nNão foi possível alocar os contextos das threads\n");
+            exit(1);
+        }
+    }
+    PoolThreads pool;
+    if(!pool_criar(&pool, threads))
+    {
+        fprintf(stderr, "\nNão foi possível criar as threads\n");
+        exit(1);
+    }
+    pool_executar(&pool, processar_tarefa_arquivo, &lote, quantidade);
+    pool_destruir(&pool);
+
+    if(config.opcoes.estatisticas != NULL)
+    {
+        if(config.json)
+        {
+            estatisticas_json(config.opcoes.estatisticas, stderr);
+        }
+        else
+        {
+            relatar_estatisticas(config.opcoes.estatisticas, stderr);
+        }
+    }
+    for(int t = 0; t < threads; t++)
+    {
+        huff_destruir_contexto_compressao(lote.trabalhadores[t].compressao);
+        huff_destruir_contexto_descompressao(lote.trabalhadores[t].descompressao);
+        free(lote.trabalhadores[t].buffer);
+    }
+    free(lote.trabalhadores);
+    for(size_t i = 0; i < quantidade; i++)
+    {
+        free(nomes[i]);
+    }
+    free(nomes);
+    return lote.falhas > 0 ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef MAPEAMENTO_H
+#define MAPEAMENTO_H
+
+#include "structs_huffman.h"
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/**
+ * Arquivo mapeado em memória. O mapeamento sempre começa no início do arquivo, porque o deslocamento do mmap precisa 
+ * ser múltiplo da página; dados e tamanho são a parte que interessa, a partir da posição em que o arquivo estava.
+ */
+typedef struct mapeamento
+{
+    uint8_t *base;
+    size_t tamanho_mapeado;
+    uint8_t *dados;
+    size_t tamanho;
+} Mapeamento;
+
+/**
+ * @brief   Mapeia para leitura o que falta ler de um arquivo, avisando o sistema que a leitura será sequencial. Só 
+ *          funciona com arquivos comuns e não vazios; para pipes e terminais quem chamou continua lendo em trechos.
+ * 
+ * @param mapa      O mapeamento que será preenchido.
+ * @param arquivo   O arquivo, ainda não lido a partir da posição atual.
+ * @return          false se o arquivo não pôde ser mapeado.
+ */
+bool mapear_leitura(Mapeamento *mapa, FILE *arquivo)
+{
+    mapa->base = NULL;
+    mapa->tamanho_mapeado = 0;
+    mapa->dados = NULL;
+    mapa->tamanho = 0;
+#ifdef _WIN32
+    return false;
+#else
+    struct stat informacoes;
+    off_t posicao = ftello(arquivo);
+    if(posicao < 0 || fstat(fileno(arquivo), &informacoes) != 0 || !S_ISREG(informacoes.st_mode) ||
+       informacoes.st_size <= posicao)
+    {
+        return false;
+    }
+    void *base = mmap(NULL, (size_t)informacoes.st_size, PROT_READ, MAP_PRIVATE, fileno(arquivo), 0);
+    if(base == MAP_FAILED)
+    {
+        return false;
+    }
+    madvise(base, (size_t)informacoes.st_size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    madvise(base, (size_t)informacoes.st_size, MADV_HUGEPAGE);
+#endif
+    mapa->base = (uint8_t*)base;
+    mapa->tamanho_mapeado = (size_t)informacoes.st_size;
+    mapa->dados = mapa->base + posicao;
+    mapa->tamanho = mapa->tamanho_mapeado - (size_t)posicao;
+    return true;
+#endif
+}
+
+/**
+ * @brief   Aumenta um arquivo comum em tamanho bytes a partir da posição atual e mapeia esse espaço para escrita, 
+ *          para que os dados sejam escritos direto no cache de páginas, sem passar por um buffer. Se faltar espaço 
+ *          no disco, o erro só aparece ao escrever nas páginas (SIGBUS).
+ * 
+ * @param mapa      O mapeamento que será preenchido.
+ * @param arquivo   O arquivo, aberto para leitura e escrita ("w+b"): o mapeamento compartilhado exige as duas.
+ * @param tamanho   Quantos bytes serão escritos.
+ * @return          false se o arquivo não pôde ser mapeado.
+ */
+bool mapear_escrita(Mapeamento *mapa, FILE *arquivo, uint64_t tamanho)
+{
+    mapa->base = NULL;
+    mapa->tamanho_mapeado = 0;
+    mapa->dados = NULL;
+    mapa->tamanho = 0;
+#ifdef _WIN32
+    return false;
+#else
+    struct stat informacoes;
+    fflush(arquivo);
+    off_t posicao = ftello(arquivo);
+    if(tamanho == 0 || posicao < 0 || fstat(fileno(arquivo), &informacoes) != 0 || !S_ISREG(informacoes.st_mode) ||
+       ftruncate(fileno(arquivo), posicao + (off_t)tamanho) != 0)
+    {
+        return false;
+    }
+    size_t total = (size_t)posicao + (size_t)tamanho;
+    void *base = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, fileno(arquivo), 0);
+    if(base == MAP_FAILED)
+    {
+        //o arquivo volta ao tamanho de antes, e quem chamou escreve pela saida normal a partir da posicao atual
+        ftruncate(fileno(arquivo), posicao);
+        return false;
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(base, total, MADV_HUGEPAGE);
+#endif
+    mapa->base = (uint8_t*)base;
+    mapa->tamanho_mapeado = total;
+    mapa->dados = mapa->base + posicao;
+    mapa->tamanho = (size_t)tamanho;
+    return true;
+#endif
+}
+
+/**
+ * @brief   Desfaz um mapeamento. Num mapeamento de escrita o conteúdo já está no arquivo.
+ * 
+ * @param mapa  O mapeamento.
+ */
+void desmapear(Mapeamento *mapa)
+{
+#ifndef _WIN32
+    if(mapa->base != NULL)
+    {
+        munmap(mapa->base, mapa->tamanho_mapeado);
+    }
+#endif
+    mapa->base = NULL;
+    mapa->tamanho_mapeado = 0;
+    mapa->dados = NULL;
+    mapa->tamanho = 0;
+}
+
+/**
+ * @brief   Desfaz um mapeamento de escrita em que só os primeiros bytes foram escritos, cortando o arquivo logo 
+ *          depois deles, para ele não ficar com o tamanho reservado.
+ * 
+ * @param mapa      O mapeamento de escrita.
+ * @param arquivo   O arquivo mapeado.
+ * @param escritos  Quantos bytes do mapeamento foram escritos.
+ */
+void desmapear_escrita_parcial(Mapeamento *mapa, FILE *arquivo, uint64_t escritos)
+{
+#ifdef _WIN32
+    desmapear(mapa);
+#else
+    off_t fim = (off_t)(mapa->dados - mapa->base) + (off_t)escritos;
+    desmapear(mapa);
+    ftruncate(fileno(arquivo), fim);
+#endif
+}
+
+#endif
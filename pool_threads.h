@@ -0,0 +1,186 @@
+#ifndef POOL_THREADS_H
+#define POOL_THREADS_H
+
+#include "structs_huffman.h"
+#include <pthread.h>
+
+//funcao executada para cada indice de uma rodada do pool
+typedef void (*TarefaPool)(void *argumento, size_t indice);
+
+/**
+ * Pool de threads fixo. Cada rodada executa a mesma tarefa para os índices de 0 até total - 1; as threads do pool e a
+ * thread que chamou pegam o próximo índice livre até acabarem, e a rodada só retorna quando todos terminaram.
+ */
+typedef struct pool_threads
+{
+    pthread_t *threads;
+    int quantidade;
+    pthread_mutex_t trava;
+    pthread_cond_t acordar;
+    pthread_cond_t terminou;
+    TarefaPool tarefa;
+    void *argumento;
+    size_t total;
+    size_t proxima;
+    size_t concluidas;
+    int numeradas;
+    bool encerrar;
+} PoolThreads;
+
+//numero da thread atual no pool que a criou, 0 na thread que chama pool_executar
+static __thread int numero_thread_pool = 0;
+
+/**
+ * @brief   Quantos processadores estão disponíveis, usado como número padrão de threads.
+ *
+ * @return  O número de processadores, pelo menos 1.
+ */
+int processadores_disponiveis()
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+/**
+ * @brief   Pega índices da rodada atual e executa a tarefa até não sobrar nenhum. Deve ser chamada com a trava
+ *          presa, e retorna com ela presa.
+ *
+ * @param pool  O pool.
+ */
+void pool_trabalhar(PoolThreads *pool)
+{
+    while(pool->tarefa != NULL && pool->proxima < pool->total)
+    {
+        size_t indice = pool->proxima++;
+        TarefaPool tarefa = pool->tarefa;
+        void *argumento = pool->argumento;
+        pthread_mutex_unlock(&pool->trava);
+        tarefa(argumento, indice);
+        pthread_mutex_lock(&pool->trava);
+        pool->concluidas++;
+        if(pool->concluidas == pool->total)
+        {
+            pthread_cond_signal(&pool->terminou);
+        }
+    }
+}
+
+/**
+ * @brief   Laço de cada thread do pool: espera uma rodada, trabalha nela e volta a esperar.
+ *
+ * @param argumento     O pool.
+ * @return              NULL.
+ */
+void* pool_laco(void *argumento)
+{
+    PoolThreads *pool = (PoolThreads*)argumento;
+    pthread_mutex_lock(&pool->trava);
+    numero_thread_pool = ++pool->numeradas;
+    while(!pool->encerrar)
+    {
+        pool_trabalhar(pool);
+        if(!pool->encerrar)
+        {
+            pthread_cond_wait(&pool->acordar, &pool->trava);
+        }
+    }
+    pthread_mutex_unlock(&pool->trava);
+    return NULL;
+}
+
+/**
+ * @brief   Cria o pool. A thread que chama pool_executar também trabalha, então um pool para n threads no total
+ *          cria n - 1 threads.
+ *
+ * @param pool      O pool que será criado.
+ * @param threads   O número total de threads, incluindo a que chama pool_executar.
+ * @return          false se as threads não puderam ser criadas.
+ */
+bool pool_criar(PoolThreads *pool, int threads)
+{
+    pool->quantidade = 0;
+    pool->tarefa = NULL;
+    pool->argumento = NULL;
+    pool->total = 0;
+    pool->proxima = 0;
+    pool->concluidas = 0;
+    pool->numeradas = 0;
+    pool->encerrar = false;
+    pool->threads = NULL;
+    pthread_mutex_init(&pool->trava, NULL);
+    pthread_cond_init(&pool->acordar, NULL);
+    pthread_cond_init(&pool->terminou, NULL);
+    if(threads <= 1)
+    {
+        return true;
+    }
+    pool->threads = (pthread_t*)malloc(sizeof(pthread_t) * (threads - 1));
+    if(pool->threads == NULL)
+    {
+        return false;
+    }
+    for(int i = 0; i < threads - 1; i++)
+    {
+        if(pthread_create(&pool->threads[i], NULL, pool_laco, pool) != 0)
+        {
+            break;
+        }
+        pool->quantidade++;
+    }
+    return pool->quantidade == threads - 1;
+}
+
+/**
+ * @brief   Executa tarefa(argumento, i) para i de 0 até total - 1, espalhado entre as threads, e espera todas.
+ *
+ * @param pool          O pool.
+ * @param tarefa        A função executada para cada índice.
+ * @param argumento     O argumento repassado para a tarefa.
+ * @param total         A quantidade de índices.
+ */
+void pool_executar(PoolThreads *pool, TarefaPool tarefa, void *argumento, size_t total)
+{
+    if(total == 0)
+    {
+        return;
+    }
+    pthread_mutex_lock(&pool->trava);
+    pool->tarefa = tarefa;
+    pool->argumento = argumento;
+    pool->total = total;
+    pool->proxima = 0;
+    pool->concluidas = 0;
+    pthread_cond_broadcast(&pool->acordar);
+    pool_trabalhar(pool);
+    while(pool->concluidas < pool->total)
+    {
+        pthread_cond_wait(&pool->terminou, &pool->trava);
+    }
+    pool->tarefa = NULL;
+    pthread_mutex_unlock(&pool->trava);
+}
+
+/**
+ * @brief   Encerra as threads do pool e libera os recursos.
+ *
+ * @param pool  O pool.
+ */
+void pool_destruir(PoolThreads *pool)
+{
+    pthread_mutex_lock(&pool->trava);
+    pool->encerrar = true;
+    pthread_cond_broadcast(&pool->acordar);
+    pthread_mutex_unlock(&pool->trava);
+    for(int i = 0; i < pool->quantidade; i++)
+    {
+        pthread_join(pool->threads[i], NULL);
+    }
+    free(pool->threads);
+    pool->threads = NULL;
+    pool->quantidade = 0;
+    pthread_mutex_destroy(&pool->trava);
+    pthread_cond_destroy(&pool->acordar);
+    pthread_cond_destroy(&pool->terminou);
+}
+
+#endif
@@ -1,3 +1,6 @@
+#ifndef STRUCTS_HUFFMAN_H
+#define STRUCTS_HUFFMAN_H
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,6 +14,106 @@
 #endif
 
 #define Max_table 256
+//uma arvore de huffman com Max_table folhas tem 2 * Max_table - 1 nos
+#define Max_nos_arvore (2 * Max_table - 1)
+//tamanho dos trechos lidos de cada vez, que limita a memoria usada independente do tamanho do arquivo
+#define TAMANHO_TRECHO_LEITURA (1024 * 1024)
+
+//formato em blocos: "HUF", versao, flags, o limite do tamanho dos codigos (0 se nao houver), 2 bytes reservados, o 
+//tamanho do bloco (32 bits) e o tamanho original total (64 bits, TAMANHO_DESCONHECIDO se a entrada era um pipe), 
+//seguidos dos blocos
+#define MAGICO_BLOCOS "HUF"
+#define VERSAO_BLOCOS 3
+#define TAMANHO_CABECALHO_BLOCOS 20
+#define TAMANHO_DESCONHECIDO UINT64_MAX
+//a versao anterior, ainda lida, e igual mas sem o tamanho original no cabecalho
+#define VERSAO_BLOCOS_SEM_TAMANHO 2
+#define TAMANHO_CABECALHO_BLOCOS_SEM_TAMANHO 12
+//cada bloco: tipo (1 byte), tamanho original e tamanho comprimido (32 bits cada) e o conteudo
+#define TAMANHO_CABECALHO_BLOCO 9
+#define BLOCO_FIM 0
+//bloco com a arvore em pre-ordem, como no formato antigo
+#define BLOCO_HUFFMAN 1
+//bloco com codigos canonicos: o cabecalho tem so o tamanho do codigo de cada byte
+#define BLOCO_CANONICO 2
+//bloco sem compressao: o conteudo sao os proprios bytes, usado quando a compressao nao diminuiria o bloco
+#define BLOCO_BRUTO 3
+//flag do cabecalho: depois do BLOCO_FIM vem o indice dos blocos e o rodape
+#define FLAG_INDICE_BLOCOS 0x01
+//flag do cabecalho: fluxo adaptativo, sem indice; o tamanho do bloco no cabecalho e o intervalo entre as 
+//reconstrucoes dos codigos
+#define FLAG_ADAPTATIVO 0x02
+//trecho do fluxo adaptativo: o lixo nos 3 bits mais altos do primeiro byte e os bits, com os codigos do modelo
+#define BLOCO_ADAPTATIVO 4
+//bloco canonico com varios fluxos de bits intercalados: o byte i do bloco vai no fluxo i % fluxos. O primeiro byte tem 
+//o lixo do ultimo fluxo nos 3 bits mais altos e a quantidade de fluxos nos outros, seguido do tamanho do codigo de 
+//cada byte, do tamanho em bytes de cada fluxo menos o ultimo (32 bits cada) e dos fluxos
+#define BLOCO_INTERCALADO 5
+#define FLUXOS_MAXIMO 8
+//nos blocos intercalados nenhum codigo passa do tamanho da tabela principal do descompressor
+#define TAMANHO_CODIGO_INTERCALADO 11
+//flag do cabecalho: fluxo comprimido com um dicionario treinado antes, sem indice; o tamanho do bloco no cabecalho e 
+//a identificacao do dicionario
+#define FLAG_DICIONARIO 0x04
+//bloco com os codigos do dicionario: o lixo nos 3 bits mais altos do primeiro byte e os bits
+#define BLOCO_DICIONARIO 6
+//cada entrada do indice: deslocamento do bloco e bits do conteudo (64 bits cada) e tamanho original (32 bits); os
+//bits sao 8 por byte do conteudo menos o lixo dos 3 bits mais altos do primeiro byte, que num bloco intercalado e so o
+//do ultimo fluxo
+#define TAMANHO_ENTRADA_INDICE 20
+//rodape: quantidade de blocos, deslocamento do indice e tamanho original total (64 bits cada), "HUF" e a versao
+#define TAMANHO_RODAPE_BLOCOS 28
+//limites do tamanho dos blocos de entrada
+#define TAMANHO_BLOCO_MINIMO (128 * 1024)
+#define TAMANHO_BLOCO_PADRAO (1024 * 1024)
+#define TAMANHO_BLOCO_MAXIMO (4 * 1024 * 1024)
+
+//formatos de saida do compressor
+#define FORMATO_LEGADO 0
+#define FORMATO_BLOCOS 1
+#define FORMATO_ADAPTATIVO 2
+#define FORMATO_DICIONARIO 3
+//formato antigo, ou em blocos se o arquivo nao diminuir no antigo; e o de quem nao escolhe um formato
+#define FORMATO_AUTOMATICO 4
 
 typedef struct arvore Arvore;
 typedef struct arvore_descomprimida Arvore_D;
+typedef struct estatisticas Estatisticas;
+typedef struct dicionario Dicionario;
+
+//codigo de huffman de um simbolo: os bits alinhados a direita e a quantidade de bits
+typedef struct codigo
+{
+    uint64_t bits;
+    uint8_t tamanho;
+} Codigo;
+
+//entrada do indice dos blocos: onde o bloco comeca (relativo ao inicio do arquivo), os bytes do conteudo vezes 8
+//menos o lixo do primeiro byte (num bloco intercalado, o lixo do ultimo fluxo; num bruto, nenhum) e quantos bytes ele
+//tem descomprimido
+typedef struct indice_bloco
+{
+    uint64_t deslocamento;
+    uint64_t bits;
+    uint32_t tamanho_original;
+} IndiceBloco;
+
+//opcoes da compressao: o formato de saida, o maior tamanho de codigo (0 para nao limitar), no formato em blocos 
+//se os blocos sao canonicos, em quantos fluxos de bits cada bloco e dividido (1 para um fluxo so), o tamanho dos 
+//blocos e o numero de threads, no formato adaptativo o intervalo entre as 
+//reconstrucoes dos codigos, no formato com dicionario o dicionario usado, e onde as medidas sao somadas (NULL para 
+//nao medir)
+typedef struct opcoes_compressao
+{
+    int formato;
+    int limite_codigo;
+    bool canonico;
+    int fluxos;
+    size_t tamanho_bloco;
+    int threads;
+    size_t intervalo_adaptativo;
+    const Dicionario *dicionario;
+    Estatisticas *estatisticas;
+} OpcoesCompressao;
+
+#endif